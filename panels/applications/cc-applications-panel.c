@@ -39,9 +39,9 @@
 #include "cc-snapd-client.h"
 #include "cc-snap-row.h"
 #endif
+#include "cc-search-providers.h"
 #include "cc-util.h"
 #include "globs.h"
-#include "search.h"
 #include "utils.h"
 
 #define MASTER_SCHEMA "org.gnome.desktop.notifications"
@@ -50,6 +50,9 @@
 
 #define PORTAL_SNAP_PREFIX "snap."
 
+/* Delay before writing queued permission changes to the permission store */
+#define PORTAL_PERMISSIONS_WRITE_DELAY_MS 200
+
 struct _CcApplicationsPanel
 {
   CcPanel          parent;
@@ -81,8 +84,7 @@ struct _CcApplicationsPanel
   GAppInfo        *current_app_info;
   gchar           *current_portal_app_id;
 
-  GHashTable      *globs;
-  GHashTable      *search_providers;
+  GlobsCache      *globs;
 
   GtkImage        *app_icon_image;
   GtkLabel        *app_name_label;
@@ -92,6 +94,10 @@ struct _CcApplicationsPanel
   GtkWidget       *sandbox_info_button;
 
   GDBusProxy      *perm_store;
+  GHashTable      *perm_cache;
+  GHashTable      *perm_pending_writes;
+  guint            perm_flush_id;
+  guint            perm_lookups_pending;
   GSettings       *media_handling_settings;
   GtkListBoxRow   *perm_store_pending_row;
   GSettings       *notification_settings;
@@ -123,6 +129,10 @@ struct _CcApplicationsPanel
   AdwPreferencesPage *builtin_page;
   GtkListBox      *builtin_list;
   GList           *snap_permission_rows;
+#ifdef HAVE_SNAP
+  CcSnapdClient   *snapd_client;
+  GCancellable    *snap_cancellable;
+#endif
 
   GtkButton       *handler_reset;
   GtkWindow       *handler_dialog;
@@ -197,34 +207,162 @@ open_software_cb (CcApplicationsPanel *self)
 
 /* --- portal permissions and utilities --- */
 
+/* The permission store tables the panel shows, fetched up front so that
+ * selecting an app does not cost a D-Bus round-trip per permission row.
+ */
+static const struct
+{
+  const gchar *table;
+  const gchar *id;
+} portal_permission_tables[] = {
+  { "notifications", "notification" },
+  { "background", "background" },
+  { "wallpaper", "wallpaper" },
+  { "screenshot", "screenshot" },
+  { "gnome", "shortcuts-inhibitor" },
+  { "devices", "microphone" },
+  { "devices", "speakers" },
+  { "devices", "camera" },
+  { "location", "location" },
+};
+
+typedef struct
+{
+  gchar  *table;
+  gchar  *id;
+  gchar  *app_id;
+  GStrv   permissions;
+} PortalPermissionsWrite;
+
+typedef struct
+{
+  CcApplicationsPanel *self;
+  gchar               *key;
+} PortalPermissionsLookup;
+
+static void
+portal_permissions_write_free (PortalPermissionsWrite *write)
+{
+  g_free (write->table);
+  g_free (write->id);
+  g_free (write->app_id);
+  g_strfreev (write->permissions);
+  g_free (write);
+}
+
+static gchar *
+get_portal_permissions_key (const gchar *table,
+                            const gchar *id)
+{
+  return g_strconcat (table, "/", id, NULL);
+}
+
+/* cache the a{sas} app id → permissions dictionary of one table entry */
+static GHashTable *
+cache_portal_permissions (CcApplicationsPanel *self,
+                          const gchar         *key,
+                          GVariant            *permissions)
+{
+  GHashTable *apps;
+
+  apps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_strfreev);
+
+  if (permissions != NULL)
+    {
+      GVariantIter iter;
+      gchar *app_id;
+      GStrv val;
+
+      g_variant_iter_init (&iter, permissions);
+      while (g_variant_iter_next (&iter, "{s^as}", &app_id, &val))
+        g_hash_table_insert (apps, app_id, val);
+    }
+
+  g_hash_table_insert (self->perm_cache, g_strdup (key), apps);
+
+  return apps;
+}
+
 static gchar **
 get_portal_permissions (CcApplicationsPanel *self,
                         const gchar         *table,
                         const gchar         *id,
                         const gchar         *app_id)
+{
+  g_autofree gchar *key = get_portal_permissions_key (table, id);
+  GHashTable *apps;
+
+  apps = g_hash_table_lookup (self->perm_cache, key);
+  if (apps == NULL)
+    {
+      g_autoptr(GVariant) ret = NULL;
+      g_autoptr(GVariant) permissions = NULL;
+
+      /* Not one of the prefetched tables */
+      ret = g_dbus_proxy_call_sync (self->perm_store,
+                                    "Lookup",
+                                    g_variant_new ("(ss)", table, id),
+                                    0, G_MAXINT, NULL, NULL);
+      if (ret == NULL)
+        return NULL;
+
+      g_variant_get (ret, "(@a{sas}v)", &permissions, NULL);
+      apps = cache_portal_permissions (self, key, permissions);
+    }
+
+  return g_strdupv (g_hash_table_lookup (apps, app_id));
+}
+
+static void
+set_portal_permissions_cb (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
 {
   g_autoptr(GVariant) ret = NULL;
-  g_autoptr(GVariantIter) iter = NULL;
-  const gchar *key = NULL;
-  GStrv val;
-  GStrv result = NULL;
-
-  ret = g_dbus_proxy_call_sync (self->perm_store,
-                                "Lookup",
-                                g_variant_new ("(ss)", table, id),
-                                0, G_MAXINT, NULL, NULL);
+  g_autoptr(GError) error = NULL;
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
   if (ret == NULL)
-    return NULL;
+    g_warning ("Error setting portal permissions: %s", error->message);
+}
 
-  g_variant_get (ret, "(a{sas}v)", &iter, NULL);
+static void
+flush_portal_permissions (CcApplicationsPanel *self)
+{
+  GHashTableIter iter;
+  PortalPermissionsWrite *write;
+
+  g_clear_handle_id (&self->perm_flush_id, g_source_remove);
+
+  if (self->perm_store == NULL)
+    return;
 
-  while (g_variant_iter_loop (iter, "{&s^a&s}", &key, &val))
+  g_hash_table_iter_init (&iter, self->perm_pending_writes);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &write))
     {
-      if (strcmp (key, app_id) == 0 && result == NULL)
-        result = g_strdupv (val);
+      /* Not cancellable, the changes must reach the store even when the panel goes away */
+      g_dbus_proxy_call (self->perm_store,
+                         "SetPermission",
+                         g_variant_new ("(sbss^as)", write->table, TRUE, write->id, write->app_id, write->permissions),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         G_MAXINT,
+                         NULL,
+                         set_portal_permissions_cb,
+                         NULL);
     }
 
-  return result;
+  g_hash_table_remove_all (self->perm_pending_writes);
+}
+
+static gboolean
+flush_portal_permissions_timeout_cb (gpointer user_data)
+{
+  CcApplicationsPanel *self = user_data;
+
+  self->perm_flush_id = 0;
+  flush_portal_permissions (self);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -234,17 +372,117 @@ set_portal_permissions (CcApplicationsPanel *self,
                         const gchar *app_id,
                         const gchar * const *permissions)
 {
+  g_autofree gchar *key = get_portal_permissions_key (table, id);
+  PortalPermissionsWrite *write;
+  GHashTable *apps;
+
+  apps = g_hash_table_lookup (self->perm_cache, key);
+  if (apps == NULL)
+    apps = cache_portal_permissions (self, key, NULL);
+  g_hash_table_insert (apps, g_strdup (app_id), g_strdupv ((GStrv) permissions));
+
+  /* Quickly toggling a switch only writes the final state */
+  write = g_new0 (PortalPermissionsWrite, 1);
+  write->table = g_strdup (table);
+  write->id = g_strdup (id);
+  write->app_id = g_strdup (app_id);
+  write->permissions = g_strdupv ((GStrv) permissions);
+  g_hash_table_insert (self->perm_pending_writes,
+                       g_strconcat (key, "/", app_id, NULL),
+                       write);
+
+  if (self->perm_flush_id == 0)
+    self->perm_flush_id = g_timeout_add (PORTAL_PERMISSIONS_WRITE_DELAY_MS,
+                                         flush_portal_permissions_timeout_cb,
+                                         self);
+}
+
+static void
+on_perm_store_signal (CcApplicationsPanel *self,
+                      const gchar         *sender_name,
+                      const gchar         *signal_name,
+                      GVariant            *parameters)
+{
+  g_autoptr(GVariant) permissions = NULL;
+  g_autofree gchar *key = NULL;
+  const gchar *table, *id;
+  gboolean deleted;
+
+  if (g_strcmp0 (signal_name, "Changed") != 0)
+    return;
+
+  g_variant_get (parameters, "(&s&sb@a{sas}v)", &table, &id, &deleted, &permissions, NULL);
+
+  key = get_portal_permissions_key (table, id);
+  if (!g_hash_table_contains (self->perm_cache, key))
+    return;
+
+  cache_portal_permissions (self, key, deleted ? NULL : permissions);
+}
+
+static void
+on_portal_permissions_lookup_cb (GObject      *source_object,
+                                 GAsyncResult *res,
+                                 gpointer      user_data)
+{
+  PortalPermissionsLookup *lookup = user_data;
+  CcApplicationsPanel *self = lookup->self;
+  g_autoptr(GVariant) ret = NULL;
+  g_autoptr(GVariant) permissions = NULL;
   g_autoptr(GError) error = NULL;
+  g_autofree gchar *key = g_steal_pointer (&lookup->key);
 
-  g_dbus_proxy_call_sync (self->perm_store,
-                          "SetPermission",
-                          g_variant_new ("(sbss^as)", table, TRUE, id, app_id, permissions),
-                          0,
-                          G_MAXINT,
-                          NULL,
-                          &error);
-  if (error)
-    g_warning ("Error setting portal permissions: %s", error->message);
+  g_free (lookup);
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  /* Tables which were never written to don't exist yet */
+  if (ret != NULL)
+    g_variant_get (ret, "(@a{sas}v)", &permissions, NULL);
+  else
+    g_debug ("Failed to look up portal permissions for %s: %s", key, error->message);
+
+  /* Don't clobber values written while the lookup was in flight */
+  if (!g_hash_table_contains (self->perm_cache, key))
+    cache_portal_permissions (self, key, permissions);
+
+  if (--self->perm_lookups_pending > 0)
+    return;
+
+  if (self->perm_store_pending_row)
+    g_signal_emit_by_name (self->perm_store_pending_row, "activate");
+
+  self->perm_store_pending_row = NULL;
+}
+
+static void
+prefetch_portal_permissions (CcApplicationsPanel *self)
+{
+  gsize i;
+
+  for (i = 0; i < G_N_ELEMENTS (portal_permission_tables); i++)
+    {
+      PortalPermissionsLookup *lookup;
+
+      lookup = g_new0 (PortalPermissionsLookup, 1);
+      lookup->self = self;
+      lookup->key = get_portal_permissions_key (portal_permission_tables[i].table,
+                                                portal_permission_tables[i].id);
+
+      self->perm_lookups_pending++;
+      g_dbus_proxy_call (self->perm_store,
+                         "Lookup",
+                         g_variant_new ("(ss)",
+                                        portal_permission_tables[i].table,
+                                        portal_permission_tables[i].id),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         G_MAXINT,
+                         cc_panel_get_cancellable (CC_PANEL (self)),
+                         on_portal_permissions_lookup_cb,
+                         lookup);
+    }
 }
 
 static gchar *
@@ -290,19 +528,20 @@ set_search_enabled (CcApplicationsPanel *self,
   g_autoptr(GPtrArray) new_apps = NULL;
   g_autofree gchar *desktop_id = NULL;
   g_auto(GStrv) apps = NULL;
-  gpointer key, value;
+  const CcSearchProvider *provider;
   gboolean default_disabled;
   gint i;
 
   desktop_id = g_strconcat (app_id, ".desktop", NULL);
 
-  if (!g_hash_table_lookup_extended (self->search_providers, app_id, &key, &value))
+  provider = cc_search_providers_lookup (cc_search_providers_get_default (), app_id);
+  if (provider == NULL)
     {
       g_warning ("Trying to configure search for a provider-less app - this shouldn't happen");
       return;
     }
 
-  default_disabled = GPOINTER_TO_INT (value);
+  default_disabled = provider->default_disabled;
 
   new_apps = g_ptr_array_new_with_free_func (g_free);
   if (default_disabled)
@@ -367,10 +606,11 @@ get_search_enabled (CcApplicationsPanel *self,
                     gboolean            *set,
                     gboolean            *enabled)
 {
-  gpointer key, value;
+  const CcSearchProvider *provider;
 
   *enabled = FALSE;
-  *set = g_hash_table_lookup_extended (self->search_providers, app_id, &key, &value);
+  provider = cc_search_providers_lookup (cc_search_providers_get_default (), app_id);
+  *set = provider != NULL;
   if (!*set)
     return;
 
@@ -379,7 +619,7 @@ get_search_enabled (CcApplicationsPanel *self,
   else if (search_disabled_for_app (self, app_id))
     *enabled = FALSE;
   else
-    *enabled = !GPOINTER_TO_INT (value);
+    *enabled = !provider->default_disabled;
 }
 
 static void
@@ -703,31 +943,45 @@ remove_snap_permissions (CcApplicationsPanel *self)
   g_clear_pointer (&self->snap_permission_rows, g_list_free);
 }
 
-static gboolean
-add_snap_permissions (CcApplicationsPanel *self,
-                      GAppInfo            *info,
-                      const gchar         *app_id)
+static CcSnapdClient *
+get_snapd_client (CcApplicationsPanel *self)
+{
+  if (self->snapd_client == NULL)
+    self->snapd_client = cc_snapd_client_new ();
+  return self->snapd_client;
+}
+
+/* Invalidates the snapd requests made for the previously selected app */
+static void
+reset_snap_cancellable (CcApplicationsPanel *self)
+{
+  g_cancellable_cancel (self->snap_cancellable);
+  g_clear_object (&self->snap_cancellable);
+  self->snap_cancellable = g_cancellable_new ();
+}
+
+static void
+snap_connections_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
 {
+  CcApplicationsPanel *self;
   const gchar *snap_name;
-  g_autoptr(CcSnapdClient) client = NULL;
   g_autoptr(JsonArray) plugs = NULL;
   g_autoptr(JsonArray) slots = NULL;
   gint added = 0;
   g_autoptr(GError) error = NULL;
-  g_autoptr(GError) interfaces_error = NULL;
-
-  if (!g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
-    return FALSE;
-  snap_name = app_id + strlen (PORTAL_SNAP_PREFIX);
-
-  client = cc_snapd_client_new ();
 
-  if (!cc_snapd_client_get_all_connections_sync (client, &plugs, &slots, cc_panel_get_cancellable (CC_PANEL (self)), &error))
+  if (!cc_snapd_client_get_all_connections_finish (CC_SNAPD_CLIENT (source_object), result, &plugs, &slots, &error))
     {
-      g_warning ("Failed to get snap connections: %s", error->message);
-      return FALSE;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get snap connections: %s", error->message);
+      return;
     }
 
+  self = CC_APPLICATIONS_PANEL (user_data);
+  snap_name = self->current_portal_app_id + strlen (PORTAL_SNAP_PREFIX);
+
   for (guint i = 0; i < json_array_get_length (plugs); i++)
     {
       JsonObject *plug = json_array_get_object_element (plugs, i);
@@ -758,16 +1012,31 @@ add_snap_permissions (CcApplicationsPanel *self,
           if (g_strcmp0 (plug_interface, json_object_get_string_member (slot, "interface")) != 0)
             continue;
 
-          json_array_add_object_element (available_slots, slot);
+          json_array_add_object_element (available_slots, json_object_ref (slot));
         }
 
-      row = cc_snap_row_new (cc_panel_get_cancellable (CC_PANEL (self)), plug, available_slots);
+      row = cc_snap_row_new (get_snapd_client (self), plug, available_slots);
       adw_preferences_group_add (self->integration_section, GTK_WIDGET (row));
       self->snap_permission_rows = g_list_prepend (self->snap_permission_rows, row);
       added++;
     }
 
-    return added > 0;
+  if (added > 0)
+    gtk_widget_set_visible (GTK_WIDGET (self->integration_section), TRUE);
+}
+
+/* Rows are added once snapd replied */
+static void
+add_snap_permissions (CcApplicationsPanel *self,
+                      const gchar         *app_id)
+{
+  if (!g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
+    return;
+
+  cc_snapd_client_get_all_connections_async (get_snapd_client (self),
+                                             self->snap_cancellable,
+                                             snap_connections_cb,
+                                             self);
 }
 #endif
 
@@ -965,7 +1234,7 @@ update_integration_section (CcApplicationsPanel *self,
       has_any |= set;
 
 #ifdef HAVE_SNAP
-      has_any |= add_snap_permissions (self, info, portal_app_id);
+      add_snap_permissions (self, portal_app_id);
 #endif
     }
   else
@@ -1045,7 +1314,7 @@ add_file_type (CcApplicationsPanel *self,
   GtkWidget *button;
   GtkWidget *row;
 
-  glob = g_hash_table_lookup (self->globs, type);
+  glob = globs_cache_lookup (self->globs, type);
 
   desc = g_content_type_get_description (type);
   row = adw_action_row_new ();
@@ -1362,20 +1631,59 @@ clear_cache_cb (CcApplicationsPanel *self)
 }
 
 static void
-update_app_row (CcApplicationsPanel *self,
-                const gchar         *app_id)
+set_app_size (CcApplicationsPanel *self,
+              guint64              size)
 {
   g_autofree gchar *formatted_size = NULL;
 
-  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
-    self->app_size = get_snap_app_size (app_id + strlen (PORTAL_SNAP_PREFIX));
-  else
-    self->app_size = get_flatpak_app_size (app_id);
+  self->app_size = size;
   formatted_size = g_format_size (self->app_size);
   g_object_set (self->app, "info", formatted_size, NULL);
   update_total_size (self);
 }
 
+#ifdef HAVE_SNAP
+static void
+snap_size_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  g_autoptr(JsonObject) snap = NULL;
+  g_autoptr(GError) error = NULL;
+
+  snap = cc_snapd_client_get_snap_finish (CC_SNAPD_CLIENT (source_object), result, &error);
+  if (snap == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get snap size: %s", error->message);
+      return;
+    }
+
+  set_app_size (CC_APPLICATIONS_PANEL (user_data), json_object_get_int_member (snap, "installed-size"));
+}
+#endif
+
+static void
+update_app_row (CcApplicationsPanel *self,
+                const gchar         *app_id)
+{
+  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
+    {
+#ifdef HAVE_SNAP
+      cc_snapd_client_get_snap_async (get_snapd_client (self),
+                                      app_id + strlen (PORTAL_SNAP_PREFIX),
+                                      self->snap_cancellable,
+                                      snap_size_cb,
+                                      self);
+#endif
+      set_app_size (self, 0);
+    }
+  else
+    {
+      set_app_size (self, get_flatpak_app_size (app_id));
+    }
+}
+
 static void
 update_app_sizes (CcApplicationsPanel *self,
                   const gchar         *app_id)
@@ -1414,7 +1722,7 @@ update_panel (CcApplicationsPanel *self,
 {
   GAppInfo *info;
 
-  if (self->perm_store == NULL)
+  if (self->perm_store == NULL || self->perm_lookups_pending > 0)
     {
       /* Async permission store not initialized, row will be re-activated in the callback */
       self->perm_store_pending_row = row;
@@ -1437,6 +1745,10 @@ update_panel (CcApplicationsPanel *self,
   g_clear_pointer (&self->current_app_id, g_free);
   g_clear_pointer (&self->current_portal_app_id, g_free);
 
+#ifdef HAVE_SNAP
+  reset_snap_cancellable (self);
+#endif
+
   update_header_section (self, info);
   update_integration_section (self, info);
   update_handler_dialog (self, info);
@@ -1576,11 +1888,10 @@ on_perm_store_ready (GObject      *source_object,
     }
 
   self->perm_store = proxy;
+  g_signal_connect_object (self->perm_store, "g-signal",
+                           G_CALLBACK (on_perm_store_signal), self, G_CONNECT_SWAPPED);
 
-  if (self->perm_store_pending_row)
-    g_signal_emit_by_name (self->perm_store_pending_row, "activate");
-
-  self->perm_store_pending_row = NULL;
+  prefetch_portal_permissions (self);
 }
 
 static void
@@ -1672,8 +1983,12 @@ cc_applications_panel_dispose (GObject *object)
   remove_all_handler_rows (self);
 #ifdef HAVE_SNAP
   remove_snap_permissions (self);
+  g_cancellable_cancel (self->snap_cancellable);
+  g_clear_object (&self->snap_cancellable);
+  g_clear_object (&self->snapd_client);
 #endif
   g_clear_object (&self->monitor);
+  flush_portal_permissions (self);
   g_clear_object (&self->perm_store);
 
   G_OBJECT_CLASS (cc_applications_panel_parent_class)->dispose (object);
@@ -1702,8 +2017,9 @@ cc_applications_panel_finalize (GObject *object)
   g_clear_object (&self->current_app_info);
   g_clear_pointer (&self->current_app_id, g_free);
   g_clear_pointer (&self->current_portal_app_id, g_free);
-  g_clear_pointer (&self->globs, g_hash_table_unref);
-  g_clear_pointer (&self->search_providers, g_hash_table_unref);
+  g_clear_pointer (&self->perm_cache, g_hash_table_unref);
+  g_clear_pointer (&self->perm_pending_writes, g_hash_table_unref);
+  g_clear_pointer (&self->globs, globs_cache_free);
 
   G_OBJECT_CLASS (cc_applications_panel_parent_class)->finalize (object);
 }
@@ -1935,6 +2251,10 @@ cc_applications_panel_init (CcApplicationsPanel *self)
   self->monitor = g_app_info_monitor_get ();
   self->monitor_id = g_signal_connect_object (self->monitor, "changed", G_CALLBACK (apps_changed), self, G_CONNECT_SWAPPED);
 
+  self->perm_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+  self->perm_pending_writes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                     (GDestroyNotify) portal_permissions_write_free);
+
   g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
                             G_DBUS_PROXY_FLAGS_NONE,
                             NULL,
@@ -1945,6 +2265,5 @@ cc_applications_panel_init (CcApplicationsPanel *self)
                             on_perm_store_ready,
                             self);
 
-  self->globs = parse_globs ();
-  self->search_providers = parse_search_providers ();
+  self->globs = globs_cache_new ();
 }
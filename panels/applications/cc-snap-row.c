@@ -91,7 +91,6 @@ enable_controls (CcSnapRow *self)
 static void
 change_complete (CcSnapRow *self)
 {
-  g_clear_object (&self->client);
   g_clear_pointer (&self->target_slot, json_object_unref);
   g_clear_pointer (&self->change_id, g_free);
   g_clear_handle_id (&self->change_timeout, g_source_remove);
@@ -100,19 +99,24 @@ change_complete (CcSnapRow *self)
   enable_controls (self);
 }
 
-static gboolean
-poll_change_cb (gpointer user_data)
+static gboolean poll_change_cb (gpointer user_data);
+
+static void
+get_change_cb (GObject *source_object, GAsyncResult *result, gpointer user_data)
 {
   CcSnapRow *self = user_data;
   g_autoptr(JsonObject) change = NULL;
   g_autoptr(GError) error = NULL;
 
-  change = cc_snapd_client_get_change_sync (self->client, self->change_id, self->cancellable, &error);
+  change = cc_snapd_client_get_change_finish (CC_SNAPD_CLIENT (source_object), result, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
   if (change == NULL)
     {
       g_warning ("Failed to monitor change %s: %s", self->change_id, error->message);
       change_complete (self);
-      return G_SOURCE_REMOVE;
+      return;
     }
 
   if (json_object_get_boolean_member (change, "ready"))
@@ -130,10 +134,22 @@ poll_change_cb (gpointer user_data)
         }
 
       change_complete (self);
-      return G_SOURCE_REMOVE;
+      return;
     }
 
-  return G_SOURCE_CONTINUE;
+  self->change_timeout = g_timeout_add (CHANGE_POLL_TIME, poll_change_cb, self);
+}
+
+static gboolean
+poll_change_cb (gpointer user_data)
+{
+  CcSnapRow *self = user_data;
+
+  /* Re-armed once the reply is in, so polls never pile up */
+  self->change_timeout = 0;
+  cc_snapd_client_get_change_async (self->client, self->change_id, self->cancellable, get_change_cb, self);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -145,20 +161,48 @@ monitor_change (CcSnapRow *self, const gchar *change_id)
   self->change_timeout = g_timeout_add (CHANGE_POLL_TIME, poll_change_cb, self);
 }
 
-static CcSnapdClient *
-get_client(CcSnapRow *self)
+static void
+interface_change_started (CcSnapRow    *self,
+                          const gchar  *change_id,
+                          const GError *error,
+                          const gchar  *action)
 {
-  if (self->client == NULL)
-    self->client = cc_snapd_client_new ();
-  return self->client;
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  if (change_id == NULL)
+    {
+      g_warning ("Failed to %s plug: %s", action, error->message);
+      change_complete (self);
+      return;
+    }
+
+  monitor_change (self, change_id);
 }
 
 static void
-connect_plug (CcSnapRow *self, JsonObject *slot)
+connect_plug_cb (GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+  g_autofree gchar *change_id = NULL;
+  g_autoptr(GError) error = NULL;
+
+  change_id = cc_snapd_client_connect_interface_finish (CC_SNAPD_CLIENT (source_object), result, &error);
+  interface_change_started (user_data, change_id, error, "connect");
+}
+
+static void
+disconnect_plug_cb (GObject *source_object, GAsyncResult *result, gpointer user_data)
 {
   g_autofree gchar *change_id = NULL;
   g_autoptr(GError) error = NULL;
 
+  change_id = cc_snapd_client_disconnect_interface_finish (CC_SNAPD_CLIENT (source_object), result, &error);
+  interface_change_started (user_data, change_id, error, "disconnect");
+}
+
+static void
+connect_plug (CcSnapRow *self, JsonObject *slot)
+{
   /* already connected */
   if (self->connected_slot != NULL &&
       g_strcmp0 (json_object_get_string_member (self->connected_slot, "snap"),
@@ -169,51 +213,37 @@ connect_plug (CcSnapRow *self, JsonObject *slot)
 
   disable_controls (self);
 
-  change_id = cc_snapd_client_connect_interface_sync (get_client (self),
-                                                      json_object_get_string_member (self->plug, "snap"),
-                                                      json_object_get_string_member (self->plug, "plug"),
-                                                      json_object_get_string_member (slot, "snap"),
-                                                      json_object_get_string_member (slot, "slot"),
-                                                      self->cancellable,
-                                                      &error);
-  if (change_id == NULL)
-    {
-      g_warning ("Failed to connect plug: %s", error->message);
-      change_complete (self);
-      return;
-    }
-
   g_clear_pointer (&self->target_slot, json_object_unref);
   self->target_slot = json_object_ref (slot);
-  monitor_change (self, change_id);
+
+  cc_snapd_client_connect_interface_async (self->client,
+                                           json_object_get_string_member (self->plug, "snap"),
+                                           json_object_get_string_member (self->plug, "plug"),
+                                           json_object_get_string_member (slot, "snap"),
+                                           json_object_get_string_member (slot, "slot"),
+                                           self->cancellable,
+                                           connect_plug_cb,
+                                           self);
 }
 
 static void
 disconnect_plug (CcSnapRow *self)
 {
-  g_autofree gchar *change_id = NULL;
-  g_autoptr(GError) error = NULL;
-
   /* already disconnected */
   if (self->connected_slot == NULL)
     return;
 
   disable_controls (self);
 
-  change_id = cc_snapd_client_disconnect_interface_sync (get_client (self),
-                                                         json_object_get_string_member (self->plug, "snap"),
-                                                         json_object_get_string_member (self->plug, "plug"),
-                                                         "", "",
-                                                         self->cancellable, &error);
-  if (change_id == NULL)
-    {
-      g_warning ("Failed to disconnect plug: %s", error->message);
-      change_complete (self);
-      return;
-    }
-
   g_clear_pointer (&self->target_slot, json_object_unref);
-  monitor_change (self, change_id);
+
+  cc_snapd_client_disconnect_interface_async (self->client,
+                                              json_object_get_string_member (self->plug, "snap"),
+                                              json_object_get_string_member (self->plug, "plug"),
+                                              "", "",
+                                              self->cancellable,
+                                              disconnect_plug_cb,
+                                              self);
 }
 
 static void
@@ -366,6 +396,7 @@ cc_snap_row_finalize (GObject *object)
 {
   CcSnapRow *self = CC_SNAP_ROW (object);
 
+  g_cancellable_cancel (self->cancellable);
   g_clear_object (&self->cancellable);
   g_clear_object (&self->client);
   g_clear_pointer (&self->plug, json_object_unref);
@@ -400,10 +431,12 @@ static void
 cc_snap_row_init (CcSnapRow *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  self->cancellable = g_cancellable_new ();
 }
 
 CcSnapRow *
-cc_snap_row_new (GCancellable *cancellable, JsonObject *plug, JsonArray *slots)
+cc_snap_row_new (CcSnapdClient *client, JsonObject *plug, JsonArray *slots)
 {
   CcSnapRow *self;
   const gchar *label = NULL;
@@ -411,7 +444,7 @@ cc_snap_row_new (GCancellable *cancellable, JsonObject *plug, JsonArray *slots)
 
   self = CC_SNAP_ROW (g_object_new (CC_TYPE_SNAP_ROW, NULL));
 
-  self->cancellable = g_object_ref (cancellable);
+  self->client = g_object_ref (client);
   self->plug = json_object_ref (plug);
   self->slots = json_array_ref (slots);
 
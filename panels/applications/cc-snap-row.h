@@ -23,12 +23,14 @@
 #include <adwaita.h>
 #include <json-glib/json-glib.h>
 
+#include "cc-snapd-client.h"
+
 G_BEGIN_DECLS
 
 #define CC_TYPE_SNAP_ROW (cc_snap_row_get_type())
 G_DECLARE_FINAL_TYPE (CcSnapRow, cc_snap_row, CC, SNAP_ROW, AdwActionRow)
 
-CcSnapRow* cc_snap_row_new      (GCancellable   *cancellable,
+CcSnapRow* cc_snap_row_new      (CcSnapdClient  *client,
                                  JsonObject     *plug,
                                  JsonArray      *slots);
 
@@ -25,14 +25,49 @@
 // Unix socket that snapd communicates on.
 #define SNAPD_SOCKET_PATH "/var/run/snapd.socket"
 
+// Number of kept-alive connections to snapd, so requests can be in flight concurrently.
+#define MAX_CONNECTIONS 4
+
+// How long a GET response is reused before asking snapd again.
+#define RESPONSE_CACHE_TIMEOUT (2 * G_USEC_PER_SEC)
+
 struct _CcSnapdClient
 {
   GObject parent;
 
   // HTTP connection to snapd.
   SoupSession *session;
+
+  // Recent GET responses, keyed by path.
+  GHashTable *response_cache;
+
+  // Tasks waiting for a GET that is already in flight, keyed by path.
+  GHashTable *pending_requests;
+
+  // Incremented whenever a request changes the state of snapd.
+  guint generation;
 };
 
+typedef struct
+{
+  JsonObject *response;
+  gint64      time;
+} CachedResponse;
+
+typedef struct
+{
+  CcSnapdClient *client;
+  SoupMessage   *msg;
+  gchar         *path;
+  gboolean       cacheable;
+  // Generation of the client when a cacheable request was sent.
+  guint          generation;
+  // Tasks waiting for a cacheable request, shared with pending_requests.
+  GPtrArray     *tasks;
+  // Task to complete when the request isn't shared.
+  GTask         *task;
+} RequestData;
+
 G_DEFINE_TYPE (CcSnapdClient, cc_snapd_client, G_TYPE_OBJECT)
 
 // Make an HTTP request to send to snapd.
@@ -112,34 +147,172 @@ process_body (SoupMessage *msg, GBytes *body, GError **error)
   return json_object_ref (response);
 }
 
+static void
+cached_response_free (CachedResponse *cached)
+{
+  json_object_unref (cached->response);
+  g_free (cached);
+}
+
+static void
+request_data_free (RequestData *data)
+{
+  g_object_unref (data->client);
+  g_object_unref (data->msg);
+  g_free (data->path);
+  g_clear_pointer (&data->tasks, g_ptr_array_unref);
+  g_clear_object (&data->task);
+  g_free (data);
+}
+
+static void
+return_response (GTask *task, JsonObject *response, const GError *error)
+{
+  if (response != NULL)
+    g_task_return_pointer (task, json_object_ref (response), (GDestroyNotify) json_object_unref);
+  else
+    g_task_return_error (task, g_error_copy (error));
+}
+
+// Forget responses which may predate a change of the state of snapd.
+static void
+invalidate_cache (CcSnapdClient *self)
+{
+  self->generation++;
+  g_hash_table_remove_all (self->response_cache);
+  g_hash_table_remove_all (self->pending_requests);
+}
+
+static void
+call_cb (GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+  RequestData *data = user_data;
+  CcSnapdClient *self = data->client;
+  g_autoptr(GBytes) response_body = NULL;
+  g_autoptr(JsonObject) response = NULL;
+  g_autoptr(GError) error = NULL;
+
+  response_body = soup_session_send_and_read_finish (SOUP_SESSION (source_object), result, &error);
+  if (response_body != NULL)
+    response = process_body (data->msg, response_body, &error);
+
+  if (data->cacheable)
+    {
+      // A response sent before snapd changed state must not be reused.
+      if (response != NULL && data->generation == self->generation)
+        {
+          CachedResponse *cached = g_new0 (CachedResponse, 1);
+          cached->response = json_object_ref (response);
+          cached->time = g_get_monotonic_time ();
+          g_hash_table_insert (self->response_cache, g_strdup (data->path), cached);
+        }
+
+      // The entry may already belong to a request sent after an invalidation.
+      if (g_hash_table_lookup (self->pending_requests, data->path) == data->tasks)
+        g_hash_table_remove (self->pending_requests, data->path);
+
+      for (guint i = 0; i < data->tasks->len; i++)
+        return_response (g_ptr_array_index (data->tasks, i), response, error);
+    }
+  else
+    {
+      // Anything but a GET changes the state of snapd, so new GETs
+      // neither reuse earlier responses nor join requests in flight.
+      if (g_strcmp0 (soup_message_get_method (data->msg), SOUP_METHOD_GET) != 0)
+        invalidate_cache (self);
+
+      return_response (data->task, response, error);
+    }
+
+  request_data_free (data);
+}
+
 // Send an HTTP request to snapd and process the response.
+// Identical cacheable requests in flight share the same response, which is kept for a short while.
+static void
+call_async (CcSnapdClient *self,
+            const gchar *method, const gchar *path, JsonNode *request_body,
+            gboolean cacheable,
+            GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GPtrArray) tasks = NULL;
+  RequestData *data;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, g_strdup (path), g_free);
+
+  if (cacheable)
+    {
+      CachedResponse *cached;
+      GPtrArray *pending_tasks;
+
+      cached = g_hash_table_lookup (self->response_cache, path);
+      if (cached != NULL && g_get_monotonic_time () - cached->time < RESPONSE_CACHE_TIMEOUT)
+        {
+          return_response (task, cached->response, NULL);
+          return;
+        }
+
+      pending_tasks = g_hash_table_lookup (self->pending_requests, path);
+      if (pending_tasks != NULL)
+        {
+          g_ptr_array_add (pending_tasks, g_steal_pointer (&task));
+          return;
+        }
+
+      tasks = g_ptr_array_new_with_free_func (g_object_unref);
+      g_ptr_array_add (tasks, g_steal_pointer (&task));
+      g_hash_table_insert (self->pending_requests, g_strdup (path), g_ptr_array_ref (tasks));
+
+      // Other callers may still want the response.
+      cancellable = NULL;
+    }
+
+  data = g_new0 (RequestData, 1);
+  data->client = g_object_ref (self);
+  data->msg = make_message (method, path, request_body);
+  data->path = g_strdup (path);
+  data->cacheable = cacheable;
+  data->generation = self->generation;
+  data->tasks = g_steal_pointer (&tasks);
+  data->task = g_steal_pointer (&task);
+
+  soup_session_send_and_read_async (self->session, data->msg, G_PRIORITY_DEFAULT, cancellable, call_cb, data);
+}
+
+// Get the "result" member of a response.
 static JsonObject *
-call_sync (CcSnapdClient *self,
-           const gchar *method, const gchar *path, JsonNode *request_body,
-           GCancellable *cancellable, GError **error)
+get_result (GAsyncResult *result, GError **error)
 {
-  g_autoptr(SoupMessage) msg = NULL;
-  g_autoptr(GBytes) response_body = NULL;
+  g_autoptr(JsonObject) response = NULL;
+  JsonObject *object;
 
-  msg = make_message (method, path, request_body);
-  response_body = soup_session_send_and_read (self->session, msg, cancellable, error);
-  if (response_body == NULL)
+  response = g_task_propagate_pointer (G_TASK (result), error);
+  if (response == NULL)
     return NULL;
 
-  return process_body (msg, response_body, error);
+  object = json_object_get_object_member (response, "result");
+  if (object == NULL)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to %s",
+                   (const gchar *) g_task_get_task_data (G_TASK (result)));
+      return NULL;
+    }
+
+  return json_object_ref (object);
 }
 
 // Perform a snap interface action.
-static gchar *
-call_interfaces_sync (CcSnapdClient *self,
-                      const gchar *action,
-                      const gchar *plug_snap, const gchar *plug_name,
-                      const gchar *slot_snap, const gchar *slot_name,
-                      GCancellable *cancellable, GError **error)
+static void
+call_interfaces_async (CcSnapdClient *self,
+                       const gchar *action,
+                       const gchar *plug_snap, const gchar *plug_name,
+                       const gchar *slot_snap, const gchar *slot_name,
+                       GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
 {
   g_autoptr(JsonBuilder) builder = NULL;
-  g_autoptr(JsonObject) response = NULL;
-  const gchar *change_id;
+  g_autoptr(JsonNode) root = NULL;
 
   builder = json_builder_new();
   json_builder_begin_object (builder);
@@ -165,14 +338,20 @@ call_interfaces_sync (CcSnapdClient *self,
   json_builder_end_array (builder);
   json_builder_end_object (builder);
 
-  response = call_sync (self, "POST", "/v2/interfaces",
-                        json_builder_get_root (builder), cancellable, error);
+  root = json_builder_get_root (builder);
+  call_async (self, "POST", "/v2/interfaces", root, FALSE, cancellable, callback, user_data);
+}
+
+static gchar *
+call_interfaces_finish (GAsyncResult *result, GError **error)
+{
+  g_autoptr(JsonObject) response = NULL;
+
+  response = g_task_propagate_pointer (G_TASK (result), error);
   if (response == NULL)
     return NULL;
 
-  change_id = json_object_get_string_member (response, "change");
-
-  return g_strdup (change_id);
+  return g_strdup (json_object_get_string_member (response, "change"));
 }
 
 static void
@@ -181,6 +360,8 @@ cc_snapd_client_dispose (GObject *object)
   CcSnapdClient *self = CC_SNAPD_CLIENT (object);
 
   g_clear_object(&self->session);
+  g_clear_pointer (&self->response_cache, g_hash_table_unref);
+  g_clear_pointer (&self->pending_requests, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_snapd_client_parent_class)->dispose (object);
 }
@@ -197,7 +378,12 @@ static void
 cc_snapd_client_init (CcSnapdClient *self)
 {
   g_autoptr(GSocketAddress) address = g_unix_socket_address_new (SNAPD_SOCKET_PATH);
-  self->session = soup_session_new_with_options ("remote-connectable", address, NULL);
+  self->session = soup_session_new_with_options ("remote-connectable", address,
+                                                 "max-conns", MAX_CONNECTIONS,
+                                                 "max-conns-per-host", MAX_CONNECTIONS,
+                                                 NULL);
+  self->response_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) cached_response_free);
+  self->pending_requests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
 }
 
 CcSnapdClient *
@@ -206,85 +392,108 @@ cc_snapd_client_new (void)
   return CC_SNAPD_CLIENT (g_object_new (CC_TYPE_SNAPD_CLIENT, NULL));
 }
 
-JsonObject *
-cc_snapd_client_get_snap_sync (CcSnapdClient *self, const gchar *name, GCancellable *cancellable, GError **error)
+void
+cc_snapd_client_get_snap_async (CcSnapdClient *self, const gchar *name,
+                                GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
 {
   g_autofree gchar *path = NULL;
-  g_autoptr(JsonObject) response = NULL;
-  JsonObject *result;
 
   path = g_strdup_printf ("/v2/snaps/%s", name);
-  response = call_sync (self, "GET", path, NULL, cancellable, error);
-  if (response == NULL)
-    return NULL;
-  result = json_object_get_object_member (response, "result");
-  if (result == NULL)
-    {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to %s", path);
-      return NULL;
-    }
-
-  return json_object_ref (result);
+  call_async (self, "GET", path, NULL, TRUE, cancellable, callback, user_data);
 }
 
 JsonObject *
-cc_snapd_client_get_change_sync (CcSnapdClient *self, const gchar *change_id, GCancellable *cancellable, GError **error)
+cc_snapd_client_get_snap_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return get_result (result, error);
+}
+
+void
+cc_snapd_client_get_change_async (CcSnapdClient *self, const gchar *change_id,
+                                  GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
 {
   g_autofree gchar *path = NULL;
-  g_autoptr(JsonObject) response = NULL;
-  JsonObject *result;
 
+  // Changes are polled for progress, so never use a cached response.
   path = g_strdup_printf ("/v2/changes/%s", change_id);
-  response = call_sync (self, "GET", path, NULL, cancellable, error);
-  if (response == NULL)
-    return NULL;
-  result = json_object_get_object_member (response, "result");
-  if (result == NULL)
-    {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to %s", path);
-      return NULL;
-    }
+  call_async (self, "GET", path, NULL, FALSE, cancellable, callback, user_data);
+}
+
+JsonObject *
+cc_snapd_client_get_change_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
+{
+  JsonObject *change;
+
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  change = get_result (result, error);
+
+  // Asynchronous changes are only applied once they are ready, GETs sent
+  // while they were running saw the old state.
+  if (change != NULL && json_object_get_boolean_member (change, "ready"))
+    invalidate_cache (self);
 
-  return json_object_ref (result);
+  return change;
+}
+
+void
+cc_snapd_client_get_all_connections_async (CcSnapdClient *self,
+                                           GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  call_async (self, "GET", "/v2/connections?select=all", NULL, TRUE, cancellable, callback, user_data);
 }
 
 gboolean
-cc_snapd_client_get_all_connections_sync (CcSnapdClient *self,
-                                          JsonArray **plugs, JsonArray **slots,
-                                          GCancellable *cancellable, GError **error)
+cc_snapd_client_get_all_connections_finish (CcSnapdClient *self,
+                                            GAsyncResult *result,
+                                            JsonArray **plugs, JsonArray **slots,
+                                            GError **error)
 {
-  g_autoptr(JsonObject) response = NULL;
-  JsonObject *result;
+  g_autoptr(JsonObject) object = NULL;
 
-  response = call_sync (self, "GET", "/v2/connections?select=all", NULL, cancellable, error);
-  if (response == NULL)
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  object = get_result (result, error);
+  if (object == NULL)
     return FALSE;
-  result = json_object_get_object_member (response, "result");
-  if (result == NULL)
-    {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to /v2/connections");
-      return FALSE;
-    }
 
-  *plugs = json_array_ref (json_object_get_array_member (result, "plugs"));
-  *slots = json_array_ref (json_object_get_array_member (result, "slots"));
+  *plugs = json_array_ref (json_object_get_array_member (object, "plugs"));
+  *slots = json_array_ref (json_object_get_array_member (object, "slots"));
   return TRUE;
 }
 
+void
+cc_snapd_client_connect_interface_async (CcSnapdClient *self,
+                                         const gchar *plug_snap, const gchar *plug_name,
+                                         const gchar *slot_snap, const gchar *slot_name,
+                                         GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  call_interfaces_async (self, "connect", plug_snap, plug_name, slot_snap, slot_name, cancellable, callback, user_data);
+}
+
 gchar *
-cc_snapd_client_connect_interface_sync (CcSnapdClient *self,
-                                        const gchar *plug_snap, const gchar *plug_name,
-                                        const gchar *slot_snap, const gchar *slot_name,
-                                        GCancellable *cancellable, GError **error)
+cc_snapd_client_connect_interface_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return call_interfaces_finish (result, error);
+}
+
+void
+cc_snapd_client_disconnect_interface_async (CcSnapdClient *self,
+                                            const gchar *plug_snap, const gchar *plug_name,
+                                            const gchar *slot_snap, const gchar *slot_name,
+                                            GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
 {
-  return call_interfaces_sync (self, "connect", plug_snap, plug_name, slot_snap, slot_name, cancellable, error);
+  call_interfaces_async (self, "disconnect", plug_snap, plug_name, slot_snap, slot_name, cancellable, callback, user_data);
 }
 
 gchar *
-cc_snapd_client_disconnect_interface_sync (CcSnapdClient *self,
-                                           const gchar *plug_snap, const gchar *plug_name,
-                                           const gchar *slot_snap, const gchar *slot_name,
-                                           GCancellable *cancellable, GError **error)
+cc_snapd_client_disconnect_interface_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
 {
-  return call_interfaces_sync (self, "disconnect", plug_snap, plug_name, slot_snap, slot_name, cancellable, error);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return call_interfaces_finish (result, error);
 }
@@ -20,43 +20,296 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "globs.h"
 
-/* parse mime/globs and return a string->string hash table */
-GHashTable *
-parse_globs (void)
+/* Lookups are served straight from the mmap-ed binary shared-mime-info
+ * cache, see "mime.cache" in the shared-mime-info specification. Only
+ * the few types an application handles are ever resolved, so the text
+ * databases are never parsed.
+ */
+
+#define MIME_CACHE_MAJOR_VERSION 1
+#define MIME_CACHE_MAX_DEPTH 64
+
+/* Offsets of the header fields we use */
+#define HEADER_LITERAL_LIST_OFFSET 12
+#define HEADER_REVERSE_SUFFIX_TREE_OFFSET 16
+#define HEADER_GLOB_LIST_OFFSET 20
+#define HEADER_SIZE 40
+
+typedef struct
+{
+  GMappedFile *file;
+  const guint8 *data;
+  gsize         size;
+} MimeCache;
+
+struct _GlobsCache
+{
+  GPtrArray  *caches;
+  /* type → glob, NULL values for types without a glob */
+  GHashTable *lookups;
+};
+
+typedef struct
+{
+  const gchar *type;
+  gchar       *glob;
+  guint        weight;
+} GlobMatch;
+
+static void
+mime_cache_free (MimeCache *cache)
+{
+  g_mapped_file_unref (cache->file);
+  g_free (cache);
+}
+
+static gboolean
+mime_cache_get_card32 (MimeCache *cache,
+                       guint32    offset,
+                       guint32   *value)
+{
+  guint32 be;
+
+  if (cache->size < sizeof (be) || offset > cache->size - sizeof (be))
+    return FALSE;
+
+  memcpy (&be, cache->data + offset, sizeof (be));
+  *value = GUINT32_FROM_BE (be);
+
+  return TRUE;
+}
+
+static const gchar *
+mime_cache_get_string (MimeCache *cache,
+                       guint32    offset)
+{
+  if (offset >= cache->size)
+    return NULL;
+
+  if (memchr (cache->data + offset, '\0', cache->size - offset) == NULL)
+    return NULL;
+
+  return (const gchar *) cache->data + offset;
+}
+
+static MimeCache *
+mime_cache_new (const gchar *data_dir)
+{
+  g_autofree gchar *path = NULL;
+  g_autoptr(GError) error = NULL;
+  GMappedFile *file;
+  MimeCache *cache;
+
+  path = g_build_filename (data_dir, "mime", "mime.cache", NULL);
+  file = g_mapped_file_new (path, FALSE, &error);
+  if (file == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_debug ("Failed to map %s: %s", path, error->message);
+      return NULL;
+    }
+
+  cache = g_new0 (MimeCache, 1);
+  cache->file = file;
+  cache->data = (const guint8 *) g_mapped_file_get_contents (file);
+  cache->size = g_mapped_file_get_length (file);
+
+  if (cache->size < HEADER_SIZE ||
+      GUINT16_FROM_BE (*(guint16 *) cache->data) != MIME_CACHE_MAJOR_VERSION)
+    {
+      g_debug ("Ignoring %s: unsupported mime cache format", path);
+      mime_cache_free (cache);
+      return NULL;
+    }
+
+  return cache;
+}
+
+static void
+glob_match_offer (GlobMatch   *match,
+                  const gchar *glob,
+                  guint32      weight_and_case)
+{
+  guint weight = weight_and_case & 0xff;
+
+  if (match->glob != NULL && weight <= match->weight)
+    return;
+
+  g_free (match->glob);
+  match->glob = g_strdup (glob);
+  match->weight = weight;
+}
+
+/* LiteralList and GlobList share the same layout */
+static void
+mime_cache_match_list (MimeCache *cache,
+                       guint32    header_offset,
+                       GlobMatch *match)
+{
+  guint32 list_offset, n_entries, i;
+
+  if (!mime_cache_get_card32 (cache, header_offset, &list_offset) ||
+      !mime_cache_get_card32 (cache, list_offset, &n_entries))
+    return;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      guint32 entry = list_offset + 4 + 12 * i;
+      guint32 glob_offset, type_offset, weight;
+      const gchar *type, *glob;
+
+      if (!mime_cache_get_card32 (cache, entry, &glob_offset) ||
+          !mime_cache_get_card32 (cache, entry + 4, &type_offset) ||
+          !mime_cache_get_card32 (cache, entry + 8, &weight))
+        return;
+
+      type = mime_cache_get_string (cache, type_offset);
+      if (g_strcmp0 (type, match->type) != 0)
+        continue;
+
+      glob = mime_cache_get_string (cache, glob_offset);
+      if (glob != NULL)
+        glob_match_offer (match, glob, weight);
+    }
+}
+
+/* Walks the reverse suffix tree, accumulating the characters from the end
+ * of the filename backwards in @suffix, until a leaf for @match->type is
+ * reached. The leaf then stands for the glob "*<suffix reversed>".
+ */
+static void
+mime_cache_match_suffix_nodes (MimeCache *cache,
+                               guint32    n_nodes,
+                               guint32    first_node,
+                               GString   *suffix,
+                               guint      depth,
+                               GlobMatch *match)
+{
+  guint32 i;
+
+  if (depth > MIME_CACHE_MAX_DEPTH)
+    return;
+
+  for (i = 0; i < n_nodes; i++)
+    {
+      guint32 node = first_node + 12 * i;
+      guint32 character, n_children, first_child;
+      gsize len;
+
+      if (!mime_cache_get_card32 (cache, node, &character) ||
+          !mime_cache_get_card32 (cache, node + 4, &n_children) ||
+          !mime_cache_get_card32 (cache, node + 8, &first_child))
+        return;
+
+      if (character == 0)
+        {
+          g_autofree gchar *reversed = NULL;
+          g_autofree gchar *glob = NULL;
+
+          /* Leaf: n_children is the type offset, first_child the weight */
+          if (g_strcmp0 (mime_cache_get_string (cache, n_children), match->type) != 0)
+            continue;
+
+          reversed = g_utf8_strreverse (suffix->str, suffix->len);
+          glob = g_strconcat ("*", reversed, NULL);
+          glob_match_offer (match, glob, first_child);
+          continue;
+        }
+
+      if (!g_unichar_validate (character))
+        continue;
+
+      len = suffix->len;
+      g_string_append_unichar (suffix, character);
+      mime_cache_match_suffix_nodes (cache, n_children, first_child, suffix, depth + 1, match);
+      g_string_truncate (suffix, len);
+    }
+}
+
+static void
+mime_cache_match_suffix_tree (MimeCache *cache,
+                              GlobMatch *match)
+{
+  g_autoptr(GString) suffix = NULL;
+  guint32 tree_offset, n_roots, first_root;
+
+  if (!mime_cache_get_card32 (cache, HEADER_REVERSE_SUFFIX_TREE_OFFSET, &tree_offset) ||
+      !mime_cache_get_card32 (cache, tree_offset, &n_roots) ||
+      !mime_cache_get_card32 (cache, tree_offset + 4, &first_root))
+    return;
+
+  suffix = g_string_new (NULL);
+  mime_cache_match_suffix_nodes (cache, n_roots, first_root, suffix, 0, match);
+}
+
+/* map the shared-mime-info caches of all system data dirs */
+GlobsCache *
+globs_cache_new (void)
 {
-  GHashTable *globs;
+  GlobsCache *globs;
   const gchar * const *dirs;
   gint i;
 
-  globs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  globs = g_new0 (GlobsCache, 1);
+  globs->caches = g_ptr_array_new_with_free_func ((GDestroyNotify) mime_cache_free);
+  globs->lookups = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
   dirs = g_get_system_data_dirs ();
 
   for (i = 0; dirs[i]; i++)
     {
-      g_autofree gchar *file = g_build_filename (dirs[i], "mime", "globs", NULL);
-      g_autofree gchar *contents = NULL;
+      MimeCache *cache = mime_cache_new (dirs[i]);
 
-      if (g_file_get_contents (file, &contents, NULL, NULL))
-        {
-          g_auto(GStrv) strv = NULL;
-          int i;
+      if (cache != NULL)
+        g_ptr_array_add (globs->caches, cache);
+    }
+
+  return globs;
+}
 
-          strv = g_strsplit (contents, "\n", 0);
-          for (i = 0; strv[i]; i++)
-            {
-              g_auto(GStrv) parts = NULL;
+void
+globs_cache_free (GlobsCache *globs)
+{
+  g_ptr_array_unref (globs->caches);
+  g_hash_table_unref (globs->lookups);
+  g_free (globs);
+}
+
+/* return the highest-weighted glob registered for @type, or NULL */
+const gchar *
+globs_cache_lookup (GlobsCache  *globs,
+                    const gchar *type)
+{
+  gpointer glob = NULL;
+  guint i;
+
+  g_return_val_if_fail (globs != NULL, NULL);
+  g_return_val_if_fail (type != NULL, NULL);
 
-              if (strv[i][0] == '#' || strv[i][0] == '\0')
-                continue;
+  if (g_hash_table_lookup_extended (globs->lookups, type, NULL, &glob))
+    return glob;
 
-              parts = g_strsplit (strv[i], ":", 2);
-              g_hash_table_insert (globs, g_strdup (parts[0]), g_strdup (parts[1]));
-            }
+  for (i = 0; i < globs->caches->len; i++)
+    {
+      MimeCache *cache = g_ptr_array_index (globs->caches, i);
+      GlobMatch match = { type, NULL, 0 };
+
+      mime_cache_match_suffix_tree (cache, &match);
+      mime_cache_match_list (cache, HEADER_GLOB_LIST_OFFSET, &match);
+      mime_cache_match_list (cache, HEADER_LITERAL_LIST_OFFSET, &match);
+
+      if (match.glob != NULL)
+        {
+          glob = match.glob;
+          break;
         }
     }
 
-  return globs;
+  g_hash_table_insert (globs->lookups, g_strdup (type), glob);
+
+  return glob;
 }
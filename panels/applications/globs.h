@@ -24,6 +24,15 @@
 
 G_BEGIN_DECLS
 
-GHashTable* parse_globs (void);
+typedef struct _GlobsCache GlobsCache;
+
+GlobsCache*  globs_cache_new    (void);
+
+void         globs_cache_free   (GlobsCache  *globs);
+
+const gchar* globs_cache_lookup (GlobsCache  *globs,
+                                 const gchar *type);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GlobsCache, globs_cache_free)
 
 G_END_DECLS
@@ -26,13 +26,11 @@
 #include <glib/gi18n.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <stdlib.h>
 
 #include <ftw.h>
 
 #include "utils.h"
-#ifdef HAVE_SNAP
-#include "cc-snapd-client.h"
-#endif
 
 static gint
 ftw_remove_cb (const gchar       *path,
@@ -163,8 +161,45 @@ get_output_of (const gchar **argv)
   return g_steal_pointer (&output);
 }
 
-GKeyFile *
-get_flatpak_metadata (const gchar *app_id)
+/* Deployed metadata, keyed by the resolved deploy directory, which
+ * contains the commit, so an update gets a new entry.
+ */
+static GHashTable *flatpak_metadata_cache = NULL;
+
+static gchar *
+find_flatpak_deploy_dir (const gchar *app_id)
+{
+  g_autofree gchar *default_user_dir = NULL;
+  const gchar *installations[2];
+  gsize i;
+
+  installations[0] = g_getenv ("FLATPAK_USER_DIR");
+  if (installations[0] == NULL)
+    {
+      default_user_dir = g_build_filename (g_get_user_data_dir (), "flatpak", NULL);
+      installations[0] = default_user_dir;
+    }
+
+  installations[1] = g_getenv ("FLATPAK_SYSTEM_DIR");
+  if (installations[1] == NULL)
+    installations[1] = "/var/lib/flatpak";
+
+  for (i = 0; i < G_N_ELEMENTS (installations); i++)
+    {
+      g_autofree gchar *active = NULL;
+      gchar *deploy_dir;
+
+      active = g_build_filename (installations[i], "app", app_id, "current", "active", NULL);
+      deploy_dir = realpath (active, NULL);
+      if (deploy_dir != NULL)
+        return deploy_dir;
+    }
+
+  return NULL;
+}
+
+static GKeyFile *
+get_flatpak_metadata_from_info (const gchar *app_id)
 {
   const gchar *argv[5] = { "flatpak", "info", "-m", "app", NULL };
   g_autofree gchar *data = NULL;
@@ -187,6 +222,41 @@ get_flatpak_metadata (const gchar *app_id)
   return g_steal_pointer (&keyfile);
 }
 
+GKeyFile *
+get_flatpak_metadata (const gchar *app_id)
+{
+  g_autofree gchar *deploy_dir = NULL;
+  g_autofree gchar *path = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GKeyFile) keyfile = NULL;
+  GKeyFile *cached;
+
+  deploy_dir = find_flatpak_deploy_dir (app_id);
+
+  /* Not in one of the default installations, let flatpak find it */
+  if (deploy_dir == NULL)
+    return get_flatpak_metadata_from_info (app_id);
+
+  if (flatpak_metadata_cache == NULL)
+    flatpak_metadata_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_key_file_unref);
+
+  cached = g_hash_table_lookup (flatpak_metadata_cache, deploy_dir);
+  if (cached != NULL)
+    return g_key_file_ref (cached);
+
+  path = g_build_filename (deploy_dir, "metadata", NULL);
+  keyfile = g_key_file_new ();
+  if (!g_key_file_load_from_file (keyfile, path, 0, &error))
+    {
+      g_warning ("%s", error->message);
+      return NULL;
+    }
+
+  g_hash_table_insert (flatpak_metadata_cache, g_steal_pointer (&deploy_dir), g_key_file_ref (keyfile));
+
+  return g_steal_pointer (&keyfile);
+}
+
 guint64
 get_flatpak_app_size (const gchar *app_id)
 {
@@ -223,28 +293,6 @@ get_flatpak_app_size (const gchar *app_id)
   return (guint64)(val * factor);
 }
 
-guint64
-get_snap_app_size (const gchar *snap_name)
-{
-#ifdef HAVE_SNAP
-  g_autoptr(CcSnapdClient) client = NULL;
-  g_autoptr(JsonObject) snap = NULL;
-  g_autoptr(GError) error = NULL;
-
-  client = cc_snapd_client_new ();
-  snap = cc_snapd_client_get_snap_sync (client, snap_name, NULL, &error);
-  if (snap == NULL)
-    {
-      g_warning ("Failed to get snap size: %s", error->message);
-      return 0;
-    }
-
-  return json_object_get_int_member (snap, "installed-size");
-#else
-  return 0;
-#endif
-}
-
 char *
 get_app_id (GAppInfo *info)
 {
@@ -0,0 +1,462 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/* cc-search-providers.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "cc-search-providers"
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "cc-search-providers.h"
+#include "shell/cc-object-storage.h"
+
+#define SHELL_PROVIDER_GROUP "Shell Search Provider"
+
+/*
+ * Process-wide registry of the gnome-shell search providers, shared by the
+ * Search and Applications panels. The provider directories are scanned once
+ * and the result is kept until a directory monitor reports a change or the
+ * directory modification times no longer match the ones seen when loading.
+ */
+
+struct _CcSearchProviders
+{
+  GObject     parent_instance;
+
+  GPtrArray  *monitors;
+
+  GPtrArray  *providers;
+  GHashTable *providers_by_app_id;
+  guint64     stamp;
+  guint       generation;
+  gboolean    valid;
+
+  /* GTasks waiting on the in-flight load */
+  GPtrArray  *pending_tasks;
+};
+
+G_DEFINE_TYPE (CcSearchProviders, cc_search_providers, G_TYPE_OBJECT)
+
+typedef struct
+{
+  guint64 stamp;
+  guint   generation;
+} LoadData;
+
+static void
+search_provider_free (CcSearchProvider *provider)
+{
+  g_free (provider->app_id);
+  g_free (provider->desktop_id);
+  g_free (provider);
+}
+
+static gchar *
+get_providers_path (const gchar *system_dir)
+{
+  return g_build_filename (system_dir, "gnome-shell", "search-providers", NULL);
+}
+
+static guint64
+compute_stamp (void)
+{
+  const gchar * const *dirs;
+  guint64 stamp = 0;
+  gint i;
+
+  dirs = g_get_system_data_dirs ();
+
+  for (i = 0; dirs[i]; i++)
+    {
+      g_autofree gchar *path = get_providers_path (dirs[i]);
+      GStatBuf buf;
+
+      stamp *= 31;
+      if (g_stat (path, &buf) == 0)
+        stamp += (guint64) buf.st_mtime;
+    }
+
+  return stamp;
+}
+
+static CcSearchProvider *
+load_one_provider (GFile *file)
+{
+  g_autoptr(GKeyFile) keyfile = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *desktop_id = NULL;
+  g_autofree gchar *path = NULL;
+  CcSearchProvider *provider;
+
+  path = g_file_get_path (file);
+  keyfile = g_key_file_new ();
+  g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, &error);
+
+  if (error != NULL)
+    {
+      g_warning ("Error loading %s: %s - search provider will be ignored",
+                 path, error->message);
+      return NULL;
+    }
+
+  if (!g_key_file_has_group (keyfile, SHELL_PROVIDER_GROUP))
+    {
+      g_debug ("Shell search provider group missing from '%s', ignoring", path);
+      return NULL;
+    }
+
+  desktop_id = g_key_file_get_string (keyfile, SHELL_PROVIDER_GROUP, "DesktopId", &error);
+
+  if (error != NULL)
+    {
+      g_warning ("Unable to read desktop ID from %s: %s - search provider will be ignored",
+                 path, error->message);
+      return NULL;
+    }
+
+  provider = g_new0 (CcSearchProvider, 1);
+  provider->desktop_id = g_steal_pointer (&desktop_id);
+  if (g_str_has_suffix (provider->desktop_id, ".desktop"))
+    provider->app_id = g_strndup (provider->desktop_id, strlen (provider->desktop_id) - strlen (".desktop"));
+  else
+    provider->app_id = g_strdup (provider->desktop_id);
+  provider->default_disabled = g_key_file_get_boolean (keyfile, SHELL_PROVIDER_GROUP, "DefaultDisabled", NULL);
+
+  return provider;
+}
+
+static void
+load_providers_one_dir (GPtrArray    *providers,
+                        GHashTable   *seen,
+                        const gchar  *system_dir,
+                        GCancellable *cancellable)
+{
+  g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GFile) providers_location = NULL;
+  g_autofree gchar *providers_path = NULL;
+
+  providers_path = get_providers_path (system_dir);
+  providers_location = g_file_new_for_path (providers_path);
+
+  enumerator = g_file_enumerate_children (providers_location,
+                                          "standard::type,standard::name,standard::content-type",
+                                          G_FILE_QUERY_INFO_NONE,
+                                          cancellable, &error);
+
+  if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Error opening %s: %s - search provider configuration won't be possible",
+                   providers_path, error->message);
+      return;
+    }
+
+  while (TRUE)
+    {
+      CcSearchProvider *provider;
+      GFile *file = NULL;
+
+      if (!g_file_enumerator_iterate (enumerator, NULL, &file, cancellable, &error))
+        {
+          if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_warning ("Error reading from %s: %s - search providers might be missing",
+                       providers_path, error->message);
+          return;
+        }
+
+      if (file == NULL)
+        break;
+
+      provider = load_one_provider (file);
+      if (provider == NULL)
+        continue;
+
+      /* Directories earlier in XDG_DATA_DIRS take precedence */
+      if (g_hash_table_contains (seen, provider->app_id))
+        {
+          search_provider_free (provider);
+          continue;
+        }
+
+      g_hash_table_add (seen, provider->app_id);
+      g_ptr_array_add (providers, provider);
+    }
+}
+
+static GPtrArray *
+load_providers (GCancellable *cancellable)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GPtrArray *providers;
+  const gchar * const *dirs;
+  gint i;
+
+  providers = g_ptr_array_new_with_free_func ((GDestroyNotify) search_provider_free);
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+  dirs = g_get_system_data_dirs ();
+
+  for (i = 0; dirs[i]; i++)
+    load_providers_one_dir (providers, seen, dirs[i], cancellable);
+
+  return providers;
+}
+
+static void
+store_providers (CcSearchProviders *self,
+                 GPtrArray         *providers,
+                 guint64            stamp,
+                 guint              generation)
+{
+  guint i;
+
+  g_clear_pointer (&self->providers, g_ptr_array_unref);
+  self->providers = g_ptr_array_ref (providers);
+
+  g_hash_table_remove_all (self->providers_by_app_id);
+  for (i = 0; i < providers->len; i++)
+    {
+      CcSearchProvider *provider = g_ptr_array_index (providers, i);
+      g_hash_table_insert (self->providers_by_app_id, provider->app_id, provider);
+    }
+
+  self->stamp = stamp;
+  /* A monitor may have fired while we were loading */
+  self->valid = generation == self->generation;
+}
+
+static gboolean
+is_up_to_date (CcSearchProviders *self)
+{
+  return self->providers != NULL && self->valid && self->stamp == compute_stamp ();
+}
+
+static void
+load_providers_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  g_task_return_pointer (task, load_providers (cancellable), (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+load_providers_cb (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  CcSearchProviders *self = CC_SEARCH_PROVIDERS (source);
+  g_autoptr(GPtrArray) pending_tasks = NULL;
+  g_autoptr(GPtrArray) providers = NULL;
+  LoadData *data;
+  guint i;
+
+  data = g_task_get_task_data (G_TASK (result));
+  providers = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  store_providers (self, providers, data->stamp, data->generation);
+
+  pending_tasks = g_steal_pointer (&self->pending_tasks);
+  for (i = 0; i < pending_tasks->len; i++)
+    {
+      GTask *task = g_ptr_array_index (pending_tasks, i);
+      g_task_return_pointer (task, g_ptr_array_ref (providers), (GDestroyNotify) g_ptr_array_unref);
+    }
+}
+
+static void
+monitor_changed_cb (CcSearchProviders *self)
+{
+  self->generation++;
+  self->valid = FALSE;
+}
+
+static void
+cc_search_providers_finalize (GObject *object)
+{
+  CcSearchProviders *self = CC_SEARCH_PROVIDERS (object);
+
+  g_clear_pointer (&self->monitors, g_ptr_array_unref);
+  g_clear_pointer (&self->providers, g_ptr_array_unref);
+  g_clear_pointer (&self->providers_by_app_id, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_search_providers_parent_class)->finalize (object);
+}
+
+static void
+cc_search_providers_init (CcSearchProviders *self)
+{
+  const gchar * const *dirs;
+  gint i;
+
+  self->providers_by_app_id = g_hash_table_new (g_str_hash, g_str_equal);
+  self->monitors = g_ptr_array_new_with_free_func (g_object_unref);
+
+  dirs = g_get_system_data_dirs ();
+
+  for (i = 0; dirs[i]; i++)
+    {
+      g_autofree gchar *path = get_providers_path (dirs[i]);
+      g_autoptr(GFile) file = g_file_new_for_path (path);
+      g_autoptr(GError) error = NULL;
+      GFileMonitor *monitor;
+
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, &error);
+      if (monitor == NULL)
+        {
+          g_debug ("Failed to monitor %s: %s", path, error->message);
+          continue;
+        }
+
+      g_signal_connect_object (monitor, "changed", G_CALLBACK (monitor_changed_cb), self, G_CONNECT_SWAPPED);
+      g_ptr_array_add (self->monitors, monitor);
+    }
+}
+
+static void
+cc_search_providers_class_init (CcSearchProvidersClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_search_providers_finalize;
+}
+
+CcSearchProviders *
+cc_search_providers_get_default (void)
+{
+  g_autoptr(CcSearchProviders) self = NULL;
+
+  if (cc_object_storage_has_object (CC_OBJECT_SEARCH_PROVIDERS))
+    {
+      self = cc_object_storage_get_object (CC_OBJECT_SEARCH_PROVIDERS);
+    }
+  else
+    {
+      self = g_object_new (CC_TYPE_SEARCH_PROVIDERS, NULL);
+      cc_object_storage_add_object (CC_OBJECT_SEARCH_PROVIDERS, self);
+    }
+
+  return self;
+}
+
+/**
+ * cc_search_providers_load_async:
+ * @self: a #CcSearchProviders
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: callback to call when the providers are available
+ * @user_data: data to pass to @callback
+ *
+ * Retrieves the installed search providers, scanning the provider
+ * directories in a thread if they changed since the last scan. Concurrent
+ * calls share the same scan.
+ */
+void
+cc_search_providers_load_async (CcSearchProviders   *self,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_autoptr(GTask) load_task = NULL;
+  g_autoptr(GTask) task = NULL;
+  LoadData *data;
+
+  g_return_if_fail (CC_IS_SEARCH_PROVIDERS (self));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_search_providers_load_async);
+
+  if (is_up_to_date (self))
+    {
+      g_task_return_pointer (task, g_ptr_array_ref (self->providers), (GDestroyNotify) g_ptr_array_unref);
+      return;
+    }
+
+  if (self->pending_tasks != NULL)
+    {
+      g_ptr_array_add (self->pending_tasks, g_steal_pointer (&task));
+      return;
+    }
+
+  self->pending_tasks = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (self->pending_tasks, g_steal_pointer (&task));
+
+  data = g_new0 (LoadData, 1);
+  data->stamp = compute_stamp ();
+  data->generation = self->generation;
+
+  /* Not cancellable: the scan is shared by all callers */
+  load_task = g_task_new (self, NULL, load_providers_cb, NULL);
+  g_task_set_task_data (load_task, data, g_free);
+  g_task_run_in_thread (load_task, load_providers_thread);
+}
+
+/**
+ * cc_search_providers_load_finish:
+ * @self: a #CcSearchProviders
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Returns: (transfer container) (element-type CcSearchProvider): the
+ *   installed search providers
+ */
+GPtrArray *
+cc_search_providers_load_finish (CcSearchProviders  *self,
+                                 GAsyncResult       *result,
+                                 GError            **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * cc_search_providers_lookup:
+ * @self: a #CcSearchProviders
+ * @app_id: an application ID, without the .desktop suffix
+ *
+ * Looks up the search provider of @app_id, scanning the provider
+ * directories synchronously if they changed since the last scan.
+ *
+ * Returns: (transfer none) (nullable): the search provider, only valid
+ *   until the next call into @self
+ */
+const CcSearchProvider *
+cc_search_providers_lookup (CcSearchProviders *self,
+                            const gchar       *app_id)
+{
+  g_return_val_if_fail (CC_IS_SEARCH_PROVIDERS (self), NULL);
+  g_return_val_if_fail (app_id != NULL, NULL);
+
+  if (!is_up_to_date (self))
+    {
+      g_autoptr(GPtrArray) providers = NULL;
+      guint64 stamp = compute_stamp ();
+
+      providers = load_providers (NULL);
+      store_providers (self, providers, stamp, self->generation);
+    }
+
+  return g_hash_table_lookup (self->providers_by_app_id, app_id);
+}
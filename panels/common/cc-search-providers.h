@@ -0,0 +1,51 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/* cc-search-providers.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar    *app_id;
+  gchar    *desktop_id;
+  gboolean  default_disabled;
+} CcSearchProvider;
+
+#define CC_TYPE_SEARCH_PROVIDERS (cc_search_providers_get_type())
+G_DECLARE_FINAL_TYPE (CcSearchProviders, cc_search_providers, CC, SEARCH_PROVIDERS, GObject)
+
+CcSearchProviders      *cc_search_providers_get_default   (void);
+
+void                    cc_search_providers_load_async    (CcSearchProviders    *self,
+                                                           GCancellable         *cancellable,
+                                                           GAsyncReadyCallback   callback,
+                                                           gpointer              user_data);
+
+GPtrArray              *cc_search_providers_load_finish   (CcSearchProviders    *self,
+                                                           GAsyncResult         *result,
+                                                           GError              **error);
+
+const CcSearchProvider *cc_search_providers_lookup        (CcSearchProviders    *self,
+                                                           const gchar          *app_id);
+
+G_END_DECLS
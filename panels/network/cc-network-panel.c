@@ -32,6 +32,7 @@
 
 #include "cc-list-row.h"
 #include "cc-net-proxy-page.h"
+#include "cc-network-profiles.h"
 #include "net-device-bluetooth.h"
 #include "net-device-ethernet.h"
 #include "net-device-mobile.h"
@@ -60,10 +61,13 @@ struct _CcNetworkPanel
         GPtrArray        *mobile_devices;
         GPtrArray        *vpns;
         GHashTable       *nm_device_to_device;
+        GHashTable       *connection_to_vpn;
 
         NMClient         *client;
         MMManager        *modem_manager;
         gboolean          updating_device;
+        gboolean          profiles_busy;
+        AdwToast         *profiles_toast;
 
         /* widgets */
         GtkWidget        *box_bluetooth;
@@ -75,6 +79,7 @@ struct _CcNetworkPanel
         GtkWidget        *save_button;
         GtkWidget        *vpn_stack;
         GtkWidget        *toolbar_view;
+        AdwToastOverlay  *toast_overlay;
 
         /* wireless dialog stuff */
         CmdlineOperation  arg_operation;
@@ -209,12 +214,14 @@ cc_network_panel_dispose (GObject *object)
 
         g_clear_object (&self->client);
         g_clear_object (&self->modem_manager);
+        g_clear_object (&self->profiles_toast);
 
         g_clear_pointer (&self->bluetooth_devices, g_ptr_array_unref);
         g_clear_pointer (&self->ethernet_devices, g_ptr_array_unref);
         g_clear_pointer (&self->mobile_devices, g_ptr_array_unref);
         g_clear_pointer (&self->vpns, g_ptr_array_unref);
         g_clear_pointer (&self->nm_device_to_device, g_hash_table_destroy);
+        g_clear_pointer (&self->connection_to_vpn, g_hash_table_destroy);
 
         G_OBJECT_CLASS (cc_network_panel_parent_class)->dispose (object);
 }
@@ -389,7 +396,8 @@ wwan_panel_supports_modem (GDBusObject *object)
         return capability & supported_capabilities;
 }
 
-static void
+/* Returns %TRUE if a row was added for @device */
+static gboolean
 panel_add_device (CcNetworkPanel *self, NMDevice *device)
 {
         NMDeviceType type;
@@ -400,7 +408,7 @@ panel_add_device (CcNetworkPanel *self, NMDevice *device)
 
         /* does already exist */
         if (g_hash_table_lookup (self->nm_device_to_device, device) != NULL)
-                return;
+                return FALSE;
 
         type = nm_device_get_device_type (device);
 
@@ -421,7 +429,7 @@ panel_add_device (CcNetworkPanel *self, NMDevice *device)
                         if (self->modem_manager == NULL) {
                                 g_warning ("Cannot grab information for modem at %s: No ModemManager support",
                                            nm_device_get_udi (device));
-                                return;
+                                return FALSE;
                         }
 
                         modem_object = g_dbus_object_manager_get_object (G_DBUS_OBJECT_MANAGER (self->modem_manager),
@@ -429,12 +437,12 @@ panel_add_device (CcNetworkPanel *self, NMDevice *device)
                         if (modem_object == NULL) {
                                 g_warning ("Cannot grab information for modem at %s: Not found",
                                            nm_device_get_udi (device));
-                                return;
+                                return FALSE;
                         }
 
                         /* This will be handled by cellular panel */
                         if (wwan_panel_supports_modem (modem_object))
-                                return;
+                                return FALSE;
                 }
 
                 device_mobile = net_device_mobile_new (self->client, device, modem_object);
@@ -461,18 +469,20 @@ panel_add_device (CcNetworkPanel *self, NMDevice *device)
         case NM_DEVICE_TYPE_TUN:
         /* And the rest we simply cannot deal with currently. */
         default:
-                return;
+                return FALSE;
         }
+
+        return TRUE;
 }
 
-static void
+static gboolean
 panel_remove_device (CcNetworkPanel *self, NMDevice *device)
 {
         GtkWidget *net_device;
 
         net_device = g_hash_table_lookup (self->nm_device_to_device, device);
         if (net_device == NULL)
-                return;
+                return FALSE;
 
         g_ptr_array_remove (self->bluetooth_devices, net_device);
         g_ptr_array_remove (self->ethernet_devices, net_device);
@@ -481,11 +491,10 @@ panel_remove_device (CcNetworkPanel *self, NMDevice *device)
 
         gtk_box_remove (GTK_BOX (gtk_widget_get_parent (net_device)), net_device);
 
-        /* update vpn widgets */
-        update_vpn_section (self);
-
         /* update device_bluetooth widgets */
         update_bluetooth_section (self);
+
+        return TRUE;
 }
 
 static void
@@ -531,8 +540,26 @@ device_managed_cb (CcNetworkPanel *self, GParamSpec *pspec, NMDevice *device)
         if (!nm_device_get_managed (device))
                 return;
 
-        panel_add_device (self, device);
-        panel_refresh_device_titles (self);
+        /* titles only depend on the devices we show */
+        if (panel_add_device (self, device))
+                panel_refresh_device_titles (self);
+}
+
+/* Returns %TRUE if a row was added for @device, the caller is
+ * responsible for refreshing the device titles afterwards */
+static gboolean
+panel_add_device_if_managed (CcNetworkPanel *self, NMDevice *device)
+{
+        if (nm_device_get_managed (device))
+                return panel_add_device (self, device);
+
+        /* wait for it to become managed; devices are cold-plugged again
+         * every time the panel is mapped, so only connect once */
+        if (g_signal_handler_find (device, G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
+                                   0, 0, NULL, G_CALLBACK (device_managed_cb), self) == 0)
+                g_signal_connect_object (device, "notify::managed", G_CALLBACK (device_managed_cb), self, G_CONNECT_SWAPPED);
+
+        return FALSE;
 }
 
 static void
@@ -540,18 +567,16 @@ device_added_cb (CcNetworkPanel *self, NMDevice *device)
 {
         g_debug ("New device added");
 
-        if (nm_device_get_managed (device))
-                device_managed_cb (self, NULL, device);
-        else
-                g_signal_connect_object (device, "notify::managed", G_CALLBACK (device_managed_cb), self, G_CONNECT_SWAPPED);
+        if (panel_add_device_if_managed (self, device))
+                panel_refresh_device_titles (self);
 }
 
 static void
 device_removed_cb (CcNetworkPanel *self, NMDevice *device)
 {
         g_debug ("Device removed");
-        panel_remove_device (self, device);
-        panel_refresh_device_titles (self);
+        if (panel_remove_device (self, device))
+                panel_refresh_device_titles (self);
 
         g_signal_handlers_disconnect_by_func (device,
                                               G_CALLBACK (device_managed_cb),
@@ -562,6 +587,7 @@ static void
 manager_running (CcNetworkPanel *self)
 {
         const GPtrArray *devices;
+        gboolean added = FALSE;
         int i;
 
         /* clear all devices we added */
@@ -578,40 +604,41 @@ manager_running (CcNetworkPanel *self)
         }
         for (i = 0; i < devices->len; i++) {
                 NMDevice *device = g_ptr_array_index (devices, i);
-                device_added_cb (self, device);
+                added |= panel_add_device_if_managed (self, device);
         }
+
+        /* disambiguate the names once for the whole batch */
+        if (added)
+                panel_refresh_device_titles (self);
 out:
-        panel_refresh_device_titles (self);
 
         g_debug ("Calling handle_argv() after cold-plugging devices");
         handle_argv (self);
 }
 
-static void
+static gboolean
 panel_add_vpn_device (CcNetworkPanel *self, NMConnection *connection)
 {
         NetVpn *net_vpn;
-        guint i;
 
         /* does already exist */
-        for (i = 0; i < self->vpns->len; i++) {
-                net_vpn = g_ptr_array_index (self->vpns, i);
-                if (net_vpn_get_connection (net_vpn) == connection)
-                        return;
-        }
+        if (g_hash_table_contains (self->connection_to_vpn, connection))
+                return FALSE;
 
         net_vpn = net_vpn_new (self->client, connection);
         gtk_list_box_append (GTK_LIST_BOX (self->box_vpn), GTK_WIDGET (net_vpn));
 
         /* store in the devices array */
         g_ptr_array_add (self->vpns, net_vpn);
+        g_hash_table_insert (self->connection_to_vpn, connection, net_vpn);
 
-        /* update vpn widgets */
-        update_vpn_section (self);
+        return TRUE;
 }
 
-static void
-add_connection (CcNetworkPanel *self, NMConnection *connection)
+/* Returns %TRUE if a VPN row was added for @connection, the caller is
+ * responsible for updating the VPN section afterwards */
+static gboolean
+panel_add_connection (CcNetworkPanel *self, NMConnection *connection)
 {
         NMSettingConnection *s_con;
         const gchar *type;
@@ -620,32 +647,38 @@ add_connection (CcNetworkPanel *self, NMConnection *connection)
                                                                   NM_TYPE_SETTING_CONNECTION));
         type = nm_setting_connection_get_connection_type (s_con);
         if (g_strcmp0 (type, "vpn") != 0 && g_strcmp0 (type, "wireguard") != 0)
-                return;
+                return FALSE;
 
         /* Don't add the libvirtd bridge to the UI */
         if (g_strcmp0 (nm_setting_connection_get_interface_name (s_con), "virbr0") == 0)
-                return;
+                return FALSE;
 
         g_debug ("add %s/%s remote connection: %s",
                  type, g_type_name_from_instance ((GTypeInstance*)connection),
                  nm_connection_get_path (connection));
-        panel_add_vpn_device (self, connection);
+        return panel_add_vpn_device (self, connection);
+}
+
+static void
+client_connection_added_cb (CcNetworkPanel *self, NMConnection *connection)
+{
+        if (panel_add_connection (self, connection))
+                update_vpn_section (self);
 }
 
 static void
 client_connection_removed_cb (CcNetworkPanel *self, NMConnection *connection)
 {
-        guint i;
+        NetVpn *vpn;
 
-        for (i = 0; i < self->vpns->len; i++) {
-                NetVpn *vpn = g_ptr_array_index (self->vpns, i);
-                if (net_vpn_get_connection (vpn) == connection) {
-                        g_ptr_array_remove (self->vpns, vpn);
-                        gtk_list_box_remove (GTK_LIST_BOX (self->box_vpn), GTK_WIDGET (vpn));
-                        update_vpn_section (self);
-                        return;
-                }
-        }
+        vpn = g_hash_table_lookup (self->connection_to_vpn, connection);
+        if (vpn == NULL)
+                return;
+
+        g_hash_table_remove (self->connection_to_vpn, connection);
+        g_ptr_array_remove (self->vpns, vpn);
+        gtk_list_box_remove (GTK_LIST_BOX (self->box_vpn), GTK_WIDGET (vpn));
+        update_vpn_section (self);
 }
 
 static void
@@ -677,20 +710,314 @@ create_connection_cb (CcNetworkPanel *self)
 {
         NetConnectionEditor *editor;
 
+        /* NetworkManager is still being loaded */
+        if (self->client == NULL)
+                return;
+
         editor = net_connection_editor_new (NULL, NULL, NULL, self->client);
         gtk_window_set_transient_for (GTK_WINDOW (editor),
                                       GTK_WINDOW (gtk_widget_get_native (GTK_WIDGET (self))));
         gtk_window_present (GTK_WINDOW (editor));
 }
 
+static void
+update_profiles_actions (CcNetworkPanel *self)
+{
+        gboolean enabled = self->client != NULL && !self->profiles_busy;
+
+        gtk_widget_action_set_enabled (GTK_WIDGET (self), "network.import-profiles", enabled);
+        gtk_widget_action_set_enabled (GTK_WIDGET (self), "network.export-profiles",
+                                       enabled && cc_network_profiles_can_export ());
+}
+
+static void
+show_profiles_toast (CcNetworkPanel *self,
+                     const gchar    *title,
+                     gboolean        in_progress)
+{
+        if (self->profiles_toast) {
+                adw_toast_dismiss (self->profiles_toast);
+                g_clear_object (&self->profiles_toast);
+        }
+
+        self->profiles_toast = adw_toast_new (title);
+
+        /* Progress toasts stay until they are replaced by the result */
+        if (in_progress)
+                adw_toast_set_timeout (self->profiles_toast, 0);
+
+        adw_toast_overlay_add_toast (self->toast_overlay, g_object_ref (self->profiles_toast));
+}
+
+static void
+import_profiles_progress_cb (guint    n_done,
+                             guint    n_total,
+                             gpointer user_data)
+{
+        CcNetworkPanel *self = CC_NETWORK_PANEL (user_data);
+        g_autofree gchar *done = NULL;
+        g_autofree gchar *total = NULL;
+        g_autofree gchar *title = NULL;
+
+        if (!self->profiles_toast)
+                return;
+
+        done = g_strdup_printf ("%u", n_done);
+        total = g_strdup_printf ("%u", n_total);
+        /* Translators: The first placeholder is the number of profiles processed so far, the second one the number of profiles found */
+        title = g_strdup_printf (_("Importing profiles… %s of %s"), done, total);
+        adw_toast_set_title (self->profiles_toast, title);
+}
+
+static void
+import_profiles_ready_cb (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+        CcNetworkPanel *self;
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *title = NULL;
+        guint n_imported = 0;
+        guint n_failed = 0;
+
+        if (!cc_network_profiles_import_finish (result, &n_imported, &n_failed, &error) &&
+            g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                return;
+
+        self = CC_NETWORK_PANEL (user_data);
+        self->profiles_busy = FALSE;
+        update_profiles_actions (self);
+
+        if (error) {
+                g_warning ("Failed to import connection profiles: %s", error->message);
+                title = g_strdup_printf (_("Failed to import profiles: %s"), error->message);
+        } else if (n_failed > 0) {
+                title = g_strdup_printf (ngettext ("Imported %u profile, %u failed",
+                                                   "Imported %u profiles, %u failed",
+                                                   n_imported),
+                                         n_imported, n_failed);
+        } else {
+                title = g_strdup_printf (ngettext ("Imported %u profile",
+                                                   "Imported %u profiles",
+                                                   n_imported),
+                                         n_imported);
+        }
+
+        show_profiles_toast (self, title, FALSE);
+}
+
+static void
+import_folder_selected_cb (GObject      *source_object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+        CcNetworkPanel *self;
+        g_autoptr(GFile) folder = NULL;
+        g_autoptr(GError) error = NULL;
+
+        folder = gtk_file_dialog_select_folder_finish (GTK_FILE_DIALOG (source_object), result, &error);
+        if (!folder) {
+                if (!g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_CANCELLED) &&
+                    !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+                        g_warning ("Failed to select a folder: %s", error->message);
+                return;
+        }
+
+        self = CC_NETWORK_PANEL (user_data);
+        if (self->profiles_busy)
+                return;
+
+        self->profiles_busy = TRUE;
+        update_profiles_actions (self);
+        show_profiles_toast (self, _("Importing profiles…"), TRUE);
+
+        cc_network_profiles_import_async (self->client,
+                                          folder,
+                                          cc_panel_get_cancellable (CC_PANEL (self)),
+                                          import_profiles_progress_cb,
+                                          self,
+                                          import_profiles_ready_cb,
+                                          self);
+}
+
+static void
+export_profiles_ready_cb (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+        CcNetworkPanel *self;
+        g_autoptr(GError) error = NULL;
+        g_autofree gchar *title = NULL;
+        guint n_exported = 0;
+        guint n_skipped = 0;
+
+        if (!cc_network_profiles_export_finish (result, &n_exported, &n_skipped, &error) &&
+            g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                return;
+
+        self = CC_NETWORK_PANEL (user_data);
+        self->profiles_busy = FALSE;
+        update_profiles_actions (self);
+
+        if (error) {
+                g_warning ("Failed to export connection profiles: %s", error->message);
+                title = g_strdup_printf (_("Failed to export profiles: %s"), error->message);
+        } else if (n_skipped > 0) {
+                title = g_strdup_printf (ngettext ("Exported %u profile, %u skipped as files already exist",
+                                                   "Exported %u profiles, %u skipped as files already exist",
+                                                   n_exported),
+                                         n_exported, n_skipped);
+        } else {
+                title = g_strdup_printf (ngettext ("Exported %u profile",
+                                                   "Exported %u profiles",
+                                                   n_exported),
+                                         n_exported);
+        }
+
+        show_profiles_toast (self, title, FALSE);
+}
+
+static void
+export_folder_selected_cb (GObject      *source_object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+        CcNetworkPanel *self;
+        g_autoptr(GFile) folder = NULL;
+        g_autoptr(GError) error = NULL;
+
+        folder = gtk_file_dialog_select_folder_finish (GTK_FILE_DIALOG (source_object), result, &error);
+        if (!folder) {
+                if (!g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_CANCELLED) &&
+                    !g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+                        g_warning ("Failed to select a folder: %s", error->message);
+                return;
+        }
+
+        self = CC_NETWORK_PANEL (user_data);
+        if (self->profiles_busy)
+                return;
+
+        self->profiles_busy = TRUE;
+        update_profiles_actions (self);
+        show_profiles_toast (self, _("Exporting profiles…"), TRUE);
+
+        cc_network_profiles_export_async (self->client,
+                                          folder,
+                                          cc_panel_get_cancellable (CC_PANEL (self)),
+                                          export_profiles_ready_cb,
+                                          self);
+}
+
+static void
+select_profiles_folder (CcNetworkPanel      *self,
+                        const gchar         *title,
+                        GAsyncReadyCallback  callback)
+{
+        g_autoptr(GtkFileDialog) file_dialog = NULL;
+
+        file_dialog = gtk_file_dialog_new ();
+        gtk_file_dialog_set_title (file_dialog, title);
+        gtk_file_dialog_set_modal (file_dialog, TRUE);
+
+        gtk_file_dialog_select_folder (file_dialog,
+                                       GTK_WINDOW (gtk_widget_get_native (GTK_WIDGET (self))),
+                                       cc_panel_get_cancellable (CC_PANEL (self)),
+                                       callback,
+                                       self);
+}
+
+static void
+import_profiles_cb (GtkWidget  *widget,
+                    const char *action_name,
+                    GVariant   *parameter)
+{
+        select_profiles_folder (CC_NETWORK_PANEL (widget), _("Import Profiles"), import_folder_selected_cb);
+}
+
+static void
+export_profiles_cb (GtkWidget  *widget,
+                    const char *action_name,
+                    GVariant   *parameter)
+{
+        select_profiles_folder (CC_NETWORK_PANEL (widget), _("Export Profiles"), export_folder_selected_cb);
+}
+
+static void
+set_client (CcNetworkPanel *self,
+            NMClient       *client)
+{
+        const GPtrArray *connections;
+        guint i;
+
+        self->client = client;
+
+        g_signal_connect_object (self->client, "notify::nm-running" ,
+                                 G_CALLBACK (manager_running), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->client, "notify::active-connections",
+                                 G_CALLBACK (active_connections_changed), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->client, "device-added",
+                                 G_CALLBACK (device_added_cb), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->client, "device-removed",
+                                 G_CALLBACK (device_removed_cb), self, G_CONNECT_SWAPPED);
+
+        /* add remote settings such as VPN settings as virtual devices */
+        g_signal_connect_object (self->client, NM_CLIENT_CONNECTION_ADDED,
+                                 G_CALLBACK (client_connection_added_cb), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->client, NM_CLIENT_CONNECTION_REMOVED,
+                                 G_CALLBACK (client_connection_removed_cb), self, G_CONNECT_SWAPPED);
+
+        /* Cold-plug existing connections */
+        connections = nm_client_get_connections (self->client);
+        if (connections) {
+                for (i = 0; i < connections->len; i++)
+                        panel_add_connection (self, connections->pdata[i]);
+        }
+        update_vpn_section (self);
+
+        update_profiles_actions (self);
+
+        g_debug ("Calling handle_argv() after cold-plugging connections");
+        handle_argv (self);
+
+        /* the panel was mapped before NetworkManager was loaded */
+        if (gtk_widget_get_mapped (GTK_WIDGET (self)))
+                panel_check_network_manager_version (self);
+}
+
+static void
+client_ready_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+        g_autoptr(GError) error = NULL;
+        NMClient *client;
+
+        client = cc_object_storage_init_object_finish (result, &error);
+        if (client == NULL) {
+                if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                        g_warning ("Error creating NetworkManager client: %s",
+                                   error->message);
+                return;
+        }
+
+        set_client (CC_NETWORK_PANEL (user_data), client);
+}
+
 static void
 cc_network_panel_map (GtkWidget *widget)
 {
+        CcNetworkPanel *self = CC_NETWORK_PANEL (widget);
+
         GTK_WIDGET_CLASS (cc_network_panel_parent_class)->map (widget);
 
+        /* devices are cold-plugged once NetworkManager is loaded */
+        if (self->client == NULL)
+                return;
+
         /* is the user compiling against a new version, but not running
          * the daemon? */
-        panel_check_network_manager_version (CC_NETWORK_PANEL (widget));
+        panel_check_network_manager_version (self);
 }
 
 
@@ -722,9 +1049,13 @@ cc_network_panel_class_init (CcNetworkPanelClass *klass)
         gtk_widget_class_bind_template_child (widget_class, CcNetworkPanel, proxy_row);
         gtk_widget_class_bind_template_child (widget_class, CcNetworkPanel, vpn_stack);
         gtk_widget_class_bind_template_child (widget_class, CcNetworkPanel, toolbar_view);
+        gtk_widget_class_bind_template_child (widget_class, CcNetworkPanel, toast_overlay);
 
         gtk_widget_class_bind_template_callback (widget_class, create_connection_cb);
 
+        gtk_widget_class_install_action (widget_class, "network.import-profiles", NULL, import_profiles_cb);
+        gtk_widget_class_install_action (widget_class, "network.export-profiles", NULL, export_profiles_cb);
+
         g_type_ensure (CC_TYPE_LIST_ROW);
         g_type_ensure (CC_TYPE_NET_PROXY_PAGE);
 }
@@ -734,8 +1065,6 @@ cc_network_panel_init (CcNetworkPanel *self)
 {
         g_autoptr(GDBusConnection) system_bus = NULL;
         g_autoptr(GError) error = NULL;
-        const GPtrArray *connections;
-        guint i;
 
         g_resources_register (cc_network_get_resource ());
 
@@ -746,24 +1075,10 @@ cc_network_panel_init (CcNetworkPanel *self)
         self->mobile_devices = g_ptr_array_new ();
         self->vpns = g_ptr_array_new ();
         self->nm_device_to_device = g_hash_table_new (g_direct_hash, g_direct_equal);
+        self->connection_to_vpn = g_hash_table_new (g_direct_hash, g_direct_equal);
 
-        /* Create and store a NMClient instance if it doesn't exist yet */
-        if (!cc_object_storage_has_object (CC_OBJECT_NMCLIENT)) {
-                g_autoptr(NMClient) client = nm_client_new (NULL, NULL);
-                cc_object_storage_add_object (CC_OBJECT_NMCLIENT, client);
-        }
-
-        /* use NetworkManager client */
-        self->client = cc_object_storage_get_object (CC_OBJECT_NMCLIENT);
-
-        g_signal_connect_object (self->client, "notify::nm-running" ,
-                                 G_CALLBACK (manager_running), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->client, "notify::active-connections",
-                                 G_CALLBACK (active_connections_changed), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->client, "device-added",
-                                 G_CALLBACK (device_added_cb), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->client, "device-removed",
-                                 G_CALLBACK (device_removed_cb), self, G_CONNECT_SWAPPED);
+        /* enabled once NetworkManager is loaded */
+        update_profiles_actions (self);
 
         /* Setup ModemManager client */
         system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
@@ -780,19 +1095,13 @@ cc_network_panel_init (CcNetworkPanel *self)
                                    error->message);
         }
 
-        /* add remote settings such as VPN settings as virtual devices */
-        g_signal_connect_object (self->client, NM_CLIENT_CONNECTION_ADDED,
-                                 G_CALLBACK (add_connection), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->client, NM_CLIENT_CONNECTION_REMOVED,
-                                 G_CALLBACK (client_connection_removed_cb), self, G_CONNECT_SWAPPED);
-
-        /* Cold-plug existing connections */
-        connections = nm_client_get_connections (self->client);
-        if (connections) {
-                for (i = 0; i < connections->len; i++)
-                        add_connection (self, connections->pdata[i]);
-        }
-
-        g_debug ("Calling handle_argv() after cold-plugging connections");
-        handle_argv (self);
+        /* use NetworkManager client */
+        if (cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
+                set_client (self, cc_object_storage_get_object (CC_OBJECT_NMCLIENT));
+        else
+                cc_object_storage_init_object_async (CC_OBJECT_NMCLIENT,
+                                                     NM_TYPE_CLIENT,
+                                                     cc_panel_get_cancellable (CC_PANEL (self)),
+                                                     client_ready_cb,
+                                                     self);
 }
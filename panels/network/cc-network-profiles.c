@@ -0,0 +1,857 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "cc-network-profiles"
+
+#include <config.h>
+#include <glib/gi18n.h>
+#include <string.h>
+
+#include "cc-network-profiles.h"
+
+/*
+ * Bulk import and export of connection profiles.
+ *
+ * Importing streams the files of a directory in batches. Each batch is
+ * parsed and normalized in a worker thread while the next one is being
+ * enumerated. The resulting connections are then added to
+ * NetworkManager with a bounded number of AddConnection2 calls in flight,
+ * so that hundreds of profiles don't turn into hundreds of serial D-Bus
+ * round-trips.
+ *
+ * Profiles are read from and written to NetworkManager keyfiles
+ * (".nmconnection"). WireGuard configuration files (".conf") are
+ * imported as well when libnm supports it. VPN plugin formats are left
+ * to the single-file import of the connection editor, since editor
+ * plugins cannot be used outside of the main thread.
+ */
+
+#define KEYFILE_SUFFIX        ".nmconnection"
+#define WIREGUARD_SUFFIX      ".conf"
+
+#define ENUMERATE_BATCH_SIZE  32
+#define MAX_PENDING_ADDS      8
+
+/* Import */
+
+typedef struct
+{
+  NMClient                      *client;
+  gchar                         *base_dir;
+  GFileEnumerator               *enumerator;
+
+  /* Parsed connections waiting to be added */
+  GQueue                         connections;
+
+  gboolean                       enumerated;
+  guint                          n_parsing;
+  guint                          n_adding;
+
+  guint                          n_total;
+  guint                          n_done;
+  guint                          n_imported;
+  guint                          n_failed;
+
+  GError                        *error;
+  gboolean                       returned;
+
+  CcNetworkProfilesProgressFunc  progress_func;
+  gpointer                       progress_data;
+} ImportData;
+
+static void
+import_data_free (ImportData *data)
+{
+  g_clear_object (&data->client);
+  g_clear_object (&data->enumerator);
+  g_clear_pointer (&data->base_dir, g_free);
+  g_queue_clear_full (&data->connections, g_object_unref);
+  g_clear_error (&data->error);
+  g_free (data);
+}
+
+typedef struct
+{
+  GPtrArray *files;
+  gchar     *base_dir;
+  guint      n_failed;
+} ParseBatch;
+
+static void
+parse_batch_free (ParseBatch *batch)
+{
+  g_clear_pointer (&batch->files, g_ptr_array_unref);
+  g_clear_pointer (&batch->base_dir, g_free);
+  g_free (batch);
+}
+
+static gboolean
+is_profile_file (const gchar *name)
+{
+#if NM_CHECK_VERSION (1,30,0)
+  if (g_str_has_suffix (name, KEYFILE_SUFFIX))
+    return TRUE;
+#endif
+#if NM_CHECK_VERSION (1,40,0)
+  if (g_str_has_suffix (name, WIREGUARD_SUFFIX))
+    return TRUE;
+#endif
+
+  return FALSE;
+}
+
+static NMConnection *
+parse_profile (GFile        *file,
+               const gchar  *base_dir,
+               GError      **error)
+{
+  g_autoptr(NMConnection) connection = NULL;
+  g_autofree gchar *path = NULL;
+
+  path = g_file_get_path (file);
+
+#if NM_CHECK_VERSION (1,30,0)
+  if (g_str_has_suffix (path, KEYFILE_SUFFIX))
+    {
+      g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+
+      if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, error))
+        return NULL;
+
+      connection = nm_keyfile_read (keyfile, base_dir, NM_KEYFILE_HANDLER_FLAGS_NONE, NULL, NULL, error);
+    }
+#endif
+#if NM_CHECK_VERSION (1,40,0)
+  if (g_str_has_suffix (path, WIREGUARD_SUFFIX))
+    connection = nm_conn_wireguard_import (path, error);
+#endif
+
+  if (!connection)
+    return NULL;
+
+  if (!nm_connection_normalize (connection, NULL, NULL, error))
+    return NULL;
+
+  return g_steal_pointer (&connection);
+}
+
+static void
+parse_batch_in_thread_cb (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+  g_autoptr(GPtrArray) connections = NULL;
+  ParseBatch *batch = task_data;
+  guint i;
+
+  connections = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < batch->files->len; i++)
+    {
+      GFile *file = g_ptr_array_index (batch->files, i);
+      g_autoptr(GError) error = NULL;
+      NMConnection *connection;
+
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      connection = parse_profile (file, batch->base_dir, &error);
+
+      if (!connection)
+        {
+          g_autofree gchar *name = g_file_get_basename (file);
+
+          g_warning ("Failed to import %s: %s", name, error->message);
+          batch->n_failed++;
+          continue;
+        }
+
+      g_ptr_array_add (connections, connection);
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&connections), (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+import_report_progress (GTask *task)
+{
+  ImportData *data = g_task_get_task_data (task);
+
+  /* The caller may be gone once the import is cancelled */
+  if (g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+    return;
+
+  if (data->progress_func)
+    data->progress_func (data->n_done, data->n_total, data->progress_data);
+}
+
+static void
+import_check_done (GTask *task)
+{
+  ImportData *data = g_task_get_task_data (task);
+
+  if (data->returned)
+    return;
+
+  if (!data->enumerated || data->n_parsing > 0 || data->n_adding > 0)
+    return;
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      data->returned = TRUE;
+      return;
+    }
+
+  if (data->error)
+    {
+      data->returned = TRUE;
+      g_task_return_error (task, g_steal_pointer (&data->error));
+      return;
+    }
+
+  if (!g_queue_is_empty (&data->connections))
+    return;
+
+  data->returned = TRUE;
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+add_connection_cb (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data);
+
+static void
+import_add_connections (GTask *task)
+{
+  ImportData *data = g_task_get_task_data (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+
+  while (data->n_adding < MAX_PENDING_ADDS &&
+         !g_queue_is_empty (&data->connections) &&
+         !g_cancellable_is_cancelled (cancellable))
+    {
+      g_autoptr(NMConnection) connection = g_queue_pop_head (&data->connections);
+
+      data->n_adding++;
+      nm_client_add_connection2 (data->client,
+                                 nm_connection_to_dbus (connection, NM_CONNECTION_SERIALIZE_ALL),
+                                 NM_SETTINGS_ADD_CONNECTION2_FLAG_TO_DISK,
+                                 NULL,
+                                 FALSE,
+                                 cancellable,
+                                 add_connection_cb,
+                                 g_object_ref (task));
+    }
+
+  import_check_done (task);
+}
+
+static void
+add_connection_cb (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(NMRemoteConnection) connection = NULL;
+  g_autoptr(GError) error = NULL;
+  ImportData *data = g_task_get_task_data (task);
+
+  connection = nm_client_add_connection2_finish (NM_CLIENT (source_object), result, NULL, &error);
+  data->n_adding--;
+
+  if (connection)
+    {
+      data->n_imported++;
+    }
+  else
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to add imported connection: %s", error->message);
+      data->n_failed++;
+    }
+
+  data->n_done++;
+  import_report_progress (task);
+
+  import_add_connections (task);
+}
+
+static void
+parse_batch_cb (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GPtrArray) connections = NULL;
+  ImportData *data = g_task_get_task_data (task);
+  ParseBatch *batch = g_task_get_task_data (G_TASK (result));
+  guint i;
+
+  connections = g_task_propagate_pointer (G_TASK (result), NULL);
+  data->n_parsing--;
+
+  if (connections)
+    {
+      for (i = 0; i < connections->len; i++)
+        g_queue_push_tail (&data->connections, g_object_ref (g_ptr_array_index (connections, i)));
+
+      data->n_failed += batch->n_failed;
+      data->n_done += batch->n_failed;
+      import_report_progress (task);
+    }
+
+  import_add_connections (task);
+}
+
+static void
+next_files_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GTask) parse_task = NULL;
+  g_autoptr(GError) error = NULL;
+  GFileEnumerator *enumerator = G_FILE_ENUMERATOR (source_object);
+  ImportData *data = g_task_get_task_data (task);
+  ParseBatch *batch;
+  GList *infos;
+  GList *l;
+
+  infos = g_file_enumerator_next_files_finish (enumerator, result, &error);
+
+  if (error || !infos)
+    {
+      if (error && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        data->error = g_steal_pointer (&error);
+
+      data->enumerated = TRUE;
+      g_file_enumerator_close_async (enumerator, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+      import_check_done (task);
+      return;
+    }
+
+  batch = g_new0 (ParseBatch, 1);
+  batch->files = g_ptr_array_new_with_free_func (g_object_unref);
+  batch->base_dir = g_strdup (data->base_dir);
+
+  for (l = infos; l; l = l->next)
+    {
+      GFileInfo *info = l->data;
+
+      if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR ||
+          !is_profile_file (g_file_info_get_name (info)))
+        continue;
+
+      g_ptr_array_add (batch->files, g_file_enumerator_get_child (enumerator, info));
+    }
+
+  g_list_free_full (infos, g_object_unref);
+
+  data->n_total += batch->files->len;
+  import_report_progress (task);
+
+  /* Parse this batch while the next one is being read */
+  if (batch->files->len > 0)
+    {
+      data->n_parsing++;
+
+      parse_task = g_task_new (NULL, g_task_get_cancellable (task), parse_batch_cb, g_object_ref (task));
+      g_task_set_source_tag (parse_task, parse_batch_in_thread_cb);
+      g_task_set_task_data (parse_task, batch, (GDestroyNotify) parse_batch_free);
+      g_task_run_in_thread (parse_task, parse_batch_in_thread_cb);
+    }
+  else
+    {
+      parse_batch_free (batch);
+    }
+
+  g_file_enumerator_next_files_async (enumerator,
+                                      ENUMERATE_BATCH_SIZE,
+                                      G_PRIORITY_DEFAULT,
+                                      g_task_get_cancellable (task),
+                                      next_files_cb,
+                                      g_steal_pointer (&task));
+}
+
+static void
+enumerate_children_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) error = NULL;
+  ImportData *data = g_task_get_task_data (task);
+
+  data->enumerator = g_file_enumerate_children_finish (G_FILE (source_object), result, &error);
+
+  if (!data->enumerator)
+    {
+      data->error = g_steal_pointer (&error);
+      data->enumerated = TRUE;
+      import_check_done (task);
+      return;
+    }
+
+  g_file_enumerator_next_files_async (data->enumerator,
+                                      ENUMERATE_BATCH_SIZE,
+                                      G_PRIORITY_DEFAULT,
+                                      g_task_get_cancellable (task),
+                                      next_files_cb,
+                                      g_steal_pointer (&task));
+}
+
+/**
+ * cc_network_profiles_import_async:
+ * @client: a #NMClient
+ * @directory: the directory to import the profiles from
+ * @cancellable: (nullable): a #GCancellable
+ * @progress_func: (nullable): called as profiles are found and processed,
+ *   until @cancellable is cancelled
+ * @progress_data: user data for @progress_func
+ * @callback: called when all the profiles were processed
+ * @user_data: user data for @callback
+ *
+ * Imports all the connection profiles found in @directory and adds them
+ * to NetworkManager. Profiles that fail to parse or to be added are
+ * skipped and counted as failed; they don't abort the import.
+ */
+void
+cc_network_profiles_import_async (NMClient                      *client,
+                                  GFile                         *directory,
+                                  GCancellable                  *cancellable,
+                                  CcNetworkProfilesProgressFunc  progress_func,
+                                  gpointer                       progress_data,
+                                  GAsyncReadyCallback            callback,
+                                  gpointer                       user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  ImportData *data;
+
+  g_return_if_fail (NM_IS_CLIENT (client));
+  g_return_if_fail (G_IS_FILE (directory));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  data = g_new0 (ImportData, 1);
+  data->client = g_object_ref (client);
+  data->base_dir = g_file_get_path (directory);
+  data->progress_func = progress_func;
+  data->progress_data = progress_data;
+  g_queue_init (&data->connections);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_network_profiles_import_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) import_data_free);
+
+  g_file_enumerate_children_async (directory,
+                                   G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                   G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                   G_FILE_QUERY_INFO_NONE,
+                                   G_PRIORITY_DEFAULT,
+                                   cancellable,
+                                   enumerate_children_cb,
+                                   g_steal_pointer (&task));
+}
+
+gboolean
+cc_network_profiles_import_finish (GAsyncResult  *result,
+                                   guint         *n_imported,
+                                   guint         *n_failed,
+                                   GError       **error)
+{
+  ImportData *data;
+
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_network_profiles_import_async, FALSE);
+
+  data = g_task_get_task_data (G_TASK (result));
+
+  if (n_imported)
+    *n_imported = data->n_imported;
+  if (n_failed)
+    *n_failed = data->n_failed;
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* Export */
+
+#define MAX_PENDING_SECRETS   8
+
+typedef struct
+{
+  gchar *name;
+  gchar *uuid;
+  gchar *contents;
+} ExportItem;
+
+static void
+export_item_free (ExportItem *item)
+{
+  g_free (item->name);
+  g_free (item->uuid);
+  g_free (item->contents);
+  g_free (item);
+}
+
+typedef struct
+{
+  GTask              *task;
+  NMRemoteConnection *remote_connection;
+  NMConnection       *connection;
+  const gchar        *setting_name;
+} SecretsRequest;
+
+static void
+secrets_request_free (SecretsRequest *request)
+{
+  g_clear_object (&request->task);
+  g_clear_object (&request->remote_connection);
+  g_clear_object (&request->connection);
+  g_free (request);
+}
+
+typedef struct
+{
+  gchar     *dir;
+
+  /* Copies of the connections, completed with their secrets */
+  GPtrArray *connections;
+  GQueue     secrets_requests;
+  guint      n_pending;
+
+  GPtrArray *items;
+  guint      n_exported;
+  guint      n_skipped;
+} ExportData;
+
+static void
+export_data_free (ExportData *data)
+{
+  g_clear_pointer (&data->dir, g_free);
+  g_clear_pointer (&data->connections, g_ptr_array_unref);
+  g_queue_clear_full (&data->secrets_requests, (GDestroyNotify) secrets_request_free);
+  g_clear_pointer (&data->items, g_ptr_array_unref);
+  g_free (data);
+}
+
+static gboolean
+setting_has_secrets (NMSetting *setting)
+{
+  g_autofree GParamSpec **pspecs = NULL;
+  guint n_pspecs;
+  guint i;
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting), &n_pspecs);
+  for (i = 0; i < n_pspecs; i++)
+    {
+      if (pspecs[i]->flags & NM_SETTING_PARAM_SECRET)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+create_file (const gchar  *path,
+             const gchar  *contents,
+             GError      **error)
+{
+  g_autoptr(GFile) file = NULL;
+  g_autoptr(GFileOutputStream) stream = NULL;
+
+  file = g_file_new_for_path (path);
+
+  /* Never overwrite existing files; keyfiles contain secrets, keep them private */
+  stream = g_file_create (file, G_FILE_CREATE_PRIVATE, NULL, error);
+  if (!stream)
+    return FALSE;
+
+  if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), contents, strlen (contents), NULL, NULL, error))
+    return FALSE;
+
+  return g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+static void
+export_in_thread_cb (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  ExportData *data = task_data;
+  guint i;
+
+  for (i = 0; i < data->items->len; i++)
+    {
+      ExportItem *item = g_ptr_array_index (data->items, i);
+      g_autofree gchar *path = NULL;
+      g_autoptr(GError) error = NULL;
+
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      path = g_strdup_printf ("%s" G_DIR_SEPARATOR_S "%s" KEYFILE_SUFFIX, data->dir, item->name);
+      if (create_file (path, item->contents, &error))
+        {
+          data->n_exported++;
+          continue;
+        }
+
+      /* Another profile with the same ID, or a file left from an earlier export */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+        {
+          g_clear_pointer (&path, g_free);
+          g_clear_error (&error);
+
+          path = g_strdup_printf ("%s" G_DIR_SEPARATOR_S "%s-%s" KEYFILE_SUFFIX, data->dir, item->name, item->uuid);
+          if (create_file (path, item->contents, &error))
+            {
+              data->n_exported++;
+              continue;
+            }
+
+          if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+            {
+              g_debug ("Not overwriting %s", path);
+              data->n_skipped++;
+              continue;
+            }
+        }
+
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+export_write_files (GTask *task)
+{
+  ExportData *data = g_task_get_task_data (task);
+
+  data->items = g_ptr_array_new_with_free_func ((GDestroyNotify) export_item_free);
+
+#if NM_CHECK_VERSION (1,30,0)
+  for (guint i = 0; i < data->connections->len; i++)
+    {
+      NMConnection *connection = g_ptr_array_index (data->connections, i);
+      g_autoptr(GKeyFile) keyfile = NULL;
+      g_autoptr(GError) error = NULL;
+      ExportItem *item;
+
+      keyfile = nm_keyfile_write (connection, NM_KEYFILE_HANDLER_FLAGS_NONE, NULL, NULL, &error);
+      if (!keyfile)
+        {
+          g_warning ("Failed to export %s: %s", nm_connection_get_id (connection), error->message);
+          continue;
+        }
+
+      item = g_new0 (ExportItem, 1);
+      item->name = g_strdelimit (g_strdup (nm_connection_get_id (connection)), G_DIR_SEPARATOR_S, '_');
+      item->uuid = g_strdup (nm_connection_get_uuid (connection));
+      item->contents = g_key_file_to_data (keyfile, NULL, NULL);
+      g_ptr_array_add (data->items, item);
+    }
+#endif
+
+  g_task_run_in_thread (task, export_in_thread_cb);
+}
+
+static void export_fetch_secrets (GTask *task);
+
+static void
+get_secrets_cb (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  SecretsRequest *request = user_data;
+  g_autoptr(GTask) task = g_steal_pointer (&request->task);
+  g_autoptr(GVariant) secrets = NULL;
+  g_autoptr(GError) error = NULL;
+  ExportData *data = g_task_get_task_data (task);
+
+  secrets = nm_remote_connection_get_secrets_finish (NM_REMOTE_CONNECTION (source_object), result, &error);
+  data->n_pending--;
+
+  /* Profiles are still exported without the secrets that can't be read */
+  if (!secrets)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get the %s secrets of %s: %s",
+                   request->setting_name,
+                   nm_connection_get_id (request->connection),
+                   error->message);
+    }
+  else if (!nm_connection_update_secrets (request->connection, request->setting_name, secrets, &error))
+    {
+      g_warning ("Failed to update the %s secrets of %s: %s",
+                 request->setting_name,
+                 nm_connection_get_id (request->connection),
+                 error->message);
+    }
+
+  secrets_request_free (request);
+
+  export_fetch_secrets (task);
+}
+
+static void
+export_fetch_secrets (GTask *task)
+{
+  ExportData *data = g_task_get_task_data (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+
+  if (g_cancellable_is_cancelled (cancellable))
+    {
+      if (data->n_pending == 0)
+        g_task_return_error_if_cancelled (task);
+      return;
+    }
+
+  while (data->n_pending < MAX_PENDING_SECRETS && !g_queue_is_empty (&data->secrets_requests))
+    {
+      SecretsRequest *request = g_queue_pop_head (&data->secrets_requests);
+
+      request->task = g_object_ref (task);
+      data->n_pending++;
+      nm_remote_connection_get_secrets_async (request->remote_connection,
+                                              request->setting_name,
+                                              cancellable,
+                                              get_secrets_cb,
+                                              request);
+    }
+
+  if (data->n_pending == 0)
+    export_write_files (task);
+}
+
+/**
+ * cc_network_profiles_can_export:
+ *
+ * Returns: %TRUE if libnm can write connection profiles as keyfiles.
+ */
+gboolean
+cc_network_profiles_can_export (void)
+{
+  return NM_CHECK_VERSION (1,30,0);
+}
+
+/**
+ * cc_network_profiles_export_async:
+ * @client: a #NMClient
+ * @directory: the directory to export the profiles to
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when all the profiles were written
+ * @user_data: user data for @callback
+ *
+ * Writes every connection profile known to @client as a keyfile in
+ * @directory, along with the secrets stored by NetworkManager. Secrets
+ * kept by an agent (e.g. in the user keyring) are not exported. Existing
+ * files are never overwritten: the UUID of the profile is appended to
+ * the file name instead, and the profile is skipped if that name is
+ * taken too.
+ */
+void
+cc_network_profiles_export_async (NMClient            *client,
+                                  GFile               *directory,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  const GPtrArray *connections;
+  ExportData *data;
+  guint i;
+
+  g_return_if_fail (NM_IS_CLIENT (client));
+  g_return_if_fail (G_IS_FILE (directory));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_network_profiles_export_async);
+
+  if (!cc_network_profiles_can_export ())
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                               _("Exporting connection profiles is not supported"));
+      return;
+    }
+
+  data = g_new0 (ExportData, 1);
+  data->dir = g_file_get_path (directory);
+  data->connections = g_ptr_array_new_with_free_func (g_object_unref);
+  g_queue_init (&data->secrets_requests);
+  g_task_set_task_data (task, data, (GDestroyNotify) export_data_free);
+
+  /* Remote connections never carry secrets, they have to be requested
+   * for each setting that has some */
+  connections = nm_client_get_connections (client);
+  for (i = 0; connections && i < connections->len; i++)
+    {
+      NMRemoteConnection *remote_connection = g_ptr_array_index (connections, i);
+      g_autofree NMSetting **settings = NULL;
+      NMConnection *connection;
+      guint n_settings;
+      guint j;
+
+      connection = nm_simple_connection_new_clone (NM_CONNECTION (remote_connection));
+      g_ptr_array_add (data->connections, connection);
+
+      settings = nm_connection_get_settings (connection, &n_settings);
+      for (j = 0; j < n_settings; j++)
+        {
+          SecretsRequest *request;
+
+          if (!setting_has_secrets (settings[j]))
+            continue;
+
+          request = g_new0 (SecretsRequest, 1);
+          request->remote_connection = g_object_ref (remote_connection);
+          request->connection = g_object_ref (connection);
+          request->setting_name = nm_setting_get_name (settings[j]);
+          g_queue_push_tail (&data->secrets_requests, request);
+        }
+    }
+
+  export_fetch_secrets (task);
+}
+
+gboolean
+cc_network_profiles_export_finish (GAsyncResult  *result,
+                                   guint         *n_exported,
+                                   guint         *n_skipped,
+                                   GError       **error)
+{
+  ExportData *data;
+
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == cc_network_profiles_export_async, FALSE);
+
+  if (!g_task_propagate_boolean (G_TASK (result), error))
+    return FALSE;
+
+  data = g_task_get_task_data (G_TASK (result));
+
+  if (n_exported)
+    *n_exported = data->n_exported;
+  if (n_skipped)
+    *n_skipped = data->n_skipped;
+
+  return TRUE;
+}
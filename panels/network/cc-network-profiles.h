@@ -0,0 +1,53 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <NetworkManager.h>
+
+G_BEGIN_DECLS
+
+typedef void (*CcNetworkProfilesProgressFunc) (guint    n_done,
+                                               guint    n_total,
+                                               gpointer user_data);
+
+void     cc_network_profiles_import_async  (NMClient                      *client,
+                                            GFile                         *directory,
+                                            GCancellable                  *cancellable,
+                                            CcNetworkProfilesProgressFunc  progress_func,
+                                            gpointer                       progress_data,
+                                            GAsyncReadyCallback            callback,
+                                            gpointer                       user_data);
+
+gboolean cc_network_profiles_import_finish (GAsyncResult                  *result,
+                                            guint                         *n_imported,
+                                            guint                         *n_failed,
+                                            GError                       **error);
+
+gboolean cc_network_profiles_can_export   (void);
+
+void     cc_network_profiles_export_async  (NMClient                      *client,
+                                            GFile                         *directory,
+                                            GCancellable                  *cancellable,
+                                            GAsyncReadyCallback            callback,
+                                            gpointer                       user_data);
+
+gboolean cc_network_profiles_export_finish (GAsyncResult                  *result,
+                                            guint                         *n_exported,
+                                            guint                         *n_skipped,
+                                            GError                       **error);
+
+G_END_DECLS
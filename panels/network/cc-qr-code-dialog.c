@@ -152,8 +152,7 @@ cc_qr_code_dialog_constructed (GObject *object)
   qr_connection_string = get_qr_string_for_connection (self->connection);
   if (cc_qr_code_set_text (qr_code, qr_connection_string))
     {
-      gint scale = gtk_widget_get_scale_factor (self->qr_image);
-      GdkPaintable *paintable = cc_qr_code_get_paintable (qr_code, QR_IMAGE_SIZE * scale);
+      GdkPaintable *paintable = cc_qr_code_get_paintable (qr_code, QR_IMAGE_SIZE);
       gtk_picture_set_paintable (GTK_PICTURE (self->qr_image), paintable);
     }
   else
@@ -48,11 +48,46 @@ struct _CcQrCode
   GObject     parent_instance;
 
   gchar      *text;
+  /* One pixel per module, scaled up with nearest filtering on snapshot */
   GdkTexture *texture;
   gint        size;
 };
 
-G_DEFINE_TYPE (CcQrCode, cc_qr_code, G_TYPE_OBJECT)
+static void cc_qr_code_paintable_init (GdkPaintableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (CcQrCode, cc_qr_code, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE, cc_qr_code_paintable_init))
+
+static void
+cc_qr_code_snapshot (GdkPaintable *paintable,
+                     GdkSnapshot  *snapshot,
+                     double        width,
+                     double        height)
+{
+  CcQrCode *self = CC_QR_CODE (paintable);
+
+  if (!self->texture)
+    return;
+
+  gtk_snapshot_append_scaled_texture (GTK_SNAPSHOT (snapshot),
+                                      self->texture,
+                                      GSK_SCALING_FILTER_NEAREST,
+                                      &GRAPHENE_RECT_INIT (0, 0, width, height));
+}
+
+static int
+cc_qr_code_get_intrinsic_size (GdkPaintable *paintable)
+{
+  return CC_QR_CODE (paintable)->size;
+}
+
+static void
+cc_qr_code_paintable_init (GdkPaintableInterface *iface)
+{
+  iface->snapshot = cc_qr_code_snapshot;
+  iface->get_intrinsic_width = cc_qr_code_get_intrinsic_size;
+  iface->get_intrinsic_height = cc_qr_code_get_intrinsic_size;
+}
 
 static void
 cc_qr_code_finalize (GObject *object)
@@ -98,24 +133,23 @@ cc_qr_code_set_text (CcQrCode    *self,
   g_free (self->text);
   self->text = g_strdup (text);
 
-  return TRUE;
-}
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
 
-static void
-cc_fill_pixel (GByteArray *array,
-               guint8     value,
-               int        pixel_size)
-{
-  guint i;
-
-  for (i = 0; i < pixel_size; i++)
-    {
-      g_byte_array_append (array, &value, 1); /* R */
-      g_byte_array_append (array, &value, 1); /* G */
-      g_byte_array_append (array, &value, 1); /* B */
-    }
+  return TRUE;
 }
 
+/**
+ * cc_qr_code_get_paintable:
+ * @self: a #CcQrCode
+ * @size: the intrinsic width and height, in application pixels
+ *
+ * Encodes the text of @self, if not done yet, and returns @self as a
+ * paintable. The QR code is drawn with one texel per module, so it stays
+ * sharp at any size or scale factor without being regenerated.
+ *
+ * Returns: (transfer none)(nullable): the QR code paintable, or %NULL if
+ * the text could not be encoded.
+ */
 GdkPaintable *
 cc_qr_code_get_paintable (CcQrCode *self,
                           gint      size)
@@ -123,9 +157,9 @@ cc_qr_code_get_paintable (CcQrCode *self,
   uint8_t qr_code[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
   uint8_t temp_buf[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
   g_autoptr (GBytes) bytes = NULL;
-  GByteArray *qr_matrix;
-  gint pixel_size, qr_size, total_size;
-  gint column, row, i;
+  guint8 *modules;
+  gint qr_size;
+  gint x, y;
   gboolean success = FALSE;
 
   g_return_val_if_fail (CC_IS_QR_CODE (self), NULL);
@@ -137,10 +171,14 @@ cc_qr_code_get_paintable (CcQrCode *self,
       cc_qr_code_set_text (self, "invalid text");
     }
 
-  if (self->texture && self->size == size)
-    return GDK_PAINTABLE (self->texture);
+  if (self->size != size)
+    {
+      self->size = size;
+      gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+    }
 
-  self->size = size;
+  if (self->texture)
+    return GDK_PAINTABLE (self);
 
   success = qrcodegen_encodeText (self->text,
                                   temp_buf,
@@ -155,34 +193,29 @@ cc_qr_code_get_paintable (CcQrCode *self,
     return NULL;
 
   qr_size = qrcodegen_getSize (qr_code);
-  pixel_size = MAX (1, size / (qr_size));
-  total_size = qr_size * pixel_size;
-  qr_matrix = g_byte_array_sized_new (total_size * total_size * pixel_size * BYTES_PER_R8G8B8);
+  modules = g_malloc (qr_size * qr_size * BYTES_PER_R8G8B8);
 
-  for (column = 0; column < total_size; column++)
+  for (y = 0; y < qr_size; y++)
     {
-      for (i = 0; i < pixel_size; i++)
+      for (x = 0; x < qr_size; x++)
         {
-          for (row = 0; row < total_size / pixel_size; row++)
-            {
-              if (qrcodegen_getModule (qr_code, column, row))
-                cc_fill_pixel (qr_matrix, 0x00, pixel_size);
-              else
-                cc_fill_pixel (qr_matrix, 0xff, pixel_size);
-            }
+          guint8 value = qrcodegen_getModule (qr_code, x, y) ? 0x00 : 0xff;
+
+          memset (modules + (y * qr_size + x) * BYTES_PER_R8G8B8, value, BYTES_PER_R8G8B8);
         }
     }
 
-  bytes = g_byte_array_free_to_bytes (qr_matrix);
+  bytes = g_bytes_new_take (modules, qr_size * qr_size * BYTES_PER_R8G8B8);
 
-  g_clear_object (&self->texture);
-  self->texture = gdk_memory_texture_new (total_size,
-                                          total_size,
+  self->texture = gdk_memory_texture_new (qr_size,
+                                          qr_size,
                                           GDK_MEMORY_R8G8B8,
                                           bytes,
-                                          total_size * BYTES_PER_R8G8B8);
+                                          qr_size * BYTES_PER_R8G8B8);
+
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
 
-  return GDK_PAINTABLE (self->texture);
+  return GDK_PAINTABLE (self);
 }
 
 static gchar *
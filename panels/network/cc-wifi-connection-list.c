@@ -51,6 +51,18 @@ struct _CcWifiConnectionList
    */
   GHashTable    *ap_ssid_cache;
   GHashTable    *ssid_to_row;
+
+  /* Connections indexed by SSID, so that an AP only needs to be checked
+   * against the connections for the same network. The SSID of each
+   * connection is cached to find it in the index again after the
+   * connection has been changed.
+   */
+  GHashTable    *connection_ssid_cache;
+  GHashTable    *ssid_to_connections;
+
+  /* APs with changed properties, their rows are updated once per frame */
+  GHashTable    *pending_aps;
+  guint          pending_aps_tick_id;
 };
 
 static void on_device_ap_added_cb   (CcWifiConnectionList *self,
@@ -65,6 +77,8 @@ static void on_row_forget_cb        (CcWifiConnectionList *self,
                                      CcWifiConnectionRow  *row);
 static void on_row_show_qr_code_cb (CcWifiConnectionList *self,
                                     CcWifiConnectionRow  *row);
+static void on_connection_changed_cb (CcWifiConnectionList *self,
+                                      NMConnection         *connection);
 
 G_DEFINE_TYPE (CcWifiConnectionList, cc_wifi_connection_list, ADW_TYPE_BIN)
 
@@ -92,13 +106,30 @@ new_hashable_ssid (GBytes *ssid)
   /* This is what nm_utils_same_ssid does, but returning it so that we can
    * use the result in other ways (i.e. hash table lookups). */
   data = g_bytes_get_data ((GBytes*) ssid, &size);
-  if (data[size-1] == '\0')
+  if (size > 0 && data[size-1] == '\0')
     size -= 1;
   res = g_bytes_new (data, size);
 
   return res;
 }
 
+static GBytes*
+connection_get_hashable_ssid (NMConnection *connection)
+{
+  NMSettingWireless *sw;
+  GBytes *ssid;
+
+  sw = nm_connection_get_setting_wireless (connection);
+  if (!sw)
+    return NULL;
+
+  ssid = nm_setting_wireless_get_ssid (sw);
+  if (!ssid)
+    return NULL;
+
+  return new_hashable_ssid (ssid);
+}
+
 static gboolean
 connection_ignored (NMConnection *connection)
 {
@@ -149,6 +180,141 @@ cc_wifi_connection_list_row_add (CcWifiConnectionList *self,
   return res;
 }
 
+static void
+cc_wifi_connection_list_row_remove (CcWifiConnectionList *self,
+                                    CcWifiConnectionRow  *row)
+{
+  g_signal_emit_by_name (self, "remove-row", row);
+  gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+}
+
+/* Appends the connection to the list, creating its row unless it is
+ * only shown once it has an AP. */
+static void
+track_connection (CcWifiConnectionList *self,
+                  NMConnection         *connection,
+                  NMConnection         *ac_con)
+{
+  GPtrArray *ssid_connections;
+  GBytes *ssid;
+
+  g_ptr_array_add (self->connections, g_object_ref (connection));
+  if (self->hide_unavailable && connection != ac_con)
+    g_ptr_array_add (self->connections_row, NULL);
+  else
+    g_ptr_array_add (self->connections_row,
+                     cc_wifi_connection_list_row_add (self, connection,
+                     NULL, TRUE));
+
+  ssid = connection_get_hashable_ssid (connection);
+  if (ssid)
+    {
+      g_hash_table_insert (self->connection_ssid_cache, connection, ssid);
+
+      ssid_connections = g_hash_table_lookup (self->ssid_to_connections, ssid);
+      if (!ssid_connections)
+        {
+          ssid_connections = g_ptr_array_new ();
+          g_hash_table_insert (self->ssid_to_connections, g_bytes_ref (ssid), ssid_connections);
+        }
+      g_ptr_array_add (ssid_connections, connection);
+    }
+
+  if (NM_IS_REMOTE_CONNECTION (connection))
+    g_signal_connect_object (connection, "changed",
+                             G_CALLBACK (on_connection_changed_cb),
+                             self, G_CONNECT_SWAPPED);
+}
+
+/* Drops the connection at the given index; its row has to be removed
+ * by the caller. */
+static void
+untrack_connection (CcWifiConnectionList *self,
+                    guint                 idx)
+{
+  NMConnection *connection;
+  GPtrArray *ssid_connections;
+  GBytes *ssid;
+
+  connection = g_ptr_array_index (self->connections, idx);
+  g_signal_handlers_disconnect_by_data (connection, self);
+
+  ssid = g_hash_table_lookup (self->connection_ssid_cache, connection);
+  if (ssid)
+    {
+      ssid_connections = g_hash_table_lookup (self->ssid_to_connections, ssid);
+      g_ptr_array_remove (ssid_connections, connection);
+      if (ssid_connections->len == 0)
+        g_hash_table_remove (self->ssid_to_connections, ssid);
+      g_hash_table_remove (self->connection_ssid_cache, connection);
+    }
+
+  if (self->last_active == connection)
+    self->last_active = NULL;
+
+  g_ptr_array_remove_index (self->connections_row, idx);
+  g_ptr_array_remove_index (self->connections, idx);
+}
+
+/* Same as nm_access_point_filter_connections() on all connections,
+ * but only the connections with the SSID of the AP are checked. */
+static GPtrArray*
+filter_connections_for_ap (CcWifiConnectionList *self,
+                           NMAccessPoint        *ap)
+{
+  GPtrArray *res;
+  GPtrArray *ssid_connections;
+  GBytes *ap_ssid;
+  g_autoptr(GBytes) ssid = NULL;
+  guint i;
+
+  res = g_ptr_array_new_with_free_func (g_object_unref);
+
+  ap_ssid = nm_access_point_get_ssid (ap);
+  if (ap_ssid == NULL)
+    return res;
+
+  ssid = new_hashable_ssid (ap_ssid);
+  ssid_connections = g_hash_table_lookup (self->ssid_to_connections, ssid);
+  if (!ssid_connections)
+    return res;
+
+  for (i = 0; i < ssid_connections->len; i++)
+    {
+      NMConnection *connection = g_ptr_array_index (ssid_connections, i);
+
+      if (nm_access_point_connection_valid (ap, connection))
+        g_ptr_array_add (res, g_object_ref (connection));
+    }
+
+  return res;
+}
+
+/* Removes an AP from the row of its SSID if it is not assigned to a
+ * connection, removing the row too once it has no APs left. */
+static gboolean
+remove_ap_from_ssid_row (CcWifiConnectionList *self,
+                         NMAccessPoint        *ap)
+{
+  CcWifiConnectionRow *row;
+  g_autoptr(GBytes) ssid = NULL;
+
+  g_hash_table_steal_extended (self->ap_ssid_cache, ap, NULL, (gpointer*) &ssid);
+  if (!ssid)
+    return FALSE;
+
+  row = g_hash_table_lookup (self->ssid_to_row, ssid);
+  g_assert (row != NULL);
+
+  if (cc_wifi_connection_row_remove_access_point (row, ap))
+    {
+      g_hash_table_remove (self->ssid_to_row, ssid);
+      cc_wifi_connection_list_row_remove (self, row);
+    }
+
+  return TRUE;
+}
+
 static void
 clear_widget (CcWifiConnectionList *self)
 {
@@ -161,14 +327,15 @@ clear_widget (CcWifiConnectionList *self)
   aps = nm_device_wifi_get_access_points (self->device);
   for (i = 0; i < aps->len; i++)
     g_signal_handlers_disconnect_by_data (g_ptr_array_index (aps, i), self);
+  for (i = 0; i < self->connections->len; i++)
+    g_signal_handlers_disconnect_by_data (g_ptr_array_index (self->connections, i), self);
 
   /* Remove all AP only rows */
   g_hash_table_iter_init (&iter, self->ssid_to_row);
   while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &row))
     {
       g_hash_table_iter_remove (&iter);
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+      cc_wifi_connection_list_row_remove (self, row);
     }
 
   /* Remove all connection rows */
@@ -179,8 +346,7 @@ clear_widget (CcWifiConnectionList *self)
 
       row = g_ptr_array_index (self->connections_row, i);
       g_ptr_array_index (self->connections_row, i) = NULL;
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+      cc_wifi_connection_list_row_remove (self, row);
     }
 
   /* Reset the internal state */
@@ -188,6 +354,9 @@ clear_widget (CcWifiConnectionList *self)
   g_ptr_array_set_size (self->connections_row, 0);
   g_hash_table_remove_all (self->ssid_to_row);
   g_hash_table_remove_all (self->ap_ssid_cache);
+  g_hash_table_remove_all (self->connection_ssid_cache);
+  g_hash_table_remove_all (self->ssid_to_connections);
+  g_hash_table_remove_all (self->pending_aps);
 }
 
 static void
@@ -237,13 +406,7 @@ update_connections (CcWifiConnectionList *self)
       if (connection_ignored (con))
         continue;
 
-      g_ptr_array_add (self->connections, g_object_ref (con));
-      if (self->hide_unavailable && con != ac_con)
-        g_ptr_array_add (self->connections_row, NULL);
-      else
-        g_ptr_array_add (self->connections_row,
-                         cc_wifi_connection_list_row_add (self, con,
-                         NULL, TRUE));
+      track_connection (self, con, ac_con);
     }
 
   /* Coldplug all known APs again */
@@ -272,16 +435,72 @@ on_row_show_qr_code_cb (CcWifiConnectionList *self, CcWifiConnectionRow *row)
   g_signal_emit_by_name (self, "show_qr_code", row);
 }
 
+static gboolean
+flush_access_point_updates (GtkWidget     *widget,
+                            GdkFrameClock *frame_clock,
+                            gpointer       user_data)
+{
+  CcWifiConnectionList *self = CC_WIFI_CONNECTION_LIST (widget);
+  g_autoptr(GHashTable) ssid_rows = NULL;
+  CcWifiConnectionRow *row;
+  GHashTableIter iter;
+  NMAccessPoint *ap;
+  guint i, j;
+
+  self->pending_aps_tick_id = 0;
+
+  /* Update each row with a connection once, whatever number of its APs changed */
+  for (i = 0; i < self->connections_row->len; i++)
+    {
+      const GPtrArray *row_aps;
+
+      row = g_ptr_array_index (self->connections_row, i);
+      if (!row)
+        continue;
+
+      row_aps = cc_wifi_connection_row_get_access_points (row);
+      for (j = 0; j < row_aps->len; j++)
+        {
+          if (g_hash_table_contains (self->pending_aps, g_ptr_array_index (row_aps, j)))
+            {
+              cc_wifi_connection_row_update (row);
+              break;
+            }
+        }
+    }
+
+  /* APs without a connection are in the row of their SSID */
+  if (self->show_aps)
+    {
+      ssid_rows = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+      g_hash_table_iter_init (&iter, self->pending_aps);
+      while (g_hash_table_iter_next (&iter, (gpointer*) &ap, NULL))
+        {
+          GBytes *ssid;
+
+          ssid = g_hash_table_lookup (self->ap_ssid_cache, ap);
+          if (!ssid)
+            continue;
+
+          row = g_hash_table_lookup (self->ssid_to_row, ssid);
+          g_assert (row != NULL);
+
+          if (g_hash_table_add (ssid_rows, row))
+            cc_wifi_connection_row_update (row);
+        }
+    }
+
+  g_hash_table_remove_all (self->pending_aps);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 on_access_point_property_changed (CcWifiConnectionList *self,
                                   GParamSpec           *pspec,
                                   NMAccessPoint        *ap)
 {
-  CcWifiConnectionRow *row;
-  GBytes *ssid;
-  gboolean has_connection = FALSE;
-  gint i;
-
   /* If the SSID changed then the AP needs to be added/removed from rows.
    * Do this by simulating an AP addition/removal.  */
   if (g_str_equal (pspec->name, NM_ACCESS_POINT_SSID))
@@ -292,31 +511,19 @@ on_access_point_property_changed (CcWifiConnectionList *self,
       return;
     }
 
-  /* Otherwise, find all rows that contain the AP and update it. Do this by
-   * first searching all rows with connections, and then looking it up in the
-   * SSID rows if not found. */
-  for (i = 0; i < self->connections_row->len; i++)
-    {
-      row = g_ptr_array_index (self->connections_row, i);
-      if (row && cc_wifi_connection_row_has_access_point (row, ap))
-        {
-          cc_wifi_connection_row_update (row);
-          has_connection = TRUE;
-        }
-    }
-
-  if (!self->show_aps || has_connection)
+  /* Updated with every scan, but not shown */
+  if (g_str_equal (pspec->name, NM_ACCESS_POINT_LAST_SEEN))
     return;
 
-  ssid = g_hash_table_lookup (self->ap_ssid_cache, ap);
-  if (!ssid)
-    return;
+  /* Otherwise the rows that contain the AP are updated before the next
+   * frame; strength changes of many APs arrive at once during scans. */
+  g_hash_table_add (self->pending_aps, g_object_ref (ap));
 
-  row = g_hash_table_lookup (self->ssid_to_row, ssid);
-  if (!row)
-    g_assert_not_reached ();
-  else
-    cc_wifi_connection_row_update (row);
+  if (self->pending_aps_tick_id == 0)
+    self->pending_aps_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+                                                              flush_access_point_updates,
+                                                              NULL,
+                                                              NULL);
 }
 
 static void
@@ -335,7 +542,7 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
                            G_CALLBACK (on_access_point_property_changed),
                            self, G_CONNECT_SWAPPED);
 
-  connections = nm_access_point_filter_connections (ap, self->connections);
+  connections = filter_connections_for_ap (self, ap);
 
   /* If this is the active AP, then add the active connection to the list. This
    * is a workaround because nm_access_pointer_filter_connections() will not
@@ -421,11 +628,11 @@ on_device_ap_removed_cb (CcWifiConnectionList *self,
                          NMDeviceWifi         *device)
 {
   CcWifiConnectionRow *row;
-  g_autoptr(GBytes) ssid = NULL;
   gboolean found = FALSE;
   gint i;
 
   g_signal_handlers_disconnect_by_data (ap, self);
+  g_hash_table_remove (self->pending_aps, ap);
 
   /* Find any connection related row with the AP and remove the AP from it. Remove the
    * row if it was the last AP and we are hiding unavailable connections. */
@@ -439,8 +646,7 @@ on_device_ap_removed_cb (CcWifiConnectionList *self,
           if (self->hide_unavailable)
             {
               g_ptr_array_index (self->connections_row, i) = NULL;
-              g_signal_emit_by_name (self, "remove-row", row);
-              gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+              cc_wifi_connection_list_row_remove (self, row);
             }
         }
     }
@@ -448,21 +654,101 @@ on_device_ap_removed_cb (CcWifiConnectionList *self,
   if (found || !self->show_aps)
     return;
 
-  /* If the AP was inserted into a row without a connection, then we will get an
-   * SSID for it here. */
-  g_hash_table_steal_extended (self->ap_ssid_cache, ap, NULL, (gpointer*) &ssid);
+  /* If the AP was inserted into a row without a connection, then we can
+   * update the row (possibly removing it) */
+  remove_ap_from_ssid_row (self, ap);
+}
+
+static void
+add_connection (CcWifiConnectionList *self,
+                NMConnection         *connection)
+{
+  NMActiveConnection *ac;
+  NMConnection *ac_con = NULL;
+  NMAccessPoint *active_ap;
+  CcWifiConnectionRow *row;
+  const GPtrArray *aps;
+  GBytes *ssid;
+  guint idx;
+  guint i;
+
+  ac = nm_device_get_active_connection (NM_DEVICE (self->device));
+  if (ac)
+    ac_con = NM_CONNECTION (nm_active_connection_get_connection (ac));
+
+  track_connection (self, connection, ac_con);
+  idx = self->connections->len - 1;
+
+  ssid = g_hash_table_lookup (self->connection_ssid_cache, connection);
   if (!ssid)
     return;
 
-  /* And we can update the row (possibly removing it) */
-  row = g_hash_table_lookup (self->ssid_to_row, ssid);
-  g_assert (row != NULL);
+  /* Only APs of the same SSID can be compatible with the new connection.
+   * These are moved over from the row of their SSID if they are not
+   * assigned to another connection already. */
+  active_ap = nm_device_wifi_get_active_access_point (self->device);
+  aps = nm_device_wifi_get_access_points (self->device);
+  for (i = 0; i < aps->len; i++)
+    {
+      NMAccessPoint *ap = g_ptr_array_index (aps, i);
+      g_autoptr(GBytes) ap_ssid = NULL;
 
-  if (cc_wifi_connection_row_remove_access_point (row, ap))
+      if (!nm_access_point_get_ssid (ap))
+        continue;
+
+      ap_ssid = new_hashable_ssid (nm_access_point_get_ssid (ap));
+      if (!g_bytes_equal (ap_ssid, ssid))
+        continue;
+
+      if (!nm_access_point_connection_valid (ap, connection) &&
+          !(ap == active_ap && connection == ac_con))
+        continue;
+
+      row = g_ptr_array_index (self->connections_row, idx);
+      if (!row)
+        {
+          row = cc_wifi_connection_list_row_add (self, connection, NULL, TRUE);
+          g_ptr_array_index (self->connections_row, idx) = row;
+        }
+      cc_wifi_connection_row_add_access_point (row, ap);
+
+      remove_ap_from_ssid_row (self, ap);
+    }
+}
+
+static void
+remove_connection (CcWifiConnectionList *self,
+                   NMConnection         *connection)
+{
+  CcWifiConnectionRow *row;
+  g_autoptr(GPtrArray) aps = NULL;
+  guint idx;
+  guint i;
+
+  if (!g_ptr_array_find (self->connections, connection, &idx))
+    return;
+
+  aps = g_ptr_array_new_with_free_func (g_object_unref);
+
+  row = g_ptr_array_index (self->connections_row, idx);
+  if (row)
     {
-      g_hash_table_remove (self->ssid_to_row, ssid);
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+      const GPtrArray *row_aps = cc_wifi_connection_row_get_access_points (row);
+
+      for (i = 0; i < row_aps->len; i++)
+        g_ptr_array_add (aps, g_object_ref (g_ptr_array_index (row_aps, i)));
+
+      cc_wifi_connection_list_row_remove (self, row);
+    }
+
+  untrack_connection (self, idx);
+
+  /* The APs of the removed row go to other connections or to the row
+   * of their SSID. */
+  for (i = 0; i < aps->len; i++)
+    {
+      on_device_ap_removed_cb (self, g_ptr_array_index (aps, i), self->device);
+      on_device_ap_added_cb (self, g_ptr_array_index (aps, i), self->device);
     }
 }
 
@@ -477,10 +763,14 @@ on_client_connection_added_cb (CcWifiConnectionList *self,
   if (connection_ignored (connection))
     return;
 
-  /* The approach we take to handle connection changes is to do a full rebuild.
-   * It happens seldom enough to make this feasible.
-   */
-  update_connections (self);
+  /* Frozen lists are rebuilt when thawed */
+  if (self->freeze_count > 0 || self->updating)
+    return;
+
+  if (g_ptr_array_find (self->connections, connection, NULL))
+    return;
+
+  add_connection (self, connection);
 }
 
 static void
@@ -488,13 +778,62 @@ on_client_connection_removed_cb (CcWifiConnectionList *self,
                                  NMConnection         *connection,
                                  NMClient             *client)
 {
-  if (!g_ptr_array_find (self->connections, connection, NULL))
+  if (self->freeze_count > 0 || self->updating)
     return;
 
-  /* The approach we take to handle connection changes is to do a full rebuild.
-   * It happens seldom enough to make this feasible.
-   */
-  update_connections (self);
+  remove_connection (self, connection);
+}
+
+static void
+on_connection_changed_cb (CcWifiConnectionList *self,
+                          NMConnection         *connection)
+{
+  g_autoptr(NMConnection) ref = g_object_ref (connection);
+
+  if (self->freeze_count > 0 || self->updating)
+    return;
+
+  /* The SSID or the security of the connection may have changed, which
+   * affects the APs it is compatible with; so add it anew. */
+  remove_connection (self, connection);
+  if (!connection_ignored (connection))
+    add_connection (self, connection);
+}
+
+static void
+update_active_connection (CcWifiConnectionList *self,
+                          NMConnection         *old_connection,
+                          NMConnection         *new_connection)
+{
+  CcWifiConnectionRow *row;
+  guint idx;
+
+  /* The previously active connection is hidden again if it has no APs */
+  if (old_connection && g_ptr_array_find (self->connections, old_connection, &idx))
+    {
+      row = g_ptr_array_index (self->connections_row, idx);
+      if (row && self->hide_unavailable &&
+          cc_wifi_connection_row_get_access_points (row)->len == 0)
+        {
+          g_ptr_array_index (self->connections_row, idx) = NULL;
+          cc_wifi_connection_list_row_remove (self, row);
+        }
+      else if (row)
+        {
+          cc_wifi_connection_row_update (row);
+        }
+    }
+
+  if (new_connection && g_ptr_array_find (self->connections, new_connection, &idx))
+    {
+      row = g_ptr_array_index (self->connections_row, idx);
+      if (!row)
+        {
+          row = cc_wifi_connection_list_row_add (self, new_connection, NULL, TRUE);
+          g_ptr_array_index (self->connections_row, idx) = row;
+        }
+      cc_wifi_connection_row_update (row);
+    }
 }
 
 static void
@@ -519,6 +858,16 @@ on_device_state_changed_cb (CcWifiConnectionList *self,
       return;
     }
 
+  /* Otherwise move the active state over if both connections are known
+   * already. The APs are regrouped when the active AP changes. */
+  if (self->freeze_count == 0 && !self->updating &&
+      (connection == NULL || g_ptr_array_find (self->connections, connection, NULL)))
+    {
+      update_active_connection (self, self->last_active, connection);
+      self->last_active = connection;
+      return;
+    }
+
   /* Give up and do a full update. */
   update_connections (self);
   self->last_active = connection;
@@ -556,6 +905,12 @@ cc_wifi_connection_list_dispose (GObject *object)
   /* Drop all external references */
   clear_widget (self);
 
+  if (self->pending_aps_tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->pending_aps_tick_id);
+      self->pending_aps_tick_id = 0;
+    }
+
   G_OBJECT_CLASS (cc_wifi_connection_list_parent_class)->dispose (object);
 }
 
@@ -571,6 +926,9 @@ cc_wifi_connection_list_finalize (GObject *object)
   g_clear_pointer (&self->connections_row, g_ptr_array_unref);
   g_clear_pointer (&self->ssid_to_row, g_hash_table_unref);
   g_clear_pointer (&self->ap_ssid_cache, g_hash_table_unref);
+  g_clear_pointer (&self->connection_ssid_cache, g_hash_table_unref);
+  g_clear_pointer (&self->ssid_to_connections, g_hash_table_unref);
+  g_clear_pointer (&self->pending_aps, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_wifi_connection_list_parent_class)->finalize (object);
 }
@@ -789,6 +1147,13 @@ cc_wifi_connection_list_init (CcWifiConnectionList *self)
                                              (GDestroyNotify) g_bytes_unref, NULL);
   self->ap_ssid_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                                NULL, (GDestroyNotify) g_bytes_unref);
+  self->connection_ssid_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                       NULL, (GDestroyNotify) g_bytes_unref);
+  self->ssid_to_connections = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                                     (GDestroyNotify) g_bytes_unref,
+                                                     (GDestroyNotify) g_ptr_array_unref);
+  self->pending_aps = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             g_object_unref, NULL);
 }
 
 CcWifiConnectionList *
@@ -35,6 +35,11 @@ struct _CcWifiConnectionRow
   NMConnection    *connection;
   gboolean         known_connection;
 
+  /* Sort keys; the row is only resorted when one of them changes */
+  gboolean         is_active;
+  guint            strength_level;
+  gboolean         has_strength;
+
   GtkLabel        *active_label;
   GtkCheckButton  *checkbutton;
   GtkSpinner      *connecting_spinner;
@@ -72,12 +77,56 @@ typedef enum
 
 G_DEFINE_TYPE (CcWifiConnectionRow, cc_wifi_connection_row, ADW_TYPE_ACTION_ROW)
 
+/* Strength changes by less than this do not switch between levels */
+#define STRENGTH_HYSTERESIS 5
+
+/* Lower bounds of the signal strength levels */
+static const guint8 strength_thresholds[] = { 20, 40, 50, 80 };
+
+static const gchar *strength_icon_names[] = {
+  "network-wireless-signal-none-symbolic",
+  "network-wireless-signal-weak-symbolic",
+  "network-wireless-signal-ok-symbolic",
+  "network-wireless-signal-good-symbolic",
+  "network-wireless-signal-excellent-symbolic",
+};
+
 static GParamSpec *props[PROP_LAST];
 
 static void configure_clicked_cb (CcWifiConnectionRow *self);
 static void forget_clicked_cb (CcWifiConnectionRow *self);
 static void qr_code_clicked_cb (CcWifiConnectionRow *self);
 
+static guint
+get_strength_level (guint8 strength)
+{
+  guint level;
+
+  for (level = 0; level < G_N_ELEMENTS (strength_thresholds); level++)
+    if (strength < strength_thresholds[level])
+      break;
+
+  return level;
+}
+
+/* Only leaves the current level once the strength is clearly outside of it */
+static guint
+update_strength_level (guint  level,
+                       guint8 strength)
+{
+  guint upper, lower;
+
+  upper = get_strength_level (strength > STRENGTH_HYSTERESIS ? strength - STRENGTH_HYSTERESIS : 0);
+  lower = get_strength_level (MIN (strength + STRENGTH_HYSTERESIS, 100));
+
+  if (upper > level)
+    return upper;
+  if (lower < level)
+    return lower;
+
+  return level;
+}
+
 static NMAccessPointSecurity
 get_access_point_security (NMAccessPoint *ap)
 {
@@ -177,6 +226,7 @@ update_ui (CcWifiConnectionRow *self)
   NMAccessPointSecurity security = NM_AP_SEC_UNKNOWN;
   NMAccessPoint *best_ap;
   guint8 strength = 0;
+  guint strength_level = 0;
   NMActiveConnectionState state;
 
   g_assert (self->device);
@@ -256,6 +306,19 @@ update_ui (CcWifiConnectionRow *self)
     {
       security = get_access_point_security (best_ap);
       strength = nm_access_point_get_strength (best_ap);
+      if (self->has_strength)
+        strength_level = update_strength_level (self->strength_level, strength);
+      else
+        strength_level = get_strength_level (strength);
+    }
+  self->has_strength = best_ap != NULL;
+
+  if (self->is_active != (active_connection != NULL) ||
+      self->strength_level != strength_level)
+    {
+      self->is_active = active_connection != NULL;
+      self->strength_level = strength_level;
+      gtk_list_box_row_changed (GTK_LIST_BOX_ROW (self));
     }
 
   gtk_widget_set_visible (GTK_WIDGET (self->connecting_spinner), connecting);
@@ -309,20 +372,8 @@ update_ui (CcWifiConnectionRow *self)
   if (best_ap)
     {
       g_autofree char *description = NULL;
-      gchar *icon_name;
-
-      if (strength < 20)
-        icon_name = "network-wireless-signal-none-symbolic";
-      else if (strength < 40)
-        icon_name = "network-wireless-signal-weak-symbolic";
-      else if (strength < 50)
-        icon_name = "network-wireless-signal-ok-symbolic";
-      else if (strength < 80)
-        icon_name = "network-wireless-signal-good-symbolic";
-      else
-        icon_name = "network-wireless-signal-excellent-symbolic";
 
-      g_object_set (self->strength_icon, "icon-name", icon_name, NULL);
+      g_object_set (self->strength_icon, "icon-name", strength_icon_names[strength_level], NULL);
       gtk_widget_set_child_visible (GTK_WIDGET (self->strength_icon), TRUE);
 
       description = g_strdup_printf(_("Signal strength %d%%"), strength);
@@ -737,12 +788,26 @@ cc_wifi_connection_row_has_access_point (CcWifiConnectionRow *self,
   return g_ptr_array_find (self->aps, ap, NULL);
 }
 
+gboolean
+cc_wifi_connection_row_get_is_active (CcWifiConnectionRow *self)
+{
+  g_return_val_if_fail (CC_WIFI_CONNECTION_ROW (self), FALSE);
+
+  return self->is_active;
+}
+
+guint
+cc_wifi_connection_row_get_strength_level (CcWifiConnectionRow *self)
+{
+  g_return_val_if_fail (CC_WIFI_CONNECTION_ROW (self), 0);
+
+  return self->strength_level;
+}
+
+/* The row is resorted by update_ui() if its sort keys changed */
 void
 cc_wifi_connection_row_update (CcWifiConnectionRow *self)
 {
   update_ui (self);
-
-  gtk_list_box_row_changed (GTK_LIST_BOX_ROW (self));
-
 }
 
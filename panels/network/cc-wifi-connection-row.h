@@ -52,5 +52,8 @@ gboolean             cc_wifi_connection_row_remove_access_point (CcWifiConnectio
 gboolean             cc_wifi_connection_row_has_access_point    (CcWifiConnectionRow   *row,
                                                                  NMAccessPoint         *ap);
 
+gboolean             cc_wifi_connection_row_get_is_active       (CcWifiConnectionRow   *row);
+guint                cc_wifi_connection_row_get_strength_level  (CcWifiConnectionRow   *row);
+
 void                 cc_wifi_connection_row_update              (CcWifiConnectionRow   *row);
 G_END_DECLS
@@ -64,6 +64,7 @@ struct _CcWifiPanel
   GtkStack           *stack;
   GtkPicture         *wifi_qr_image;
   CcQrCode           *qr_code;
+  GCancellable       *qr_cancellable;
 
   NMClient           *client;
 
@@ -124,22 +125,22 @@ update_panel_visibility (NMClient *client)
   g_debug ("Wi-Fi panel visible: %s", visible ? "yes" : "no");
 }
 
-void
-cc_wifi_panel_static_init_func (void)
+static void
+static_init_client_ready_cb (GObject      *source_object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
 {
   g_autoptr(NMClient) client = NULL;
+  g_autoptr(GError) error = NULL;
 
-  g_debug ("Monitoring NetworkManager for Wi-Fi devices");
+  client = cc_object_storage_init_object_finish (result, &error);
 
-  /* Create and store a NMClient instance if it doesn't exist yet */
-  if (!cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
+  if (!client)
     {
-      g_autoptr(NMClient) new_client = nm_client_new (NULL, NULL);
-      cc_object_storage_add_object (CC_OBJECT_NMCLIENT, new_client);
+      g_warning ("Error creating NetworkManager client: %s", error->message);
+      return;
     }
 
-  client = cc_object_storage_get_object (CC_OBJECT_NMCLIENT);
-
   /* Update the panel visibility and monitor for changes */
 
   g_signal_connect (client, "device-added", G_CALLBACK (update_panel_visibility), NULL);
@@ -148,6 +149,21 @@ cc_wifi_panel_static_init_func (void)
   update_panel_visibility (client);
 }
 
+void
+cc_wifi_panel_static_init_func (void)
+{
+  g_debug ("Monitoring NetworkManager for Wi-Fi devices");
+
+  /* Create and store a NMClient instance without blocking the startup; the
+   * panels await the same initialization when they are opened early.
+   */
+  cc_object_storage_init_object_async (CC_OBJECT_NMCLIENT,
+                                       NM_TYPE_CLIENT,
+                                       NULL,
+                                       static_init_client_ready_cb,
+                                       NULL);
+}
+
 /* Auxiliary methods */
 
 static NMConnection *
@@ -175,6 +191,50 @@ wifi_device_get_hotspot (CcWifiPanel *self,
   return c;
 }
 
+static void
+hotspot_secrets_ready_cb (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  NMConnection *hotspot = NM_CONNECTION (source_object);
+  g_autoptr(GVariant) secrets = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *str = NULL;
+  CcWifiPanel *self;
+
+  secrets = nm_remote_connection_get_secrets_finish (NM_REMOTE_CONNECTION (hotspot), result, &error);
+
+  if (!secrets)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Error: %s", error->message);
+      return;
+    }
+
+  self = CC_WIFI_PANEL (user_data);
+
+  if (!nm_connection_update_secrets (hotspot,
+                                     NM_SETTING_WIRELESS_SECURITY_SETTING_NAME,
+                                     secrets, &error))
+    {
+      g_warning ("Error: %s", error->message);
+      return;
+    }
+
+  if (!self->qr_code)
+    self->qr_code = cc_qr_code_new ();
+
+  /* The code is only redrawn when the SSID, security or password changed */
+  str = get_qr_string_for_connection (hotspot);
+  if (cc_qr_code_set_text (self->qr_code, str))
+    {
+      GdkPaintable *paintable;
+
+      paintable = cc_qr_code_get_paintable (self->qr_code, QR_IMAGE_SIZE);
+      gtk_picture_set_paintable (self->wifi_qr_image, paintable);
+    }
+}
+
 static void
 wifi_panel_update_qr_image_cb (CcWifiPanel *self)
 {
@@ -192,44 +252,25 @@ wifi_panel_update_qr_image_cb (CcWifiPanel *self)
     NMDevice *ap_device = g_ptr_array_index (devices, i);
     const char *iface = nm_device_get_iface (ap_device);
     if (g_strcmp0 (iface, "ap0") == 0) {
-      device = g_object_ref (ap_device);
+      device = ap_device;
       break;
     }
   }
 
+  /* Drop any pending request, it may be for another hotspot */
+  g_cancellable_cancel (self->qr_cancellable);
+  g_clear_object (&self->qr_cancellable);
+
   hotspot = wifi_device_get_hotspot (self, device);
   if (hotspot)
     {
-      g_autofree gchar *str = NULL;
-      g_autoptr (GVariant) secrets = NULL;
-      g_autoptr (GError) error = NULL;
-
-      if (!self->qr_code)
-        self->qr_code = cc_qr_code_new ();
-
-      secrets = nm_remote_connection_get_secrets (NM_REMOTE_CONNECTION (hotspot),
-                                                  NM_SETTING_WIRELESS_SECURITY_SETTING_NAME,
-                                                  NULL, &error);
-      if (!error) {
-        nm_connection_update_secrets (hotspot,
-                                      NM_SETTING_WIRELESS_SECURITY_SETTING_NAME,
-                                      secrets, &error);
-
-        str = get_qr_string_for_connection (hotspot);
-        if (cc_qr_code_set_text (self->qr_code, str))
-          {
-            GdkPaintable *paintable;
-            gint scale;
-
-            scale = gtk_widget_get_scale_factor (GTK_WIDGET (self->wifi_qr_image));
-            paintable = cc_qr_code_get_paintable (self->qr_code, QR_IMAGE_SIZE * scale);
-            gtk_picture_set_paintable (self->wifi_qr_image, paintable);
-          }
-        }
-      else
-        {
-          g_warning ("Error: %s", error->message);
-        }
+      /* Fetching the secrets may involve a round-trip to a secret agent */
+      self->qr_cancellable = g_cancellable_new ();
+      nm_remote_connection_get_secrets_async (NM_REMOTE_CONNECTION (hotspot),
+                                              NM_SETTING_WIRELESS_SECURITY_SETTING_NAME,
+                                              self->qr_cancellable,
+                                              hotspot_secrets_ready_cb,
+                                              self);
     }
 
   gtk_widget_set_visible (GTK_WIDGET (self->hotspot_box), hotspot != NULL);
@@ -333,6 +374,10 @@ check_main_stack_page (CcWifiPanel *self)
   gchar *standard_error = NULL;
   gint exit_status = 0;
 
+  /* NetworkManager is still being loaded */
+  if (!self->client)
+    return;
+
   nm_version = nm_client_get_version (self->client);
   wireless_enabled = nm_client_wireless_get_enabled (self->client);
 
@@ -370,6 +415,10 @@ check_main_stack_page (CcWifiPanel *self)
   gboolean airplane_mode_active;
   gboolean wireless_enabled;
 
+  /* NetworkManager is still being loaded */
+  if (!self->client)
+    return;
+
   nm_version = nm_client_get_version (self->client);
   wireless_enabled = nm_client_wireless_get_enabled (self->client);
   airplane_mode_active = adw_switch_row_get_active (self->rfkill_row);
@@ -908,6 +957,10 @@ cc_wifi_panel_finalize (GObject *object)
 {
   CcWifiPanel *self = (CcWifiPanel *)object;
 
+  g_cancellable_cancel (self->qr_cancellable);
+  g_clear_object (&self->qr_cancellable);
+  g_clear_object (&self->qr_code);
+
   g_clear_object (&self->client);
   g_clear_object (&self->rfkill_proxy);
 
@@ -1019,25 +1072,10 @@ cc_wifi_panel_class_init (CcWifiPanelClass *klass)
 }
 
 static void
-cc_wifi_panel_init (CcWifiPanel *self)
+set_client (CcWifiPanel *self,
+            NMClient    *client)
 {
-  g_autoptr(GtkCssProvider) provider = NULL;
-
-  g_resources_register (cc_network_get_resource ());
-
-  gtk_widget_init_template (GTK_WIDGET (self));
-
-  self->devices = g_ptr_array_new ();
-
-  /* Create and store a NMClient instance if it doesn't exist yet */
-  if (!cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
-    {
-      g_autoptr(NMClient) client = nm_client_new (NULL, NULL);
-      cc_object_storage_add_object (CC_OBJECT_NMCLIENT, client);
-    }
-
-  /* Load NetworkManager */
-  self->client = cc_object_storage_get_object (CC_OBJECT_NMCLIENT);
+  self->client = client;
 
   g_signal_connect_object (self->client,
                            "device-added",
@@ -1060,6 +1098,51 @@ cc_wifi_panel_init (CcWifiPanel *self)
   /* Load Wi-Fi devices */
   load_wifi_devices (self);
 
+  /* Handle comment-line arguments after loading devices */
+  handle_argv (self);
+}
+
+static void
+client_ready_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+  NMClient *client;
+
+  client = cc_object_storage_init_object_finish (result, &error);
+
+  if (!client)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Error creating NetworkManager client: %s", error->message);
+      return;
+    }
+
+  set_client (CC_WIFI_PANEL (user_data), client);
+}
+
+static void
+cc_wifi_panel_init (CcWifiPanel *self)
+{
+  g_autoptr(GtkCssProvider) provider = NULL;
+
+  g_resources_register (cc_network_get_resource ());
+
+  gtk_widget_init_template (GTK_WIDGET (self));
+
+  self->devices = g_ptr_array_new ();
+
+  /* Load NetworkManager */
+  if (cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
+    set_client (self, cc_object_storage_get_object (CC_OBJECT_NMCLIENT));
+  else
+    cc_object_storage_init_object_async (CC_OBJECT_NMCLIENT,
+                                         NM_TYPE_CLIENT,
+                                         cc_panel_get_cancellable (CC_PANEL (self)),
+                                         client_ready_cb,
+                                         self);
+
   /* Acquire Airplane Mode proxy */
   cc_object_storage_create_dbus_proxy (G_BUS_TYPE_SESSION,
                                        G_DBUS_PROXY_FLAGS_NONE,
@@ -1070,9 +1153,6 @@ cc_wifi_panel_init (CcWifiPanel *self)
                                        rfkill_proxy_acquired_cb,
                                        self);
 
-  /* Handle comment-line arguments after loading devices */
-  handle_argv (self);
-
   /* use custom CSS */
   provider = gtk_css_provider_new ();
   gtk_css_provider_load_from_resource (provider, "/org/gnome/control-center/network/wifi-panel.css");
@@ -0,0 +1,382 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <string.h>
+
+#include "ce-device-stats.h"
+
+/* One sample per second, one minute of history */
+#define SAMPLE_INTERVAL   1
+#define N_SAMPLES         60
+#define SPARKLINE_HEIGHT  32
+
+/* Don't let the sparkline amplify idle noise */
+#define MIN_SCALE         1024.0
+
+typedef enum {
+        COUNTER_RX_BYTES,
+        COUNTER_TX_BYTES,
+        COUNTER_RX_PACKETS,
+        COUNTER_TX_PACKETS,
+        COUNTER_RX_ERRORS,
+        COUNTER_TX_ERRORS,
+        COUNTER_RX_DROPPED,
+        COUNTER_TX_DROPPED,
+        N_COUNTERS
+} Counter;
+
+static const gchar *counter_names[N_COUNTERS] = {
+        "rx_bytes",
+        "tx_bytes",
+        "rx_packets",
+        "tx_packets",
+        "rx_errors",
+        "tx_errors",
+        "rx_dropped",
+        "tx_dropped",
+};
+
+/*
+ * CEDeviceStats shows the live throughput of a network interface, read
+ * from the kernel counters in /sys/class/net/<iface>/statistics. The
+ * rates of the last minute are kept in a fixed-size ring buffer and drawn
+ * as a sparkline. Sampling only happens while the widget is mapped.
+ */
+struct _CEDeviceStats
+{
+        GtkWidget       parent_instance;
+
+        GtkLabel       *rate_label;
+        GtkLabel       *counters_label;
+        GtkDrawingArea *sparkline;
+
+        NMDevice       *device;
+        guint           sample_id;
+
+        guint64         counters[N_COUNTERS];
+        gint64          sample_time;
+        gboolean        have_counters;
+
+        /* Ring buffer of rates, in bytes per second */
+        gdouble         rx_rates[N_SAMPLES];
+        gdouble         tx_rates[N_SAMPLES];
+        guint           first_sample;
+        guint           n_samples;
+};
+
+G_DEFINE_TYPE (CEDeviceStats, ce_device_stats, GTK_TYPE_WIDGET)
+
+static gboolean
+read_counters (const gchar *iface,
+               guint64      counters[N_COUNTERS])
+{
+        guint i;
+
+        for (i = 0; i < N_COUNTERS; i++) {
+                g_autofree gchar *path = NULL;
+                g_autofree gchar *contents = NULL;
+
+                path = g_build_filename ("/sys/class/net", iface, "statistics", counter_names[i], NULL);
+                if (!g_file_get_contents (path, &contents, NULL, NULL))
+                        return FALSE;
+
+                counters[i] = g_ascii_strtoull (contents, NULL, 10);
+        }
+
+        return TRUE;
+}
+
+static void
+push_sample (CEDeviceStats *self,
+             gdouble        rx_rate,
+             gdouble        tx_rate)
+{
+        guint index;
+
+        if (self->n_samples < N_SAMPLES) {
+                index = (self->first_sample + self->n_samples) % N_SAMPLES;
+                self->n_samples++;
+        } else {
+                index = self->first_sample;
+                self->first_sample = (self->first_sample + 1) % N_SAMPLES;
+        }
+
+        self->rx_rates[index] = rx_rate;
+        self->tx_rates[index] = tx_rate;
+}
+
+static void
+update_labels (CEDeviceStats *self,
+               gdouble        rx_rate,
+               gdouble        tx_rate)
+{
+        g_autofree gchar *rx_text = NULL;
+        g_autofree gchar *tx_text = NULL;
+        g_autofree gchar *rate_text = NULL;
+        g_autofree gchar *counters_text = NULL;
+        g_autofree gchar *rx_packets = NULL;
+        g_autofree gchar *tx_packets = NULL;
+        g_autofree gchar *errors = NULL;
+        g_autofree gchar *dropped = NULL;
+
+        rx_text = g_format_size ((guint64) rx_rate);
+        tx_text = g_format_size ((guint64) tx_rate);
+        /* Translators: the first %s is the download rate and the second one the
+         * upload rate, e.g. "1.2 MB/s received, 30.5 kB/s sent" */
+        rate_text = g_strdup_printf (_("%s/s received, %s/s sent"), rx_text, tx_text);
+        gtk_label_set_label (self->rate_label, rate_text);
+
+        rx_packets = g_strdup_printf ("%" G_GUINT64_FORMAT, self->counters[COUNTER_RX_PACKETS]);
+        tx_packets = g_strdup_printf ("%" G_GUINT64_FORMAT, self->counters[COUNTER_TX_PACKETS]);
+        errors = g_strdup_printf ("%" G_GUINT64_FORMAT,
+                                  self->counters[COUNTER_RX_ERRORS] + self->counters[COUNTER_TX_ERRORS]);
+        dropped = g_strdup_printf ("%" G_GUINT64_FORMAT,
+                                   self->counters[COUNTER_RX_DROPPED] + self->counters[COUNTER_TX_DROPPED]);
+        /* Translators: packet counters of a network interface since it was brought up */
+        counters_text = g_strdup_printf (_("Packets: %s received, %s sent. Errors: %s. Dropped: %s."),
+                                         rx_packets, tx_packets, errors, dropped);
+        gtk_label_set_label (self->counters_label, counters_text);
+}
+
+static gboolean
+sample_cb (gpointer user_data)
+{
+        CEDeviceStats *self = CE_DEVICE_STATS (user_data);
+        guint64 counters[N_COUNTERS];
+        const gchar *iface;
+        gdouble elapsed;
+        gdouble rx_rate;
+        gdouble tx_rate;
+        gint64 now;
+
+        iface = nm_device_get_ip_iface (self->device);
+        if (iface == NULL || !read_counters (iface, counters)) {
+                self->have_counters = FALSE;
+                return G_SOURCE_CONTINUE;
+        }
+
+        now = g_get_monotonic_time ();
+
+        /* The first sample after (re)starting only sets the baseline; the
+         * counters may also go backwards if the interface was recreated */
+        if (!self->have_counters ||
+            counters[COUNTER_RX_BYTES] < self->counters[COUNTER_RX_BYTES] ||
+            counters[COUNTER_TX_BYTES] < self->counters[COUNTER_TX_BYTES]) {
+                memcpy (self->counters, counters, sizeof (counters));
+                self->sample_time = now;
+                self->have_counters = TRUE;
+                update_labels (self, 0, 0);
+                return G_SOURCE_CONTINUE;
+        }
+
+        elapsed = (gdouble) (now - self->sample_time) / G_USEC_PER_SEC;
+        if (elapsed <= 0)
+                return G_SOURCE_CONTINUE;
+
+        rx_rate = (counters[COUNTER_RX_BYTES] - self->counters[COUNTER_RX_BYTES]) / elapsed;
+        tx_rate = (counters[COUNTER_TX_BYTES] - self->counters[COUNTER_TX_BYTES]) / elapsed;
+
+        memcpy (self->counters, counters, sizeof (counters));
+        self->sample_time = now;
+
+        push_sample (self, rx_rate, tx_rate);
+        update_labels (self, rx_rate, tx_rate);
+        gtk_widget_queue_draw (GTK_WIDGET (self->sparkline));
+
+        return G_SOURCE_CONTINUE;
+}
+
+static void
+start_sampling (CEDeviceStats *self)
+{
+        if (self->sample_id != 0 || self->device == NULL)
+                return;
+
+        self->have_counters = FALSE;
+        sample_cb (self);
+
+        self->sample_id = g_timeout_add_seconds (SAMPLE_INTERVAL, sample_cb, self);
+}
+
+static void
+stop_sampling (CEDeviceStats *self)
+{
+        g_clear_handle_id (&self->sample_id, g_source_remove);
+}
+
+static void
+draw_rates (cairo_t       *cr,
+            const gdouble *rates,
+            guint          first_sample,
+            guint          n_samples,
+            gdouble        scale,
+            gint           width,
+            gint           height)
+{
+        gdouble step;
+        guint i;
+
+        step = (gdouble) width / (N_SAMPLES - 1);
+
+        /* Newest sample on the right edge */
+        for (i = 0; i < n_samples; i++) {
+                gdouble rate = rates[(first_sample + i) % N_SAMPLES];
+                gdouble x = width - (n_samples - 1 - i) * step;
+                gdouble y = height - (rate / scale) * (height - 1);
+
+                if (i == 0)
+                        cairo_move_to (cr, x, y);
+                else
+                        cairo_line_to (cr, x, y);
+        }
+
+        cairo_stroke (cr);
+}
+
+static void
+sparkline_draw_cb (GtkDrawingArea *drawing_area,
+                   cairo_t        *cr,
+                   gint            width,
+                   gint            height,
+                   gpointer        user_data)
+{
+        CEDeviceStats *self = CE_DEVICE_STATS (user_data);
+        GdkRGBA color;
+        gdouble scale = MIN_SCALE;
+        guint i;
+
+        if (self->n_samples < 2)
+                return;
+
+        for (i = 0; i < self->n_samples; i++) {
+                guint index = (self->first_sample + i) % N_SAMPLES;
+
+                scale = MAX (scale, MAX (self->rx_rates[index], self->tx_rates[index]));
+        }
+
+        gtk_widget_get_color (GTK_WIDGET (drawing_area), &color);
+        cairo_set_line_width (cr, 1.5);
+        cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+
+        /* Received */
+        gdk_cairo_set_source_rgba (cr, &color);
+        draw_rates (cr, self->rx_rates, self->first_sample, self->n_samples, scale, width, height);
+
+        /* Sent */
+        color.alpha *= 0.4;
+        gdk_cairo_set_source_rgba (cr, &color);
+        draw_rates (cr, self->tx_rates, self->first_sample, self->n_samples, scale, width, height);
+}
+
+static void
+ce_device_stats_map (GtkWidget *widget)
+{
+        GTK_WIDGET_CLASS (ce_device_stats_parent_class)->map (widget);
+
+        start_sampling (CE_DEVICE_STATS (widget));
+}
+
+static void
+ce_device_stats_unmap (GtkWidget *widget)
+{
+        stop_sampling (CE_DEVICE_STATS (widget));
+
+        GTK_WIDGET_CLASS (ce_device_stats_parent_class)->unmap (widget);
+}
+
+static void
+ce_device_stats_dispose (GObject *object)
+{
+        CEDeviceStats *self = CE_DEVICE_STATS (object);
+        GtkWidget *child;
+
+        stop_sampling (self);
+        g_clear_object (&self->device);
+
+        while ((child = gtk_widget_get_first_child (GTK_WIDGET (self))) != NULL)
+                gtk_widget_unparent (child);
+
+        G_OBJECT_CLASS (ce_device_stats_parent_class)->dispose (object);
+}
+
+static void
+ce_device_stats_class_init (CEDeviceStatsClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+        GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+        object_class->dispose = ce_device_stats_dispose;
+
+        widget_class->map = ce_device_stats_map;
+        widget_class->unmap = ce_device_stats_unmap;
+
+        gtk_widget_class_set_layout_manager_type (widget_class, GTK_TYPE_BOX_LAYOUT);
+}
+
+static void
+ce_device_stats_init (CEDeviceStats *self)
+{
+        GtkLayoutManager *layout;
+
+        layout = gtk_widget_get_layout_manager (GTK_WIDGET (self));
+        gtk_orientable_set_orientation (GTK_ORIENTABLE (layout), GTK_ORIENTATION_VERTICAL);
+        gtk_box_layout_set_spacing (GTK_BOX_LAYOUT (layout), 6);
+
+        self->rate_label = GTK_LABEL (gtk_label_new (NULL));
+        gtk_label_set_xalign (self->rate_label, 0);
+        gtk_label_set_selectable (self->rate_label, TRUE);
+        gtk_widget_set_parent (GTK_WIDGET (self->rate_label), GTK_WIDGET (self));
+
+        self->sparkline = GTK_DRAWING_AREA (gtk_drawing_area_new ());
+        gtk_drawing_area_set_content_height (self->sparkline, SPARKLINE_HEIGHT);
+        gtk_drawing_area_set_draw_func (self->sparkline, sparkline_draw_cb, self, NULL);
+        gtk_widget_set_parent (GTK_WIDGET (self->sparkline), GTK_WIDGET (self));
+
+        self->counters_label = GTK_LABEL (gtk_label_new (NULL));
+        gtk_label_set_xalign (self->counters_label, 0);
+        gtk_label_set_wrap (self->counters_label, TRUE);
+        gtk_label_set_selectable (self->counters_label, TRUE);
+        gtk_widget_add_css_class (GTK_WIDGET (self->counters_label), "dim-label");
+        gtk_widget_add_css_class (GTK_WIDGET (self->counters_label), "caption");
+        gtk_widget_set_parent (GTK_WIDGET (self->counters_label), GTK_WIDGET (self));
+}
+
+void
+ce_device_stats_set_device (CEDeviceStats *self,
+                            NMDevice      *device)
+{
+        g_return_if_fail (CE_IS_DEVICE_STATS (self));
+        g_return_if_fail (device == NULL || NM_IS_DEVICE (device));
+
+        if (self->device == device)
+                return;
+
+        stop_sampling (self);
+        g_set_object (&self->device, device);
+
+        self->first_sample = 0;
+        self->n_samples = 0;
+        gtk_widget_queue_draw (GTK_WIDGET (self->sparkline));
+
+        if (gtk_widget_get_mapped (GTK_WIDGET (self)))
+                start_sampling (self);
+}
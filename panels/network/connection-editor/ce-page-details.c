@@ -25,6 +25,7 @@
 
 #include <NetworkManager.h>
 
+#include "ce-device-stats.h"
 #include "ce-page.h"
 #include "ce-page-details.h"
 
@@ -36,6 +37,7 @@ struct _CEPageDetails
 
         GtkCheckButton *all_user_check;
         GtkCheckButton *auto_connect_check;
+        CEDeviceStats *device_stats;
         GtkLabel *dns4_heading_label;
         GtkLabel *dns4_label;
         GtkLabel *dns6_heading_label;
@@ -58,6 +60,7 @@ struct _CEPageDetails
         GtkLabel *security_label;
         GtkLabel *speed_heading_label;
         GtkLabel *speed_label;
+        GtkLabel *stats_heading_label;
         GtkLabel *strength_heading_label;
         GtkLabel *strength_label;
 
@@ -484,6 +487,12 @@ connect_details_page (CEPageDetails *self)
                 gtk_widget_set_visible (GTK_WIDGET (self->last_used_label), FALSE);
         }
 
+        /* Live traffic, sampled only while the page is shown */
+        if (device_is_active && self->device != NULL)
+                ce_device_stats_set_device (self->device_stats, self->device);
+        gtk_widget_set_visible (GTK_WIDGET (self->stats_heading_label), device_is_active && self->device != NULL);
+        gtk_widget_set_visible (GTK_WIDGET (self->device_stats), device_is_active && self->device != NULL);
+
         /* Auto connect check */
         if (g_str_equal (type, NM_SETTING_VPN_SETTING_NAME) ||
             g_str_equal(type, NM_SETTING_WIREGUARD_SETTING_NAME)) {
@@ -554,10 +563,13 @@ ce_page_details_class_init (CEPageDetailsClass *klass)
 
         object_class->dispose = ce_page_details_dispose;
 
+        g_type_ensure (ce_device_stats_get_type ());
+
         gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/control-center/network/details-page.ui");
 
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, all_user_check);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, auto_connect_check);
+        gtk_widget_class_bind_template_child (widget_class, CEPageDetails, device_stats);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, dns4_heading_label);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, dns4_label);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, dns6_heading_label);
@@ -580,6 +592,7 @@ ce_page_details_class_init (CEPageDetailsClass *klass)
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, security_label);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, speed_heading_label);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, speed_label);
+        gtk_widget_class_bind_template_child (widget_class, CEPageDetails, stats_heading_label);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, strength_heading_label);
         gtk_widget_class_bind_template_child (widget_class, CEPageDetails, strength_label);
 }
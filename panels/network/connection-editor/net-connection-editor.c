@@ -70,7 +70,9 @@ struct _NetConnectionEditor
         NMAccessPoint    *ap;
         GCancellable     *cancellable;
 
-        GSList *initializing_pages;
+        GPtrArray        *pages;
+        GSList           *initializing_pages;
+        GHashTable       *secrets;
 
         NMClientPermissionResult can_modify;
 
@@ -79,6 +81,54 @@ struct _NetConnectionEditor
 
 G_DEFINE_TYPE (NetConnectionEditor, net_connection_editor, ADW_TYPE_WINDOW)
 
+typedef enum {
+        PAGE_DETAILS,
+        PAGE_WIFI,
+        PAGE_ETHERNET,
+        PAGE_VPN,
+        PAGE_WIREGUARD,
+        PAGE_BLUETOOTH,
+        PAGE_IP4,
+        PAGE_IP6,
+        PAGE_SECURITY,
+        PAGE_8021X_SECURITY
+} PageKind;
+
+/* A notebook tab; its page is only built when the tab is first shown */
+typedef struct {
+        PageKind  kind;
+        AdwBin   *bin;
+        CEPage   *page;
+        gboolean  dirty;
+        gboolean  valid;
+        gchar    *invalid_reason;
+} PageSlot;
+
+static void
+page_slot_free (PageSlot *slot)
+{
+        g_clear_object (&slot->page);
+        g_free (slot->invalid_reason);
+        g_free (slot);
+}
+
+/* Secrets of a setting, shared by all the pages that need them */
+typedef struct {
+        GVariant  *secrets;
+        GError    *error;
+        GPtrArray *waiting_pages;
+        gboolean   done;
+} SecretsRequest;
+
+static void
+secrets_request_free (SecretsRequest *request)
+{
+        g_clear_pointer (&request->secrets, g_variant_unref);
+        g_clear_error (&request->error);
+        g_clear_pointer (&request->waiting_pages, g_ptr_array_unref);
+        g_free (request);
+}
+
 /* Used as both GSettings keys and GObject data tags */
 #define IGNORE_CA_CERT_TAG "ignore-ca-cert"
 #define IGNORE_PHASE2_CA_CERT_TAG "ignore-phase2-ca-cert"
@@ -166,7 +216,7 @@ eap_method_ca_cert_ignore_load (NMConnection *connection)
                            GUINT_TO_POINTER (phase2_ignore));
 }
 
-static void page_changed (NetConnectionEditor *self);
+static void page_changed (NetConnectionEditor *self, CEPage *page);
 
 static void
 cancel_editing (NetConnectionEditor *self)
@@ -307,6 +357,9 @@ static void
 net_connection_editor_init (NetConnectionEditor *self)
 {
         gtk_widget_init_template (GTK_WIDGET (self));
+
+        self->pages = g_ptr_array_new_with_free_func ((GDestroyNotify) page_slot_free);
+        self->secrets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) secrets_request_free);
 }
 
 static void
@@ -321,6 +374,9 @@ net_connection_editor_finalize (GObject *object)
         g_clear_object (&self->ap);
         g_cancellable_cancel (self->cancellable);
         g_clear_object (&self->cancellable);
+        g_clear_pointer (&self->pages, g_ptr_array_unref);
+        g_clear_pointer (&self->initializing_pages, g_slist_free);
+        g_clear_pointer (&self->secrets, g_hash_table_unref);
 
         G_OBJECT_CLASS (net_connection_editor_parent_class)->finalize (object);
 }
@@ -479,30 +535,59 @@ update_sensitivity (NetConnectionEditor *self)
         }
 }
 
+static PageSlot *
+find_page_slot (NetConnectionEditor *self,
+                gpointer             widget)
+{
+        guint i;
+
+        for (i = 0; i < self->pages->len; i++) {
+                PageSlot *slot = g_ptr_array_index (self->pages, i);
+
+                if (widget == (gpointer) slot->bin || widget == (gpointer) slot->page)
+                        return slot;
+        }
+
+        return NULL;
+}
+
 static void
 validate (NetConnectionEditor *self)
 {
         gboolean valid = FALSE;
-        g_autofree gchar *apply_tooltip = NULL;
-        gint i;
+        const gchar *apply_tooltip = NULL;
+        guint i;
 
         if (!editor_is_initialized (self))
                 goto done;
 
+        /* Only pages marked dirty since they were last validated are
+         * validated again, which is also when they write their widgets
+         * back to the connection. Pages that were never built did not
+         * touch the connection and are valid. */
         valid = TRUE;
-        for (i = 0; i < gtk_notebook_get_n_pages (self->notebook); i++) {
-                CEPage *page = CE_PAGE (gtk_notebook_get_nth_page (self->notebook, i));
-                g_autoptr(GError) error = NULL;
+        for (i = 0; i < self->pages->len; i++) {
+                PageSlot *slot = g_ptr_array_index (self->pages, i);
+
+                if (slot->dirty) {
+                        g_autoptr(GError) error = NULL;
+
+                        slot->dirty = FALSE;
+                        g_clear_pointer (&slot->invalid_reason, g_free);
+
+                        slot->valid = ce_page_validate (slot->page, self->connection, &error);
+                        if (!slot->valid) {
+                                if (error)
+                                        slot->invalid_reason = g_strdup_printf (_("Invalid setting %s: %s"), ce_page_get_title (slot->page), error->message);
+                                else
+                                        slot->invalid_reason = g_strdup_printf (_("Invalid setting %s"), ce_page_get_title (slot->page));
+                                g_debug ("%s", slot->invalid_reason);
+                        }
+                }
 
-                if (!ce_page_validate (page, self->connection, &error)) {
+                if (!slot->valid) {
                         valid = FALSE;
-                        if (error) {
-                                apply_tooltip = g_strdup_printf (_("Invalid setting %s: %s"), ce_page_get_title (page), error->message);
-                                g_debug ("%s", apply_tooltip);
-                        } else {
-                                apply_tooltip = g_strdup_printf (_("Invalid setting %s"), ce_page_get_title (page));
-                                g_debug ("%s", apply_tooltip);
-                        }
+                        apply_tooltip = slot->invalid_reason;
                 }
         }
 
@@ -515,8 +600,21 @@ done:
 }
 
 static void
-page_changed (NetConnectionEditor *self)
+page_changed (NetConnectionEditor *self,
+              CEPage              *page)
 {
+        guint i;
+
+        /* Pages read settings written by other pages (e.g. the security
+         * page checks the SSID of the Wi-Fi page), so all the built
+         * pages need validating again. */
+        for (i = 0; i < self->pages->len; i++) {
+                PageSlot *slot = g_ptr_array_index (self->pages, i);
+
+                if (slot->page)
+                        slot->dirty = TRUE;
+        }
+
         if (editor_is_initialized (self))
                 self->is_changed = TRUE;
         validate (self);
@@ -536,35 +634,25 @@ recheck_initialization (NetConnectionEditor *self)
         if (!editor_is_initialized (self))
                 return;
 
-        gtk_stack_set_visible_child (self->toplevel_stack, GTK_WIDGET (self->notebook));
-        gtk_notebook_set_current_page (self->notebook, 0);
+        /* Pages built on demand later on only need validating */
+        if (gtk_stack_get_visible_child (self->toplevel_stack) != GTK_WIDGET (self->notebook)) {
+                gtk_stack_set_visible_child (self->toplevel_stack, GTK_WIDGET (self->notebook));
+                gtk_notebook_set_current_page (self->notebook, 0);
 
-        g_idle_add (idle_validate, self);
-
-        if (self->is_new_connection)
-                adw_bin_set_child (self->add_connection_frame, NULL);
+                if (self->is_new_connection)
+                        adw_bin_set_child (self->add_connection_frame, NULL);
+        }
 
+        g_idle_add (idle_validate, self);
 }
 
 static void
 page_initialized (NetConnectionEditor *self, GError *error, CEPage *page)
 {
-        GtkWidget *label;
-        gint position;
-        gint i;
+        PageSlot *slot = find_page_slot (self, page);
 
-        position = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (page), "position"));
-        g_object_set_data (G_OBJECT (page), "position", GINT_TO_POINTER (position));
-        for (i = 0; i < gtk_notebook_get_n_pages (self->notebook); i++) {
-                GtkWidget *page = gtk_notebook_get_nth_page (self->notebook, i);
-                gint pos = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (page), "position"));
-                if (pos > position)
-                        break;
-        }
-
-        label = gtk_label_new (ce_page_get_title (page));
-
-        gtk_notebook_insert_page (self->notebook, GTK_WIDGET (page), label, i);
+        adw_bin_set_child (slot->bin, GTK_WIDGET (page));
+        slot->dirty = TRUE;
 
         self->initializing_pages = g_slist_remove (self->initializing_pages, page);
 
@@ -573,10 +661,19 @@ page_initialized (NetConnectionEditor *self, GError *error, CEPage *page)
 
 typedef struct {
         NetConnectionEditor *editor;
-        CEPage *page;
         const gchar *setting_name;
 } GetSecretsInfo;
 
+static void
+complete_page_init (NetConnectionEditor *self,
+                    CEPage              *page,
+                    const gchar         *setting_name,
+                    SecretsRequest      *request)
+{
+        ce_page_complete_init (page, self->connection, setting_name, request->secrets,
+                               request->error ? g_error_copy (request->error) : NULL);
+}
+
 static void
 get_secrets_cb (GObject *source_object,
                 GAsyncResult *res,
@@ -584,8 +681,11 @@ get_secrets_cb (GObject *source_object,
 {
         NMRemoteConnection *connection;
         g_autofree GetSecretsInfo *info = user_data;
+        g_autoptr(GPtrArray) pages = NULL;
         g_autoptr(GError) error = NULL;
         g_autoptr(GVariant) variant = NULL;
+        SecretsRequest *request;
+        guint i;
 
         connection = NM_REMOTE_CONNECTION (source_object);
         variant = nm_remote_connection_get_secrets_finish (connection, res, &error);
@@ -597,7 +697,14 @@ get_secrets_cb (GObject *source_object,
                 g_warning ("Failed to get secrets: %s", error->message);
         }
 
-        ce_page_complete_init (info->page, info->editor->connection, info->setting_name, variant, g_steal_pointer (&error));
+        request = g_hash_table_lookup (info->editor->secrets, info->setting_name);
+        request->secrets = g_steal_pointer (&variant);
+        request->error = g_steal_pointer (&error);
+        request->done = TRUE;
+
+        pages = g_steal_pointer (&request->waiting_pages);
+        for (i = 0; i < pages->len; i++)
+                complete_page_init (info->editor, g_ptr_array_index (pages, i), info->setting_name, request);
 }
 
 static void
@@ -605,11 +712,26 @@ get_secrets_for_page (NetConnectionEditor *self,
                       CEPage              *page,
                       const gchar         *setting_name)
 {
+        SecretsRequest *request;
         GetSecretsInfo *info;
 
+        /* Secrets are fetched once per setting and shared by the pages */
+        request = g_hash_table_lookup (self->secrets, setting_name);
+        if (request) {
+                if (request->done)
+                        complete_page_init (self, page, setting_name, request);
+                else
+                        g_ptr_array_add (request->waiting_pages, g_object_ref (page));
+                return;
+        }
+
+        request = g_new0 (SecretsRequest, 1);
+        request->waiting_pages = g_ptr_array_new_with_free_func (g_object_unref);
+        g_ptr_array_add (request->waiting_pages, g_object_ref (page));
+        g_hash_table_insert (self->secrets, g_strdup (setting_name), request);
+
         info = g_new0 (GetSecretsInfo, 1);
         info->editor = self;
-        info->page = page;
         info->setting_name = setting_name;
 
         nm_remote_connection_get_secrets_async (NM_REMOTE_CONNECTION (self->orig_connection),
@@ -619,25 +741,125 @@ get_secrets_for_page (NetConnectionEditor *self,
                                                 info);
 }
 
+static const gchar *
+page_kind_get_title (PageKind kind)
+{
+        switch (kind) {
+        case PAGE_DETAILS:
+                return _("Details");
+        case PAGE_WIFI:
+        case PAGE_ETHERNET:
+        case PAGE_VPN:
+        case PAGE_BLUETOOTH:
+                return _("Identity");
+        case PAGE_WIREGUARD:
+                return _("WireGuard");
+        case PAGE_IP4:
+                return _("IPv4");
+        case PAGE_IP6:
+                return _("IPv6");
+        case PAGE_SECURITY:
+        case PAGE_8021X_SECURITY:
+                return _("Security");
+        default:
+                g_assert_not_reached ();
+        }
+}
+
+static CEPage *
+create_page (NetConnectionEditor *self, PageKind kind)
+{
+        switch (kind) {
+        case PAGE_DETAILS:
+                return CE_PAGE (ce_page_details_new (self->connection, self->device, self->ap, self, self->is_new_connection));
+        case PAGE_WIFI:
+                return CE_PAGE (ce_page_wifi_new (self->connection, self->client));
+        case PAGE_ETHERNET:
+                return CE_PAGE (ce_page_ethernet_new (self->connection, self->client));
+        case PAGE_VPN:
+                return CE_PAGE (ce_page_vpn_new (self->connection));
+        case PAGE_WIREGUARD:
+                return CE_PAGE (ce_page_wireguard_new (self->connection));
+        case PAGE_BLUETOOTH:
+                return CE_PAGE (ce_page_bluetooth_new (self->connection));
+        case PAGE_IP4:
+                return CE_PAGE (ce_page_ip4_new (self->connection, self->client));
+        case PAGE_IP6:
+                return CE_PAGE (ce_page_ip6_new (self->connection, self->client));
+        case PAGE_SECURITY:
+                return CE_PAGE (ce_page_security_new (self->connection));
+        case PAGE_8021X_SECURITY:
+                return CE_PAGE (ce_page_8021x_security_new (self->connection));
+        default:
+                g_assert_not_reached ();
+        }
+}
+
+static void
+add_page (NetConnectionEditor *self, PageKind kind)
+{
+        PageSlot *slot;
+        GtkWidget *spinner;
+
+        slot = g_new0 (PageSlot, 1);
+        slot->kind = kind;
+        slot->valid = TRUE;
+        slot->bin = ADW_BIN (adw_bin_new ());
+
+        spinner = gtk_spinner_new ();
+        gtk_widget_set_halign (spinner, GTK_ALIGN_CENTER);
+        gtk_widget_set_valign (spinner, GTK_ALIGN_CENTER);
+        gtk_spinner_set_spinning (GTK_SPINNER (spinner), TRUE);
+        adw_bin_set_child (slot->bin, spinner);
+
+        g_ptr_array_add (self->pages, slot);
+
+        gtk_notebook_append_page (self->notebook,
+                                  GTK_WIDGET (slot->bin),
+                                  gtk_label_new (page_kind_get_title (kind)));
+}
+
+static void
+build_page (NetConnectionEditor *self, PageSlot *slot)
+{
+        slot->page = g_object_ref_sink (create_page (self, slot->kind));
+
+        self->initializing_pages = g_slist_append (self->initializing_pages, slot->page);
+
+        g_signal_connect_object (slot->page, "changed", G_CALLBACK (page_changed), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (slot->page, "initialized", G_CALLBACK (page_initialized), self, G_CONNECT_SWAPPED);
+}
+
 static void
-add_page (NetConnectionEditor *self, CEPage *page)
+init_page (NetConnectionEditor *self, CEPage *page)
 {
-        gint position;
+        const gchar *security_setting;
+
+        security_setting = ce_page_get_security_setting (page);
+        if (!security_setting || self->is_new_connection) {
+                ce_page_complete_init (page, NULL, NULL, NULL, NULL);
+        } else {
+                get_secrets_for_page (self, page, security_setting);
+        }
+}
 
-        position = g_slist_length (self->initializing_pages);
-        g_object_set_data (G_OBJECT (page), "position", GINT_TO_POINTER (position));
+static void
+notebook_switch_page_cb (NetConnectionEditor *self,
+                         GtkWidget           *child)
+{
+        PageSlot *slot = find_page_slot (self, child);
 
-        self->initializing_pages = g_slist_append (self->initializing_pages, page);
+        if (!slot || slot->page)
+                return;
 
-        g_signal_connect_object (page, "changed", G_CALLBACK (page_changed), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (page, "initialized", G_CALLBACK (page_initialized), self, G_CONNECT_SWAPPED);
+        build_page (self, slot);
+        init_page (self, slot->page);
 }
 
 static void
 net_connection_editor_set_connection (NetConnectionEditor *self,
                                       NMConnection        *connection)
 {
-        GSList *pages, *l;
         NMSettingConnection *sc;
         const gchar *type;
         gboolean is_wired;
@@ -645,6 +867,7 @@ net_connection_editor_set_connection (NetConnectionEditor *self,
         gboolean is_vpn;
         gboolean is_wireguard;
         gboolean is_bluetooth;
+        guint i;
 
         self->is_new_connection = !nm_client_get_connection_by_uuid (self->client,
                                                                        nm_connection_get_uuid (connection));
@@ -670,45 +893,53 @@ net_connection_editor_set_connection (NetConnectionEditor *self,
         is_wireguard = g_str_equal (type, NM_SETTING_WIREGUARD_SETTING_NAME);
         is_bluetooth = g_str_equal (type, NM_SETTING_BLUETOOTH_SETTING_NAME);
 
-        add_page (self, CE_PAGE (ce_page_details_new (self->connection, self->device, self->ap, self, self->is_new_connection)));
+        if (!is_wifi && !is_wired && !is_vpn && !is_wireguard && !is_bluetooth) {
+                /* Unsupported type */
+                net_connection_editor_do_fallback (self, type);
+                return;
+        }
+
+        add_page (self, PAGE_DETAILS);
 
         if (is_wifi)
-                add_page (self, CE_PAGE (ce_page_wifi_new (self->connection, self->client)));
+                add_page (self, PAGE_WIFI);
         else if (is_wired)
-                add_page (self, CE_PAGE (ce_page_ethernet_new (self->connection, self->client)));
+                add_page (self, PAGE_ETHERNET);
         else if (is_vpn)
-                add_page (self, CE_PAGE (ce_page_vpn_new (self->connection)));
+                add_page (self, PAGE_VPN);
         else if (is_wireguard)
-                add_page (self, CE_PAGE (ce_page_wireguard_new (self->connection)));
+                add_page (self, PAGE_WIREGUARD);
         else if (is_bluetooth)
-                add_page (self, CE_PAGE (ce_page_bluetooth_new (self->connection)));
-        else {
-                /* Unsupported type */
-                net_connection_editor_do_fallback (self, type);
-                return;
-        }
+                add_page (self, PAGE_BLUETOOTH);
 
-        add_page (self, CE_PAGE (ce_page_ip4_new (self->connection, self->client)));
-        add_page (self, CE_PAGE (ce_page_ip6_new (self->connection, self->client)));
+        add_page (self, PAGE_IP4);
+        add_page (self, PAGE_IP6);
 
         if (is_wifi)
-                add_page (self, CE_PAGE (ce_page_security_new (self->connection)));
+                add_page (self, PAGE_SECURITY);
         else if (is_wired)
-                add_page (self, CE_PAGE (ce_page_8021x_security_new (self->connection)));
+                add_page (self, PAGE_8021X_SECURITY);
 
-        pages = g_slist_copy (self->initializing_pages);
-        for (l = pages; l; l = l->next) {
-                CEPage *page = l->data;
-                const gchar *security_setting;
+        /* Only the first page is built up front when editing; the others
+         * are built when their tab is first shown. New connections have
+         * no secrets to fetch and need all their pages validated before
+         * they can be added, so they are built right away. */
+        for (i = 0; i < self->pages->len; i++) {
+                PageSlot *slot = g_ptr_array_index (self->pages, i);
 
-                security_setting = ce_page_get_security_setting (page);
-                if (!security_setting || self->is_new_connection) {
-                        ce_page_complete_init (page, NULL, NULL, NULL, NULL);
-                } else {
-                        get_secrets_for_page (self, page, security_setting);
-                }
+                if (i == 0 || self->is_new_connection)
+                        build_page (self, slot);
         }
-        g_slist_free (pages);
+
+        for (i = 0; i < self->pages->len; i++) {
+                PageSlot *slot = g_ptr_array_index (self->pages, i);
+
+                if (slot->page)
+                        init_page (self, slot->page);
+        }
+
+        g_signal_connect_object (self->notebook, "switch-page",
+                                 G_CALLBACK (notebook_switch_page_cb), self, G_CONNECT_SWAPPED);
 }
 
 static NMConnection *
@@ -43,12 +43,18 @@
 #include "cc-wifi-connection-list.h"
 #include "cc-wifi-connection-row.h"
 
+/* Scans are repeated less often while the visible networks stay the same */
 #define PERIODIC_WIFI_SCAN_TIMEOUT 15
+#define MAX_WIFI_SCAN_TIMEOUT      120
+
+/* Time after which a scan without results is considered to have failed */
+#define WIFI_SCAN_RESULT_TIMEOUT   30
 
 static void nm_device_wifi_refresh_ui (NetDeviceWifi *self);
 static void show_wifi_list (NetDeviceWifi *self);
 static void show_hotspot_ui (NetDeviceWifi *self);
 static void nm_client_on_permission_change (NetDeviceWifi *self);
+static void set_scanning (NetDeviceWifi *self, gboolean scanning, gint64 last_scan);
 
 
 struct _NetDeviceWifi
@@ -90,8 +96,14 @@ struct _NetDeviceWifi
 
         gint64                   last_scan;
         gboolean                 scanning;
-
-        guint                    monitor_scanning_id;
+        gboolean                 scan_enabled;
+        gboolean                 aps_changed;
+        guint                    scan_interval;
+        gint64                   scan_start_time;
+        guint                    scan_count;
+        guint                    scan_latency;
+
+        guint                    scan_result_timeout_id;
         guint                    scan_id;
         GCancellable            *cancellable;
 };
@@ -99,6 +111,8 @@ struct _NetDeviceWifi
 enum {
         PROP_0,
         PROP_SCANNING,
+        PROP_SCAN_COUNT,
+        PROP_SCAN_LATENCY,
         PROP_LAST,
 };
 
@@ -108,8 +122,13 @@ static void
 disable_scan_timeout (NetDeviceWifi *self)
 {
         g_debug ("Disabling periodic Wi-Fi scan");
-        g_clear_handle_id (&self->monitor_scanning_id, g_source_remove);
+        self->scan_enabled = FALSE;
+        g_clear_handle_id (&self->scan_result_timeout_id, g_source_remove);
         g_clear_handle_id (&self->scan_id, g_source_remove);
+
+        /* Nobody waits for the results of a running scan any more, so the
+         * next start_periodic_scan() requests a new one right away */
+        set_scanning (self, FALSE, self->last_scan);
 }
 
 static void
@@ -334,24 +353,100 @@ set_scanning (NetDeviceWifi *self,
                 g_object_notify (G_OBJECT (self), "scanning");
 }
 
+static gboolean request_scan (gpointer user_data);
+
+static void
+schedule_scan (NetDeviceWifi *self,
+               guint          interval)
+{
+        g_clear_handle_id (&self->scan_id, g_source_remove);
+        self->scan_id = g_timeout_add_seconds (interval, request_scan, self);
+}
+
+static void
+finish_scan (NetDeviceWifi *self,
+             gboolean       success)
+{
+        g_clear_handle_id (&self->scan_result_timeout_id, g_source_remove);
+
+        if (success) {
+                self->scan_count++;
+                self->scan_latency = (g_get_monotonic_time () - self->scan_start_time) / 1000;
+                g_debug ("Wi-Fi scan %u finished after %u ms", self->scan_count, self->scan_latency);
+
+                g_object_notify (G_OBJECT (self), "scan-count");
+                g_object_notify (G_OBJECT (self), "scan-latency");
+        }
+
+        /* Back off while no networks appear or disappear */
+        if (self->aps_changed)
+                self->scan_interval = PERIODIC_WIFI_SCAN_TIMEOUT;
+        else
+                self->scan_interval = MIN (self->scan_interval * 2, MAX_WIFI_SCAN_TIMEOUT);
+        self->aps_changed = FALSE;
+
+        set_scanning (self, FALSE,
+                      nm_device_wifi_get_last_scan (NM_DEVICE_WIFI (self->device)));
+
+        if (self->scan_enabled) {
+                g_debug ("Next Wi-Fi scan in %u s", self->scan_interval);
+                schedule_scan (self, self->scan_interval);
+        }
+}
+
+static void
+on_last_scan_changed_cb (NetDeviceWifi *self)
+{
+        /* The last-scan property is updated after the device finished scanning */
+        if (self->scanning) {
+                finish_scan (self, TRUE);
+                return;
+        }
+
+        /* Someone else scanned, so the results are fresh already */
+        if (self->scan_enabled)
+                schedule_scan (self, self->scan_interval);
+}
+
+static void
+on_access_points_changed_cb (NetDeviceWifi *self)
+{
+        self->aps_changed = TRUE;
+}
+
 static gboolean
-update_scanning (gpointer user_data)
+scan_result_timeout_cb (gpointer user_data)
 {
         NetDeviceWifi *self = user_data;
-        gint64 last_scan;
 
-        last_scan = nm_device_wifi_get_last_scan (NM_DEVICE_WIFI (self->device));
+        g_debug ("Wi-Fi scan timed out");
 
-        /* The last_scan property is updated after the device finished scanning,
-         * so notify about it and stop monitoring for changes.
-         */
-        if (self->last_scan != last_scan) {
-                set_scanning (self, FALSE, last_scan);
-                self->monitor_scanning_id = 0;
-                return G_SOURCE_REMOVE;
-        }
+        self->scan_result_timeout_id = 0;
+        finish_scan (self, FALSE);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+request_scan_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+        NetDeviceWifi *self;
+        g_autoptr(GError) error = NULL;
+
+        if (nm_device_wifi_request_scan_finish (NM_DEVICE_WIFI (source_object), result, &error))
+                return;
+
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                return;
+
+        /* NetworkManager refuses scans requested too often */
+        g_debug ("Wi-Fi scan request failed: %s", error->message);
 
-        return G_SOURCE_CONTINUE;
+        self = NET_DEVICE_WIFI (user_data);
+        if (self->scanning)
+                finish_scan (self, FALSE);
 }
 
 static gboolean
@@ -359,20 +454,50 @@ request_scan (gpointer user_data)
 {
         NetDeviceWifi *self = user_data;
 
-        g_debug ("Periodic Wi-Fi scan requested");
+        self->scan_id = 0;
+
+        /* The next scan is scheduled once this one is finished */
+        if (self->scanning) {
+                if (self->scan_result_timeout_id == 0)
+                        self->scan_result_timeout_id = g_timeout_add_seconds (WIFI_SCAN_RESULT_TIMEOUT,
+                                                                              scan_result_timeout_cb,
+                                                                              self);
+                return G_SOURCE_REMOVE;
+        }
+
+        g_debug ("Wi-Fi scan requested");
 
+        self->scan_start_time = g_get_monotonic_time ();
         set_scanning (self, TRUE,
                       nm_device_wifi_get_last_scan (NM_DEVICE_WIFI (self->device)));
 
-        if (self->monitor_scanning_id == 0) {
-                self->monitor_scanning_id = g_timeout_add (1500, update_scanning,
-                                                                  self);
-        }
+        self->scan_result_timeout_id = g_timeout_add_seconds (WIFI_SCAN_RESULT_TIMEOUT,
+                                                              scan_result_timeout_cb,
+                                                              self);
 
         nm_device_wifi_request_scan_async (NM_DEVICE_WIFI (self->device),
-                                           self->cancellable, NULL, NULL);
+                                           self->cancellable, request_scan_cb, self);
 
-        return G_SOURCE_CONTINUE;
+        return G_SOURCE_REMOVE;
+}
+
+/* Scans only run while the list of networks is visible */
+static void
+start_periodic_scan (NetDeviceWifi *self)
+{
+        if (self->scan_enabled ||
+            !gtk_widget_get_mapped (GTK_WIDGET (self)) ||
+            !nm_client_wireless_get_enabled (self->client) ||
+            device_is_hotspot (self))
+                return;
+
+        g_debug ("Enabling periodic Wi-Fi scan");
+
+        self->scan_enabled = TRUE;
+        self->scan_interval = PERIODIC_WIFI_SCAN_TIMEOUT;
+
+        /* The list may be outdated when it is shown again, so scan right away */
+        request_scan (self);
 }
 
 static void
@@ -387,12 +512,7 @@ nm_device_wifi_refresh_ui (NetDeviceWifi *self)
                 return;
         }
 
-        if (self->scan_id == 0 &&
-            nm_client_wireless_get_enabled (self->client)) {
-                self->scan_id = g_timeout_add_seconds (PERIODIC_WIFI_SCAN_TIMEOUT,
-                                                       request_scan, self);
-                request_scan (self);
-        }
+        start_periodic_scan (self);
 
         /* keep this in sync with the signal handler setup in cc_network_panel_init */
         wireless_enabled_toggled (self);
@@ -799,7 +919,8 @@ net_device_wifi_finalize (GObject *object)
 
         g_cancellable_cancel (self->cancellable);
         g_clear_object (&self->cancellable);
-        disable_scan_timeout (self);
+        g_clear_handle_id (&self->scan_result_timeout_id, g_source_remove);
+        g_clear_handle_id (&self->scan_id, g_source_remove);
 
         g_clear_object (&self->client);
         g_clear_object (&self->device);
@@ -823,6 +944,12 @@ net_device_wifi_get_property (GObject    *object,
         case PROP_SCANNING:
                 g_value_set_boolean (value, self->scanning);
                 break;
+        case PROP_SCAN_COUNT:
+                g_value_set_uint (value, self->scan_count);
+                break;
+        case PROP_SCAN_LATENCY:
+                g_value_set_uint (value, self->scan_latency);
+                break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
                 break;
@@ -972,23 +1099,17 @@ history_sort (gconstpointer a, gconstpointer b, gpointer data)
 static gint
 ap_sort (gconstpointer a, gconstpointer b, gpointer data)
 {
-        NetDeviceWifi *self = data;
         CcWifiConnectionRow *a_row = CC_WIFI_CONNECTION_ROW ((gpointer) a);
         CcWifiConnectionRow *b_row = CC_WIFI_CONNECTION_ROW ((gpointer) b);
-        NMActiveConnection *active_connection;
         gboolean a_configured, b_configured;
-        NMAccessPoint *apa, *apb;
         guint sa, sb;
 
-        /* Show the connected AP first */
-        active_connection = nm_device_get_active_connection (NM_DEVICE (self->device));
-        if (active_connection != NULL) {
-                NMConnection *connection = NM_CONNECTION (nm_active_connection_get_connection (active_connection));
-                if (connection == cc_wifi_connection_row_get_connection (a_row))
-                        return -1;
-                else if (connection == cc_wifi_connection_row_get_connection (b_row))
-                        return 1;
-        }
+        /* Show the connected AP first; the rows cache their sort keys so
+         * that nothing needs to be queried from NetworkManager here */
+        if (cc_wifi_connection_row_get_is_active (a_row))
+                return -1;
+        else if (cc_wifi_connection_row_get_is_active (b_row))
+                return 1;
 
         /* Show configured networks before non-configured */
         a_configured = cc_wifi_connection_row_get_connection (a_row) != NULL;
@@ -999,19 +1120,8 @@ ap_sort (gconstpointer a, gconstpointer b, gpointer data)
         }
 
         /* Show higher strength networks above lower strength ones */
-
-        apa = cc_wifi_connection_row_best_access_point (a_row);
-        apb = cc_wifi_connection_row_best_access_point (b_row);
-
-        if (apa)
-                sa = nm_access_point_get_strength (apa);
-        else
-                sa = 0;
-
-        if (apb)
-                sb = nm_access_point_get_strength (apb);
-        else
-                sb = 0;
+        sa = cc_wifi_connection_row_get_strength_level (a_row);
+        sb = cc_wifi_connection_row_get_strength_level (b_row);
 
         if (sa > sb) return -1;
         if (sb > sa) return 1;
@@ -1106,6 +1216,26 @@ ap_activated (NetDeviceWifi *self, GtkListBoxRow *row)
         }
 }
 
+static void
+net_device_wifi_map (GtkWidget *widget)
+{
+        NetDeviceWifi *self = NET_DEVICE_WIFI (widget);
+
+        GTK_WIDGET_CLASS (net_device_wifi_parent_class)->map (widget);
+
+        start_periodic_scan (self);
+}
+
+static void
+net_device_wifi_unmap (GtkWidget *widget)
+{
+        NetDeviceWifi *self = NET_DEVICE_WIFI (widget);
+
+        disable_scan_timeout (self);
+
+        GTK_WIDGET_CLASS (net_device_wifi_parent_class)->unmap (widget);
+}
+
 static void
 net_device_wifi_class_init (NetDeviceWifiClass *klass)
 {
@@ -1116,6 +1246,9 @@ net_device_wifi_class_init (NetDeviceWifiClass *klass)
         object_class->finalize = net_device_wifi_finalize;
         object_class->get_property = net_device_wifi_get_property;
 
+        widget_class->map = net_device_wifi_map;
+        widget_class->unmap = net_device_wifi_unmap;
+
         g_object_class_install_property (object_class,
                                          PROP_SCANNING,
                                          g_param_spec_boolean ("scanning",
@@ -1124,6 +1257,22 @@ net_device_wifi_class_init (NetDeviceWifiClass *klass)
                                                                FALSE,
                                                                G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+        g_object_class_install_property (object_class,
+                                         PROP_SCAN_COUNT,
+                                         g_param_spec_uint ("scan-count",
+                                                            "Scan count",
+                                                            "Number of finished scans for access points",
+                                                            0, G_MAXUINT, 0,
+                                                            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+        g_object_class_install_property (object_class,
+                                         PROP_SCAN_LATENCY,
+                                         g_param_spec_uint ("scan-latency",
+                                                            "Scan latency",
+                                                            "Duration of the last scan for access points in milliseconds",
+                                                            0, G_MAXUINT, 0,
+                                                            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
         gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/control-center/network/network-wifi.ui");
 
         gtk_widget_class_bind_template_child (widget_class, NetDeviceWifi, wifi_headerbar_title);
@@ -1199,6 +1348,13 @@ net_device_wifi_new (CcPanel *panel, NMClient *client, NMDevice *device)
 
         g_signal_connect_object (device, "state-changed", G_CALLBACK (nm_device_wifi_refresh_ui), self, G_CONNECT_SWAPPED);
 
+        g_signal_connect_object (device, "notify::" NM_DEVICE_WIFI_LAST_SCAN,
+                                 G_CALLBACK (on_last_scan_changed_cb), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (device, "access-point-added",
+                                 G_CALLBACK (on_access_points_changed_cb), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (device, "access-point-removed",
+                                 G_CALLBACK (on_access_points_changed_cb), self, G_CONNECT_SWAPPED);
+
         /* Set up the main Visible Networks list */
         list = cc_wifi_connection_list_new (client, NM_DEVICE_WIFI (device), TRUE, TRUE, FALSE, FALSE);
         gtk_box_append (self->listbox_box, GTK_WIDGET (list));
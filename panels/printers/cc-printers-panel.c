@@ -39,22 +39,17 @@
 #include "pp-utils.h"
 #include "pp-cups.h"
 #include "pp-printer-entry.h"
-#include "pp-job.h"
+#include "pp-notifier.h"
 #include "pp-new-printer.h"
 
 #include "cc-permission-infobar.h"
 #include "cc-util.h"
 
-#define JOB_DEFAULT_PRIORITY  50
-#define RENEW_INTERVAL        500
-#define SUBSCRIPTION_DURATION 600
-
-#define CUPS_DBUS_NAME      "org.cups.cupsd.Notifier"
-#define CUPS_DBUS_PATH      "/org/cups/cupsd/Notifier"
-#define CUPS_DBUS_INTERFACE "org.cups.cupsd.Notifier"
 
 #define CUPS_STATUS_CHECK_INTERVAL 5
 
+#define PRINTER_REFRESH_DELAY_MS 250
+
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
@@ -93,13 +88,15 @@ struct _CcPrintersPanel
 
   PpNewPrinterDialog   *pp_new_printer_dialog;
 
-  GDBusProxy      *cups_proxy;
-  GDBusConnection *cups_bus_connection;
-  gint             subscription_id;
-  guint            subscription_renewal_id;
+  PpNotifier      *notifier;
+
   guint            cups_status_check_id;
-  guint            dbus_subscription_id;
   guint            remove_printer_timeout_id;
+  guint            printers_refresh_id;
+  guint            printers_flush_id;
+  guint            actualize_id;
+  gboolean         actualize_running;
+  gboolean         actualize_pending;
 
   PPDList      *all_ppds_list;
 
@@ -112,6 +109,8 @@ struct _CcPrintersPanel
   GObject  *reference;
 
   GHashTable *printer_entries;
+  GHashTable *stale_printers;
+  GHashTable *dirty_printers;
   gboolean    entries_filled;
   GVariant   *action;
 
@@ -134,9 +133,11 @@ enum {
 };
 
 static void actualize_printers_list (CcPrintersPanel *self);
+static void actualize_printers_list_done (CcPrintersPanel *self);
 static void update_sensitivity (gpointer user_data);
-static void detach_from_cups_notifier (gpointer data);
 static void free_dests (CcPrintersPanel *self);
+static void add_printer_entry (CcPrintersPanel *self,
+                               cups_dest_t      printer);
 static void set_current_page (GObject      *source_object,
                               GAsyncResult *result,
                               gpointer      user_data);
@@ -300,7 +301,9 @@ cc_printers_panel_dispose (GObject *object)
 {
   CcPrintersPanel *self = CC_PRINTERS_PANEL (object);
 
-  detach_from_cups_notifier (CC_PRINTERS_PANEL (object));
+  if (self->notifier != NULL)
+    g_signal_handlers_disconnect_by_data (self->notifier, self);
+  g_clear_object (&self->notifier);
 
   if (self->deleted_printer_name != NULL)
     {
@@ -316,6 +319,11 @@ cc_printers_panel_dispose (GObject *object)
   g_clear_object (&self->permission);
   g_clear_handle_id (&self->cups_status_check_id, g_source_remove);
   g_clear_handle_id (&self->remove_printer_timeout_id, g_source_remove);
+  g_clear_handle_id (&self->printers_refresh_id, g_source_remove);
+  g_clear_handle_id (&self->printers_flush_id, g_source_remove);
+  g_clear_handle_id (&self->actualize_id, g_source_remove);
+  g_clear_pointer (&self->stale_printers, g_hash_table_destroy);
+  g_clear_pointer (&self->dirty_printers, g_hash_table_destroy);
   g_clear_pointer (&self->deleted_printer_name, g_free);
   g_clear_pointer (&self->action, g_variant_unref);
   g_clear_pointer (&self->printer_entries, g_hash_table_destroy);
@@ -336,261 +344,246 @@ cc_printers_panel_get_help_uri (CcPanel *panel)
   return "help:gnome-help/printing";
 }
 
+/*
+ * Options of self->dests serve as a cache of printer attributes.
+ * Printer notifications update the cache and mark the affected
+ * entries dirty; dirty entries are redrawn together before the next
+ * frame.  Attributes which are not part of the notification are
+ * refreshed for all changed printers in one request.
+ */
 static void
-on_get_job_attributes_cb (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
+update_printer_entries (CcPrintersPanel *self,
+                        const gchar     *printer_name)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  const gchar            *job_originating_user_name;
-  const gchar            *job_printer_uri;
-  g_autoptr(GVariant)     attributes = NULL;
-  g_autoptr(GError)       error = NULL;
+  PpPrinterEntry *printer_entry;
+  gint            i;
 
-  attributes = pp_job_get_attributes_finish (PP_JOB (source_object), res, &error);
+  printer_entry = g_hash_table_lookup (self->printer_entries, printer_name);
+  if (printer_entry == NULL)
+    return;
 
-  if (attributes != NULL)
+  for (i = 0; i < self->num_dests; i++)
     {
-      g_autoptr(GVariant) username = NULL;
+      if (g_strcmp0 (self->dests[i].name, printer_name) == 0)
+        pp_printer_entry_update (printer_entry, self->dests[i], self->is_authorized);
+    }
+}
 
-      if ((username = g_variant_lookup_value (attributes, "job-originating-user-name", G_VARIANT_TYPE ("as"))) != NULL)
-        {
-          g_autoptr(GVariant) printer_uri = NULL;
+static gboolean
+flush_dirty_printers (gpointer user_data)
+{
+  CcPrintersPanel *self = user_data;
+  GHashTableIter   iter;
+  gpointer         key;
 
-          if ((printer_uri = g_variant_lookup_value (attributes, "job-printer-uri", G_VARIANT_TYPE ("as"))) != NULL)
-            {
-              job_originating_user_name = g_variant_get_string (g_variant_get_child_value (username, 0), NULL);
-              job_printer_uri = g_variant_get_string (g_variant_get_child_value (printer_uri, 0), NULL);
+  self->printers_flush_id = 0;
 
-              if (job_originating_user_name != NULL && job_printer_uri != NULL &&
-                  g_strcmp0 (job_originating_user_name, cupsUser ()) == 0 &&
-                  g_strrstr (job_printer_uri, "/") != 0 &&
-                  self->dests != NULL)
-                {
-                  PpPrinterEntry *printer_entry;
-                  gchar *printer_name;
+  g_hash_table_iter_init (&iter, self->dirty_printers);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    update_printer_entries (self, key);
 
-                  printer_name = g_strrstr (job_printer_uri, "/") + 1;
-                  printer_entry = PP_PRINTER_ENTRY (g_hash_table_lookup (self->printer_entries, printer_name));
+  g_hash_table_remove_all (self->dirty_printers);
 
-                  pp_printer_entry_update_jobs_count (printer_entry);
-                }
-            }
-        }
-    }
+  return G_SOURCE_REMOVE;
 }
 
 static void
-on_cups_notification (GDBusConnection *connection,
-                      const char      *sender_name,
-                      const char      *object_path,
-                      const char      *interface_name,
-                      const char      *signal_name,
-                      GVariant        *parameters,
-                      gpointer         user_data)
+mark_printer_dirty (CcPrintersPanel *self,
+                    const gchar     *printer_name)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  gboolean                printer_is_accepting_jobs;
-  gchar                  *printer_name = NULL;
-  gchar                  *text = NULL;
-  gchar                  *printer_uri = NULL;
-  gchar                  *printer_state_reasons = NULL;
-  gchar                  *job_state_reasons = NULL;
-  gchar                  *job_name = NULL;
-  guint                   job_id;
-  gint                    printer_state;
-  gint                    job_state;
-  gint                    job_impressions_completed;
-  static gchar *requested_attrs[] = {
-    "job-printer-uri",
-    "job-originating-user-name",
-    NULL };
-
-  if (g_strcmp0 (signal_name, "PrinterAdded") != 0 &&
-      g_strcmp0 (signal_name, "PrinterDeleted") != 0 &&
-      g_strcmp0 (signal_name, "PrinterStateChanged") != 0 &&
-      g_strcmp0 (signal_name, "PrinterStopped") != 0 &&
-      g_strcmp0 (signal_name, "JobCreated") != 0 &&
-      g_strcmp0 (signal_name, "JobCompleted") != 0)
-    return;
+  g_hash_table_add (self->dirty_printers, g_strdup (printer_name));
+
+  /* Run before GTK relayouts and redraws so that a burst of
+   * notifications results in a single update of each entry.
+   */
+  if (self->printers_flush_id == 0)
+    self->printers_flush_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 10,
+                                               flush_dirty_printers,
+                                               self,
+                                               NULL);
+}
 
-  if (g_variant_n_children (parameters) == 1)
-    g_variant_get (parameters, "(&s)", &text);
- else if (g_variant_n_children (parameters) == 6)
-    {
-      g_variant_get (parameters, "(&s&s&su&sb)",
-                     &text,
-                     &printer_uri,
-                     &printer_name,
-                     &printer_state,
-                     &printer_state_reasons,
-                     &printer_is_accepting_jobs);
-    }
-  else if (g_variant_n_children (parameters) == 11)
-    {
-      g_variant_get (parameters, "(&s&s&su&sbuu&s&su)",
-                     &text,
-                     &printer_uri,
-                     &printer_name,
-                     &printer_state,
-                     &printer_state_reasons,
-                     &printer_is_accepting_jobs,
-                     &job_id,
-                     &job_state,
-                     &job_state_reasons,
-                     &job_name,
-                     &job_impressions_completed);
-    }
+static void
+set_printer_option (CcPrintersPanel *self,
+                    const gchar     *printer_name,
+                    const gchar     *option_name,
+                    const gchar     *value)
+{
+  gint i;
 
-  if (g_strcmp0 (signal_name, "PrinterAdded") == 0 ||
-      g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStopped") == 0)
-    actualize_printers_list (self);
-  else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
-           g_strcmp0 (signal_name, "JobCompleted") == 0)
+  for (i = 0; i < self->num_dests; i++)
     {
-      g_autoptr(PpJob) job = NULL;
-
-      job = pp_job_new (job_id, NULL, 0, JOB_DEFAULT_PRIORITY, NULL);
-      pp_job_get_attributes_async (job,
-                                   requested_attrs,
-                                   cc_panel_get_cancellable (CC_PANEL (self)),
-                                   on_get_job_attributes_cb,
-                                   self);
+      if (g_strcmp0 (self->dests[i].name, printer_name) == 0)
+        self->dests[i].num_options = cupsAddOption (option_name,
+                                                    value,
+                                                    self->dests[i].num_options,
+                                                    &self->dests[i].options);
     }
 }
 
-static gchar *subscription_events[] = {
-  "printer-added",
-  "printer-deleted",
-  "printer-stopped",
-  "printer-state-changed",
-  "job-created",
-  "job-completed",
-  NULL};
-
 static void
-renew_subscription_cb (GObject      *source_object,
-           GAsyncResult *result,
-           gpointer      user_data)
+add_printer_from_dest (CcPrintersPanel *self,
+                       cups_dest_t     *dest)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  gint                    subscription_id;
+  cups_dest_t *added;
+  gint         i;
 
-  subscription_id = pp_cups_renew_subscription_finish (PP_CUPS (source_object), result);
+  self->num_dests = cupsAddDest (dest->name, NULL, self->num_dests, &self->dests);
 
-  if (subscription_id > 0)
-      self->subscription_id = subscription_id;
-}
+  added = cupsGetDest (dest->name, NULL, self->num_dests, self->dests);
+  if (added == NULL)
+    return;
 
-static gboolean
-renew_subscription (gpointer data)
-{
-  CcPrintersPanel        *self = (CcPrintersPanel*) data;
+  for (i = 0; i < dest->num_options; i++)
+    added->num_options = cupsAddOption (dest->options[i].name,
+                                        dest->options[i].value,
+                                        added->num_options,
+                                        &added->options);
 
-  pp_cups_renew_subscription_async (self->cups,
-                                    self->subscription_id,
-                                    subscription_events,
-                                    SUBSCRIPTION_DURATION,
-                                    cc_panel_get_cancellable (CC_PANEL (self)),
-                                    renew_subscription_cb,
-                                    data);
+  add_printer_entry (self, *added);
 
-  return G_SOURCE_CONTINUE;
+  gtk_stack_set_visible_child_name (self->main_stack, "printers-list");
+  update_sensitivity (self);
 }
 
 static void
-attach_to_cups_notifier_cb (GObject      *source_object,
-                            GAsyncResult *result,
-                            gpointer      user_data)
+refresh_printers_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  g_autoptr(GError)       error = NULL;
-  gint                    subscription_id;
+  CcPrintersPanel   *self;
+  PpCupsDests       *cups_dests;
+  g_autoptr(GError)  error = NULL;
+  gint               i, j;
 
-  subscription_id = pp_cups_renew_subscription_finish (PP_CUPS (source_object), result);
+  cups_dests = pp_cups_get_printers_attributes_finish (PP_CUPS (source_object), result, &error);
 
-  if (subscription_id > 0)
+  if (cups_dests == NULL)
     {
-      self->subscription_id = subscription_id;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not get printer attributes: %s", error->message);
 
-      self->subscription_renewal_id =
-        g_timeout_add_seconds (RENEW_INTERVAL, renew_subscription, self);
+      return;
+    }
 
-      self->cups_proxy = cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SYSTEM,
-                                                                   G_DBUS_PROXY_FLAGS_NONE,
-                                                                   CUPS_DBUS_NAME,
-                                                                   CUPS_DBUS_PATH,
-                                                                   CUPS_DBUS_INTERFACE,
-                                                                   NULL,
-                                                                   &error);
+  self = user_data;
 
-      if (!self->cups_proxy)
+  for (i = 0; i < cups_dests->num_of_dests; i++)
+    {
+      cups_dest_t *dest = &cups_dests->dests[i];
+
+      if (cupsGetDest (dest->name, dest->instance, self->num_dests, self->dests) == NULL)
         {
-          g_warning ("%s", error->message);
-          return;
+          add_printer_from_dest (self, dest);
+          continue;
         }
 
-      self->cups_bus_connection = g_dbus_proxy_get_connection (self->cups_proxy);
-
-      self->dbus_subscription_id =
-        g_dbus_connection_signal_subscribe (self->cups_bus_connection,
-                                            NULL,
-                                            CUPS_DBUS_INTERFACE,
-                                            NULL,
-                                            CUPS_DBUS_PATH,
-                                            NULL,
-                                            0,
-                                            on_cups_notification,
-                                            self,
-                                            NULL);
+      for (j = 0; j < dest->num_options; j++)
+        set_printer_option (self, dest->name, dest->options[j].name, dest->options[j].value);
+
+      mark_printer_dirty (self, dest->name);
     }
+
+  cupsFreeDests (cups_dests->num_of_dests, cups_dests->dests);
+  g_free (cups_dests);
+}
+
+static gboolean
+refresh_stale_printers (gpointer user_data)
+{
+  CcPrintersPanel *self = user_data;
+  g_auto(GStrv)    printer_names = NULL;
+
+  self->printers_refresh_id = 0;
+
+  /* Stealing the keys passes their ownership to printer_names */
+  printer_names = (GStrv) g_hash_table_get_keys_as_array (self->stale_printers, NULL);
+  g_hash_table_steal_all (self->stale_printers);
+
+  pp_cups_get_printers_attributes_async (self->cups,
+                                         printer_names,
+                                         cc_panel_get_cancellable (CC_PANEL (self)),
+                                         refresh_printers_cb,
+                                         self);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
-attach_to_cups_notifier (gpointer data)
+mark_printer_stale (CcPrintersPanel *self,
+                    const gchar     *printer_name)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) data;
-
-  pp_cups_renew_subscription_async (self->cups,
-                                    self->subscription_id,
-                                    subscription_events,
-                                    SUBSCRIPTION_DURATION,
-                                    cc_panel_get_cancellable (CC_PANEL (self)),
-                                    attach_to_cups_notifier_cb,
-                                    data);
+  g_hash_table_add (self->stale_printers, g_strdup (printer_name));
+  if (self->printers_refresh_id == 0)
+    self->printers_refresh_id = g_timeout_add (PRINTER_REFRESH_DELAY_MS, refresh_stale_printers, self);
 }
 
 static void
-subscription_cancel_cb (GObject      *source_object,
-                        GAsyncResult *result,
-                        gpointer      user_data)
+update_printer_from_notification (CcPrintersPanel *self,
+                                  const gchar     *printer_name,
+                                  gint             printer_state,
+                                  const gchar     *printer_state_reasons,
+                                  gboolean         printer_is_accepting_jobs)
 {
-  pp_cups_cancel_subscription_finish (PP_CUPS (source_object), result);
+  g_autofree gchar *state = NULL;
+
+  state = g_strdup_printf ("%d", printer_state);
+
+  set_printer_option (self, printer_name, "printer-state", state);
+  set_printer_option (self, printer_name, "printer-state-reasons", printer_state_reasons);
+  set_printer_option (self, printer_name, "printer-is-accepting-jobs",
+                      printer_is_accepting_jobs ? "true" : "false");
+
+  mark_printer_dirty (self, printer_name);
+  mark_printer_stale (self, printer_name);
 }
 
 static void
-detach_from_cups_notifier (gpointer data)
+remove_printer_from_notification (CcPrintersPanel *self,
+                                  const gchar     *printer_name)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) data;
+  PpPrinterEntry *printer_entry;
+  gint            i;
 
-  if (self->dbus_subscription_id != 0) {
-    g_dbus_connection_signal_unsubscribe (self->cups_bus_connection,
-                                          self->dbus_subscription_id);
-    self->dbus_subscription_id = 0;
-  }
+  g_hash_table_remove (self->stale_printers, printer_name);
+  g_hash_table_remove (self->dirty_printers, printer_name);
 
-  pp_cups_cancel_subscription_async (self->cups,
-                                     self->subscription_id,
-                                     subscription_cancel_cb,
-                                     NULL);
+  /* Removes all instances of the printer */
+  for (i = self->num_dests - 1; i >= 0; i--)
+    {
+      if (g_strcmp0 (self->dests[i].name, printer_name) == 0)
+        self->num_dests = cupsRemoveDest (printer_name,
+                                          self->dests[i].instance,
+                                          self->num_dests,
+                                          &self->dests);
+    }
 
-  self->subscription_id = 0;
+  printer_entry = g_hash_table_lookup (self->printer_entries, printer_name);
+  if (printer_entry != NULL)
+    {
+      gtk_list_box_remove (self->content, GTK_WIDGET (printer_entry));
+      g_hash_table_remove (self->printer_entries, printer_name);
+    }
 
-  g_clear_handle_id (&self->subscription_renewal_id, g_source_remove);
+  if (self->num_dests == 0 && self->new_printer_name == NULL)
+    pp_cups_connection_test_async (self->cups, NULL, set_current_page, self);
+}
 
-  g_clear_object (&self->cups_proxy);
+static void
+on_printer_state_changed (CcPrintersPanel *self,
+                          const gchar     *printer_name,
+                          gint             printer_state,
+                          const gchar     *printer_state_reasons,
+                          gboolean         printer_is_accepting_jobs)
+{
+  if (g_hash_table_contains (self->printer_entries, printer_name))
+    update_printer_from_notification (self,
+                                      printer_name,
+                                      printer_state,
+                                      printer_state_reasons,
+                                      printer_is_accepting_jobs);
+  else
+    mark_printer_stale (self, printer_name);
 }
 
 static void
@@ -799,11 +792,16 @@ actualize_printers_list_cb (GObject      *source_object,
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
           g_warning ("Could not get dests: %s", error->message);
+          actualize_printers_list_done (self);
         }
 
       return;
     }
 
+  /* The full list supersedes all pending per-printer updates */
+  g_hash_table_remove_all (self->dirty_printers);
+  g_clear_handle_id (&self->printers_flush_id, g_source_remove);
+
   free_dests (self);
   self->dests = cups_dests->dests;
   self->num_dests = cups_dests->num_of_dests;
@@ -880,15 +878,56 @@ actualize_printers_list_cb (GObject      *source_object,
                                     allocation.y - gtk_widget_get_margin_top (printer_entry));
         }
     }
+
+  actualize_printers_list_done (self);
 }
 
-static void
-actualize_printers_list (CcPrintersPanel *self)
+static gboolean
+actualize_printers_list_idle (gpointer user_data)
 {
+  CcPrintersPanel *self = user_data;
+
+  self->actualize_id = 0;
+
+  if (self->actualize_running)
+    {
+      self->actualize_pending = TRUE;
+      return G_SOURCE_REMOVE;
+    }
+
+  self->actualize_running = TRUE;
   pp_cups_get_dests_async (self->cups,
                            cc_panel_get_cancellable (CC_PANEL (self)),
                            actualize_printers_list_cb,
                            self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Reloads the whole list of printers.  Requests made while the list
+ * is being fetched are merged into a single reload done afterwards.
+ */
+static void
+actualize_printers_list (CcPrintersPanel *self)
+{
+  if (self->actualize_id == 0)
+    self->actualize_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 10,
+                                          actualize_printers_list_idle,
+                                          self,
+                                          NULL);
+}
+
+static void
+actualize_printers_list_done (CcPrintersPanel *self)
+{
+  self->actualize_running = FALSE;
+
+  if (self->actualize_pending)
+    {
+      self->actualize_pending = FALSE;
+      actualize_printers_list (self);
+    }
 }
 
 static void
@@ -1012,8 +1051,15 @@ update_sensitivity (gpointer user_data)
 static void
 on_permission_changed (CcPrintersPanel *self)
 {
-  actualize_printers_list (self);
+  GHashTableIter iter;
+  gpointer       key;
+
   update_sensitivity (self);
+
+  /* Only the authorization of the entries changes */
+  g_hash_table_iter_init (&iter, self->printer_entries);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    mark_printer_dirty (self, key);
 }
 
 static void
@@ -1044,7 +1090,7 @@ cups_status_check_cb (GObject      *source_object,
   if (success)
     {
       actualize_printers_list (self);
-      attach_to_cups_notifier (self);
+      pp_notifier_renew_subscription (self->notifier);
 
       g_clear_handle_id (&self->cups_status_check_id, g_source_remove);
     }
@@ -1250,6 +1296,34 @@ cc_printers_panel_init (CcPrintersPanel *self)
                                                  g_free,
                                                  NULL);
 
+  self->stale_printers = g_hash_table_new_full (g_str_hash,
+                                                g_str_equal,
+                                                g_free,
+                                                NULL);
+
+  self->dirty_printers = g_hash_table_new_full (g_str_hash,
+                                                g_str_equal,
+                                                g_free,
+                                                NULL);
+
+  self->notifier = pp_notifier_get_default ();
+  g_signal_connect_swapped (self->notifier,
+                            "printer-added",
+                            G_CALLBACK (mark_printer_stale),
+                            self);
+  g_signal_connect_swapped (self->notifier,
+                            "printer-deleted",
+                            G_CALLBACK (remove_printer_from_notification),
+                            self);
+  g_signal_connect_swapped (self->notifier,
+                            "printer-state-changed",
+                            G_CALLBACK (on_printer_state_changed),
+                            self);
+  g_signal_connect_swapped (self->notifier,
+                            "printers-changed",
+                            G_CALLBACK (actualize_printers_list),
+                            self);
+
   g_type_ensure (CC_TYPE_PERMISSION_INFOBAR);
 
   g_object_set_data_full (self->reference, "self", self, NULL);
@@ -1302,7 +1376,6 @@ Please check your installation");
   self->size_group = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
 
   actualize_printers_list (self);
-  attach_to_cups_notifier (self);
 
   get_all_ppds_async (cc_panel_get_cancellable (CC_PANEL (self)),
                       get_all_ppds_async_cb,
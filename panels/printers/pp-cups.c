@@ -104,6 +104,179 @@ pp_cups_get_dests_finish (PpCups        *self,
   return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+/*
+ * Attributes of printers shown in the list of printers.
+ * They are stored as options of cups_dest_t in the same
+ * format as cupsGetDests() uses.
+ */
+static const gchar * const printer_list_attributes[] = {
+  "printer-name",
+  "printer-info",
+  "printer-location",
+  "printer-make-and-model",
+  "printer-state",
+  "printer-state-reasons",
+  "printer-is-accepting-jobs",
+  "printer-type",
+  "printer-uri-supported",
+  "device-uri",
+  "marker-names",
+  "marker-levels",
+  "marker-colors",
+  "marker-types",
+};
+
+static void
+add_dest_option_from_attribute (cups_dest_t     *dest,
+                                ipp_attribute_t *attr)
+{
+  g_autofree gchar *value = NULL;
+  gsize             length;
+
+  switch (ippGetValueTag (attr))
+    {
+      case IPP_TAG_INTEGER:
+      case IPP_TAG_ENUM:
+        value = g_strdup_printf ("%d", ippGetInteger (attr, 0));
+        break;
+      case IPP_TAG_BOOLEAN:
+        value = g_strdup (ippGetBoolean (attr, 0) ? "true" : "false");
+        break;
+      default:
+        length = ippAttributeString (attr, NULL, 0) + 1;
+        value = g_malloc (length);
+        ippAttributeString (attr, value, length);
+        break;
+    }
+
+  dest->num_options = cupsAddOption (ippGetName (attr),
+                                     value,
+                                     dest->num_options,
+                                     &dest->options);
+}
+
+static void
+get_printers_attributes_thread (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+  ipp_attribute_t *attr;
+  PpCupsDests     *dests;
+  GStrv            printer_names = task_data;
+  ipp_t           *request;
+  ipp_t           *response;
+
+  /* One printer is asked directly, more of them in one batch */
+  if (printer_names != NULL && g_strv_length (printer_names) == 1)
+    {
+      g_autofree gchar *printer_uri = NULL;
+
+      printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", printer_names[0]);
+
+      request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
+      ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                    "printer-uri", NULL, printer_uri);
+    }
+  else
+    {
+      request = ippNewRequest (CUPS_GET_PRINTERS);
+    }
+
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (printer_list_attributes),
+                 NULL, (const char * const *) printer_list_attributes);
+  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+
+  if (response == NULL || ippGetStatusCode (response) > IPP_OK_CONFLICT)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "%s", cupsLastErrorString ());
+      ippDelete (response);
+      return;
+    }
+
+  dests = g_new0 (PpCupsDests, 1);
+
+  for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
+    {
+      cups_dest_t  dest = { 0, };
+      const gchar *printer_name = NULL;
+
+      while (attr != NULL && ippGetGroupTag (attr) != IPP_TAG_PRINTER)
+        attr = ippNextAttribute (response);
+
+      if (attr == NULL)
+        break;
+
+      for (; attr != NULL && ippGetGroupTag (attr) == IPP_TAG_PRINTER; attr = ippNextAttribute (response))
+        {
+          if (g_strcmp0 (ippGetName (attr), "printer-name") == 0)
+            printer_name = ippGetString (attr, 0, NULL);
+          else
+            add_dest_option_from_attribute (&dest, attr);
+        }
+
+      if (printer_name != NULL &&
+          (printer_names == NULL || g_strv_contains ((const gchar * const *) printer_names, printer_name)))
+        {
+          cups_dest_t *added;
+
+          dests->num_of_dests = cupsAddDest (printer_name, NULL, dests->num_of_dests, &dests->dests);
+          added = cupsGetDest (printer_name, NULL, dests->num_of_dests, dests->dests);
+          added->num_options = dest.num_options;
+          added->options = dest.options;
+        }
+      else
+        {
+          cupsFreeOptions (dest.num_options, dest.options);
+        }
+
+      if (attr == NULL)
+        break;
+    }
+
+  ippDelete (response);
+
+  if (g_task_set_return_on_cancel (task, FALSE))
+    {
+      g_task_return_pointer (task, dests, (GDestroyNotify) pp_cups_dests_free);
+    }
+  else
+    {
+      pp_cups_dests_free (dests);
+    }
+}
+
+/*
+ * Get attributes shown in the list of printers for given printers
+ * (or for all of them if printer_names is NULL) in one request.
+ */
+void
+pp_cups_get_printers_attributes_async (PpCups              *self,
+                                       GStrv                printer_names,
+                                       GCancellable        *cancellable,
+                                       GAsyncReadyCallback  callback,
+                                       gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, g_strdupv (printer_names), (GDestroyNotify) g_strfreev);
+  g_task_set_return_on_cancel (task, TRUE);
+  g_task_run_in_thread (task, get_printers_attributes_thread);
+}
+
+PpCupsDests *
+pp_cups_get_printers_attributes_finish (PpCups        *self,
+                                        GAsyncResult  *result,
+                                        GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static void
 connection_test_thread (GTask        *task,
                         gpointer      source_object,
@@ -45,6 +45,16 @@ PpCupsDests *pp_cups_get_dests_finish (PpCups               *cups,
                                        GAsyncResult         *result,
                                        GError              **error);
 
+void         pp_cups_get_printers_attributes_async  (PpCups              *cups,
+                                                     GStrv                printer_names,
+                                                     GCancellable        *cancellable,
+                                                     GAsyncReadyCallback  callback,
+                                                     gpointer             user_data);
+
+PpCupsDests *pp_cups_get_printers_attributes_finish (PpCups              *cups,
+                                                     GAsyncResult        *result,
+                                                     GError             **error);
+
 void         pp_cups_connection_test_async (PpCups              *cups,
                                             GCancellable        *cancellable,
                                             GAsyncReadyCallback  callback,
@@ -0,0 +1,722 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "pp-discovery.h"
+
+#include <string.h>
+
+#include "pp-host.h"
+#include "pp-print-device.h"
+#include "pp-samba.h"
+
+/* Results of a search are reused for the same hosts for this long */
+#define DISCOVERY_CACHE_TIMEOUT    (2 * 60 * G_USEC_PER_SEC)
+#define DISCOVERY_CACHE_SIZE       8
+
+/* Largest subnet which can be searched (256 addresses) */
+#define DISCOVERY_MIN_PREFIX_LENGTH 24
+
+typedef enum
+{
+  PROBE_REMOTE_CUPS,
+  PROBE_SNMP,
+  PROBE_JETDIRECT,
+  PROBE_LPD,
+  PROBE_SAMBA,
+  N_PROBE_TYPES
+} ProbeType;
+
+/* Number of probes of each type which can run at the same time and
+ * the time after which a probe is abandoned (in seconds).  SNMP probes
+ * spawn the CUPS backend and Samba probes walk the whole SMB tree of
+ * the host so they are the most limited ones.
+ */
+static const struct
+{
+  guint max_running;
+  guint timeout;
+} probe_limits[N_PROBE_TYPES] =
+{
+  [PROBE_REMOTE_CUPS] = {  8, 10 },
+  [PROBE_SNMP]        = {  4, 10 },
+  [PROBE_JETDIRECT]   = { 32,  3 },
+  [PROBE_LPD]         = {  8, 15 },
+  [PROBE_SAMBA]       = {  2, 15 },
+};
+
+typedef struct
+{
+  PpDiscovery  *discovery;   /* weak */
+  PpHost       *host;
+  ProbeType     type;
+  GCancellable *cancellable;
+  guint         timeout_id;
+  gboolean      waited;
+} Probe;
+
+typedef struct
+{
+  GPtrArray *devices;
+  gint64     timestamp;
+} CacheEntry;
+
+struct _PpDiscovery
+{
+  GObject    parent_instance;
+
+  /* Probes are created only once a slot of their type is free */
+  gchar    **host_names;
+  guint      n_host_names;
+  guint      next_host[N_PROBE_TYPES];
+  gint       ports[N_PROBE_TYPES];
+  /* Probes whose worker is still alive, including abandoned ones */
+  guint      running[N_PROBE_TYPES];
+  /* Probes the current search waits for */
+  GPtrArray *running_probes;
+
+  GHashTable *seen_uris;
+  GPtrArray  *found_devices;
+  gchar      *cache_key;
+  guint       cached_results_id;
+  gboolean    searching;
+  /* A probe timed out or failed so the results are not worth caching */
+  gboolean    incomplete;
+};
+
+G_DEFINE_TYPE (PpDiscovery, pp_discovery, G_TYPE_OBJECT)
+
+enum {
+  DEVICES_FOUND,
+  FINISHED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+/* Shared by all searches, only accessed from the main thread */
+static GHashTable *discovery_cache = NULL;
+
+static void start_pending_probes (PpDiscovery *self);
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_ptr_array_unref (entry->devices);
+  g_free (entry);
+}
+
+static CacheEntry *
+cache_lookup (const gchar *key)
+{
+  CacheEntry *entry;
+
+  if (discovery_cache == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (discovery_cache, key);
+  if (entry != NULL &&
+      g_get_monotonic_time () - entry->timestamp > DISCOVERY_CACHE_TIMEOUT)
+    {
+      g_hash_table_remove (discovery_cache, key);
+      entry = NULL;
+    }
+
+  return entry;
+}
+
+/* Takes ownership of the devices */
+static void
+cache_store (const gchar *key,
+             GPtrArray   *devices)
+{
+  GHashTableIter  iter;
+  CacheEntry     *entry;
+  CacheEntry     *oldest = NULL;
+  const gchar    *oldest_key = NULL;
+  gpointer        iter_key, iter_value;
+  gint64          now = g_get_monotonic_time ();
+
+  if (discovery_cache == NULL)
+    discovery_cache = g_hash_table_new_full (g_str_hash,
+                                             g_str_equal,
+                                             g_free,
+                                             (GDestroyNotify) cache_entry_free);
+
+  g_hash_table_iter_init (&iter, discovery_cache);
+  while (g_hash_table_iter_next (&iter, &iter_key, &iter_value))
+    {
+      entry = iter_value;
+
+      if (now - entry->timestamp > DISCOVERY_CACHE_TIMEOUT)
+        {
+          g_hash_table_iter_remove (&iter);
+          continue;
+        }
+
+      if (oldest == NULL || entry->timestamp < oldest->timestamp)
+        {
+          oldest = entry;
+          oldest_key = iter_key;
+        }
+    }
+
+  if (g_hash_table_size (discovery_cache) >= DISCOVERY_CACHE_SIZE && oldest_key != NULL)
+    g_hash_table_remove (discovery_cache, oldest_key);
+
+  entry = g_new0 (CacheEntry, 1);
+  entry->devices = devices;
+  entry->timestamp = now;
+
+  g_hash_table_insert (discovery_cache, g_strdup (key), entry);
+}
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+static gchar *
+get_cache_key (const gchar * const *host_names,
+               const gchar         *scheme,
+               gint                 port)
+{
+  g_autoptr(GPtrArray) sorted = NULL;
+  g_autoptr(GString)   key = NULL;
+  guint                i;
+
+  sorted = g_ptr_array_new ();
+  for (i = 0; host_names[i] != NULL; i++)
+    g_ptr_array_add (sorted, (gpointer) host_names[i]);
+  g_ptr_array_sort (sorted, compare_strings);
+
+  key = g_string_new (NULL);
+  g_string_append_printf (key, "%s:%d", scheme != NULL ? scheme : "", port);
+  for (i = 0; i < sorted->len; i++)
+    g_string_append_printf (key, ",%s", (const gchar *) g_ptr_array_index (sorted, i));
+
+  /* Keys of whole subnets would be too long */
+  return g_compute_checksum_for_string (G_CHECKSUM_SHA256, key->str, key->len);
+}
+
+static void
+probe_free (Probe *probe)
+{
+  g_clear_handle_id (&probe->timeout_id, g_source_remove);
+  if (probe->discovery != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (probe->discovery), (gpointer *) &probe->discovery);
+  g_clear_object (&probe->host);
+  g_clear_object (&probe->cancellable);
+  g_free (probe);
+}
+
+static Probe *
+probe_new (ProbeType    type,
+           const gchar *host_name,
+           gint         port)
+{
+  Probe *probe;
+
+  probe = g_new0 (Probe, 1);
+  probe->type = type;
+
+  if (type == PROBE_SAMBA)
+    probe->host = PP_HOST (pp_samba_new (host_name));
+  else
+    probe->host = pp_host_new (host_name);
+
+  if (port != PP_HOST_UNSET_PORT)
+    g_object_set (probe->host, "port", port, NULL);
+
+  return probe;
+}
+
+/* Stops waiting for the results of the probe.  The blocking probes can
+ * not be interrupted, so the probe keeps its slot in the running probes
+ * of its type until its callback comes, which then only frees it.
+ */
+static void
+probe_detach (Probe *probe)
+{
+  PpDiscovery *self = probe->discovery;
+
+  g_clear_handle_id (&probe->timeout_id, g_source_remove);
+
+  if (self == NULL || !probe->waited)
+    return;
+
+  g_ptr_array_remove_fast (self->running_probes, probe);
+  probe->waited = FALSE;
+}
+
+static void
+check_finished (PpDiscovery *self)
+{
+  gint type;
+
+  if (!self->searching || self->running_probes->len > 0)
+    return;
+
+  for (type = 0; type < N_PROBE_TYPES; type++)
+    if (self->next_host[type] < self->n_host_names)
+      return;
+
+  self->searching = FALSE;
+
+  /* An empty result is most likely a printer which is not up yet */
+  if (!self->incomplete && self->found_devices->len > 0)
+    {
+      cache_store (self->cache_key, g_steal_pointer (&self->found_devices));
+      self->found_devices = g_ptr_array_new_with_free_func (g_object_unref);
+    }
+
+  g_signal_emit (self, signals[FINISHED], 0);
+}
+
+static void
+add_found_devices (PpDiscovery *self,
+                   GPtrArray   *devices)
+{
+  g_autoptr(GPtrArray) new_devices = NULL;
+  guint                i;
+
+  new_devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < devices->len; i++)
+    {
+      PpPrintDevice *device = g_ptr_array_index (devices, i);
+      const gchar   *device_uri = pp_print_device_get_device_uri (device);
+
+      /* The same device is often found by more protocols */
+      if (device_uri != NULL &&
+          g_hash_table_contains (self->seen_uris, device_uri))
+        continue;
+
+      if (device_uri != NULL)
+        g_hash_table_add (self->seen_uris, g_strdup (device_uri));
+
+      /* The receiver modifies the devices, the cache keeps them intact */
+      g_ptr_array_add (self->found_devices, pp_print_device_copy (device));
+      g_ptr_array_add (new_devices, g_object_ref (device));
+    }
+
+  if (new_devices->len > 0)
+    g_signal_emit (self, signals[DEVICES_FOUND], 0, new_devices);
+}
+
+static GPtrArray *
+probe_finish (Probe         *probe,
+              GAsyncResult  *result,
+              GError       **error)
+{
+  switch (probe->type)
+    {
+      case PROBE_REMOTE_CUPS:
+        return pp_host_get_remote_cups_devices_finish (probe->host, result, error);
+      case PROBE_SNMP:
+        return pp_host_get_snmp_devices_finish (probe->host, result, error);
+      case PROBE_JETDIRECT:
+        return pp_host_get_jetdirect_devices_finish (probe->host, result, error);
+      case PROBE_LPD:
+        return pp_host_get_lpd_devices_finish (probe->host, result, error);
+      case PROBE_SAMBA:
+        return pp_samba_get_devices_finish (PP_SAMBA (probe->host), result, error);
+      default:
+        g_assert_not_reached ();
+    }
+
+  return NULL;
+}
+
+static void
+probe_done_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  Probe                *probe = user_data;
+  PpDiscovery          *self = probe->discovery;
+  g_autoptr(GPtrArray)  devices = NULL;
+  g_autoptr(GError)     error = NULL;
+
+  devices = probe_finish (probe, result, &error);
+
+  if (self == NULL)
+    {
+      probe_free (probe);
+      return;
+    }
+
+  self->running[probe->type]--;
+
+  if (probe->waited)
+    {
+      probe_detach (probe);
+
+      if (devices != NULL)
+        add_found_devices (self, devices);
+      else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_debug ("Printer discovery probe failed: %s", error->message);
+          self->incomplete = TRUE;
+        }
+    }
+
+  probe_free (probe);
+
+  start_pending_probes (self);
+  check_finished (self);
+}
+
+static gboolean
+probe_timeout_cb (gpointer user_data)
+{
+  Probe       *probe = user_data;
+  PpDiscovery *self = probe->discovery;
+
+  probe->timeout_id = 0;
+
+  /* The slot of the probe is only freed once its worker returns */
+  probe_detach (probe);
+  self->incomplete = TRUE;
+  g_cancellable_cancel (probe->cancellable);
+
+  check_finished (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+probe_start (PpDiscovery *self,
+             Probe       *probe)
+{
+  probe->discovery = self;
+  g_object_add_weak_pointer (G_OBJECT (self), (gpointer *) &probe->discovery);
+  probe->waited = TRUE;
+  probe->cancellable = g_cancellable_new ();
+  probe->timeout_id = g_timeout_add_seconds (probe_limits[probe->type].timeout,
+                                             probe_timeout_cb,
+                                             probe);
+
+  self->running[probe->type]++;
+  g_ptr_array_add (self->running_probes, probe);
+
+  switch (probe->type)
+    {
+      case PROBE_REMOTE_CUPS:
+        pp_host_get_remote_cups_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case PROBE_SNMP:
+        pp_host_get_snmp_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case PROBE_JETDIRECT:
+        pp_host_get_jetdirect_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case PROBE_LPD:
+        pp_host_get_lpd_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case PROBE_SAMBA:
+        pp_samba_get_devices_async (PP_SAMBA (probe->host), FALSE, probe->cancellable, probe_done_cb, probe);
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+}
+
+static void
+start_pending_probes (PpDiscovery *self)
+{
+  gint type;
+
+  for (type = 0; type < N_PROBE_TYPES; type++)
+    {
+      while (self->running[type] < probe_limits[type].max_running &&
+             self->next_host[type] < self->n_host_names)
+        {
+          const gchar *host_name = self->host_names[self->next_host[type]++];
+
+          probe_start (self, probe_new (type, host_name, self->ports[type]));
+        }
+    }
+}
+
+static gboolean
+emit_cached_results (gpointer user_data)
+{
+  PpDiscovery          *self = user_data;
+  g_autoptr(GPtrArray)  devices = NULL;
+  CacheEntry           *entry;
+  guint                 i;
+
+  self->cached_results_id = 0;
+
+  entry = cache_lookup (self->cache_key);
+  if (entry != NULL)
+    {
+      devices = g_ptr_array_new_with_free_func (g_object_unref);
+      for (i = 0; i < entry->devices->len; i++)
+        g_ptr_array_add (devices, pp_print_device_copy (g_ptr_array_index (entry->devices, i)));
+
+      if (devices->len > 0)
+        g_signal_emit (self, signals[DEVICES_FOUND], 0, devices);
+    }
+
+  self->searching = FALSE;
+  g_signal_emit (self, signals[FINISHED], 0);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+pp_discovery_dispose (GObject *object)
+{
+  PpDiscovery *self = PP_DISCOVERY (object);
+
+  pp_discovery_cancel (self);
+
+  G_OBJECT_CLASS (pp_discovery_parent_class)->dispose (object);
+}
+
+static void
+pp_discovery_finalize (GObject *object)
+{
+  PpDiscovery *self = PP_DISCOVERY (object);
+
+  g_clear_pointer (&self->running_probes, g_ptr_array_unref);
+  g_clear_pointer (&self->seen_uris, g_hash_table_destroy);
+  g_clear_pointer (&self->found_devices, g_ptr_array_unref);
+  g_clear_pointer (&self->cache_key, g_free);
+  g_clear_pointer (&self->host_names, g_strfreev);
+
+  G_OBJECT_CLASS (pp_discovery_parent_class)->finalize (object);
+}
+
+static void
+pp_discovery_class_init (PpDiscoveryClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->dispose = pp_discovery_dispose;
+  gobject_class->finalize = pp_discovery_finalize;
+
+  /* Emitted with each batch of newly found devices */
+  signals[DEVICES_FOUND] =
+    g_signal_new ("devices-found",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
+
+  signals[FINISHED] =
+    g_signal_new ("finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+pp_discovery_init (PpDiscovery *self)
+{
+  self->running_probes = g_ptr_array_new ();
+  self->seen_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->found_devices = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+PpDiscovery *
+pp_discovery_new (void)
+{
+  return g_object_new (PP_TYPE_DISCOVERY, NULL);
+}
+
+/*
+ * Probes the given hosts for printers.  Found devices are reported by
+ * the "devices-found" signal as soon as a probe returns them, each
+ * device only once.  The port is used for remote CUPS servers and SNMP,
+ * and for JetDirect and LPD printers only when the scheme asks for them.
+ * Complete non-empty results are kept for a while and reused by the next
+ * search of the same hosts unless @use_cache is %FALSE.
+ * A running search is cancelled.
+ */
+void
+pp_discovery_search (PpDiscovery         *self,
+                     const gchar * const *host_names,
+                     const gchar         *scheme,
+                     gint                 port,
+                     gboolean             use_cache)
+{
+  gint type;
+
+  g_return_if_fail (PP_IS_DISCOVERY (self));
+  g_return_if_fail (host_names != NULL);
+
+  pp_discovery_cancel (self);
+
+  self->searching = TRUE;
+  self->cache_key = get_cache_key (host_names, scheme, port);
+
+  if (use_cache && cache_lookup (self->cache_key) != NULL)
+    {
+      /* Cached results are reported asynchronously too */
+      self->cached_results_id = g_idle_add (emit_cached_results, self);
+      return;
+    }
+
+  self->host_names = g_strdupv ((gchar **) host_names);
+  self->n_host_names = g_strv_length (self->host_names);
+
+  for (type = 0; type < N_PROBE_TYPES; type++)
+    {
+      self->next_host[type] = 0;
+      self->ports[type] = PP_HOST_UNSET_PORT;
+    }
+
+  self->ports[PROBE_REMOTE_CUPS] = port;
+  self->ports[PROBE_SNMP] = port;
+
+  if (scheme != NULL && g_ascii_strcasecmp (scheme, "socket") == 0)
+    self->ports[PROBE_JETDIRECT] = port;
+
+  if (scheme != NULL && g_ascii_strcasecmp (scheme, "lpd") == 0)
+    self->ports[PROBE_LPD] = port;
+
+  /* Shares of whole networks are listed by the Samba browsing already */
+  if (self->n_host_names > 1)
+    self->next_host[PROBE_SAMBA] = self->n_host_names;
+
+  start_pending_probes (self);
+}
+
+void
+pp_discovery_cancel (PpDiscovery *self)
+{
+  g_return_if_fail (PP_IS_DISCOVERY (self));
+
+  g_clear_handle_id (&self->cached_results_id, g_source_remove);
+
+  g_clear_pointer (&self->host_names, g_strfreev);
+  self->n_host_names = 0;
+
+  while (self->running_probes->len > 0)
+    {
+      Probe *probe = g_ptr_array_index (self->running_probes, 0);
+
+      probe_detach (probe);
+      g_cancellable_cancel (probe->cancellable);
+    }
+
+  g_hash_table_remove_all (self->seen_uris);
+  g_ptr_array_set_size (self->found_devices, 0);
+  g_clear_pointer (&self->cache_key, g_free);
+  self->searching = FALSE;
+  self->incomplete = FALSE;
+}
+
+gboolean
+pp_discovery_is_searching (PpDiscovery *self)
+{
+  g_return_val_if_fail (PP_IS_DISCOVERY (self), FALSE);
+
+  return self->searching;
+}
+
+/* Any host of the subnet can be given, e.g. "192.168.1.5/24" */
+static gboolean
+parse_subnet (const gchar *subnet,
+              guint32     *network,
+              guint       *length)
+{
+  g_autoptr(GInetAddress)  address = NULL;
+  g_autofree gchar        *text = NULL;
+  g_auto(GStrv)            parts = NULL;
+  guint64                  prefix_length;
+  guint32                  bytes;
+
+  if (subnet == NULL)
+    return FALSE;
+
+  text = g_strstrip (g_strdup (subnet));
+  parts = g_strsplit (text, "/", 2);
+  if (g_strv_length (parts) != 2)
+    return FALSE;
+
+  address = g_inet_address_new_from_string (parts[0]);
+  if (address == NULL || g_inet_address_get_family (address) != G_SOCKET_FAMILY_IPV4)
+    return FALSE;
+
+  if (!g_ascii_string_to_unsigned (parts[1], 10, DISCOVERY_MIN_PREFIX_LENGTH, 32, &prefix_length, NULL))
+    return FALSE;
+
+  memcpy (&bytes, g_inet_address_to_bytes (address), sizeof (bytes));
+  *length = prefix_length;
+  *network = GUINT32_FROM_BE (bytes) & (G_MAXUINT32 << (32 - prefix_length));
+
+  return TRUE;
+}
+
+/*
+ * Whether the text is an IPv4 subnet which can be searched.
+ */
+gboolean
+pp_discovery_is_subnet (const gchar *subnet)
+{
+  guint32 network;
+  guint   length;
+
+  return parse_subnet (subnet, &network, &length);
+}
+
+/*
+ * Returns addresses of all hosts of an IPv4 subnet given
+ * as "address/prefix-length", or NULL if the text is not such subnet
+ * or the subnet is too large.
+ */
+gchar **
+pp_discovery_get_subnet_hosts (const gchar *subnet)
+{
+  GPtrArray *hosts;
+  guint32    network;
+  guint32    first, last;
+  guint32    i;
+  guint      length;
+
+  if (!parse_subnet (subnet, &network, &length))
+    return NULL;
+
+  first = network;
+  last = network + (G_GUINT64_CONSTANT (1) << (32 - length)) - 1;
+
+  /* Skip the network and broadcast addresses */
+  if (length < 31)
+    {
+      first++;
+      last--;
+    }
+
+  hosts = g_ptr_array_new ();
+  for (i = first; i <= last && i >= first; i++)
+    g_ptr_array_add (hosts, g_strdup_printf ("%u.%u.%u.%u",
+                                             (i >> 24) & 0xff,
+                                             (i >> 16) & 0xff,
+                                             (i >> 8) & 0xff,
+                                             i & 0xff));
+  g_ptr_array_add (hosts, NULL);
+
+  return (gchar **) g_ptr_array_free (hosts, FALSE);
+}
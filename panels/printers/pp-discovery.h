@@ -0,0 +1,42 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define PP_TYPE_DISCOVERY (pp_discovery_get_type ())
+G_DECLARE_FINAL_TYPE (PpDiscovery, pp_discovery, PP, DISCOVERY, GObject)
+
+PpDiscovery  *pp_discovery_new              (void);
+
+void          pp_discovery_search           (PpDiscovery        *discovery,
+                                             const gchar * const *host_names,
+                                             const gchar        *scheme,
+                                             gint                port,
+                                             gboolean            use_cache);
+
+void          pp_discovery_cancel           (PpDiscovery        *discovery);
+
+gboolean      pp_discovery_is_searching     (PpDiscovery        *discovery);
+
+gboolean      pp_discovery_is_subnet        (const gchar        *subnet);
+
+gchar       **pp_discovery_get_subnet_hosts (const gchar        *subnet);
+
+G_END_DECLS
@@ -26,6 +26,14 @@
 
 #define BUFFER_LENGTH 1024
 
+/* Timeout of connecting to and reading from the probed printers */
+#define JETDIRECT_PROBE_TIMEOUT 3
+#define LPD_PROBE_TIMEOUT       5
+
+/* Number of LPD queue names tried at the same time, some LPD servers
+ * accept only one connection at a time and refuse the others */
+#define LPD_MAX_QUEUE_PROBES    2
+
 typedef struct
 {
   gchar *hostname;
@@ -517,6 +525,7 @@ pp_host_get_jetdirect_devices_async (PpHost              *self,
       g_autoptr(GSocketClient) client = NULL;
 
       client = g_socket_client_new ();
+      g_socket_client_set_timeout (client, JETDIRECT_PROBE_TIMEOUT);
 
       g_socket_client_connect_to_host_async (client,
                                              address,
@@ -542,198 +551,390 @@ pp_host_get_jetdirect_devices_finish (PpHost        *self,
   return g_task_propagate_pointer (G_TASK (res), error);
 }
 
-static gboolean
-test_lpd_queue (GSocketClient *client,
-                gchar         *address,
-                gint           port,
-                GCancellable  *cancellable,
-                gchar         *queue_name)
+typedef struct
 {
-  g_autoptr(GSocketConnection) connection = NULL;
-  gboolean                     result = FALSE;
-  g_autoptr(GError)            error = NULL;
+  PpHost        *host;
+  gchar         *address;
+  gint           port;
+  GSocketClient *client;
+  GPtrArray     *candidates;
+  /* LpdQueueResult of each candidate */
+  GArray        *results;
+  guint          next_candidate;
+  /* Candidates before this one were all refused */
+  guint          first_unrefused;
+  gboolean       accepted;
+  guint          running;
+  gchar         *found_queue;
+  GCancellable  *cancellable;
+  GCancellable  *task_cancellable;
+  gulong         cancelled_id;
+} LpdData;
+
+typedef enum
+{
+  LPD_QUEUE_UNKNOWN = 0,
+  LPD_QUEUE_REFUSED,
+  LPD_QUEUE_ACCEPTED
+} LpdQueueResult;
+
+typedef struct
+{
+  GTask             *task;
+  guint              index;
+  gchar             *queue_name;
+  GSocketConnection *connection;
+  gchar              buffer[BUFFER_LENGTH];
+} LpdQueueProbe;
 
-  connection = g_socket_client_connect_to_host (client,
-                                                address,
-                                                port,
-                                                cancellable,
-                                                &error);
+static void lpd_queue_probe_start (GTask *task);
 
-  if (connection != NULL)
+static void
+lpd_data_free (LpdData *data)
+{
+  if (data != NULL)
     {
-      if (G_IS_TCP_CONNECTION (connection))
+      if (data->cancelled_id != 0)
+        g_cancellable_disconnect (data->task_cancellable, data->cancelled_id);
+      g_clear_object (&data->task_cancellable);
+      g_clear_object (&data->cancellable);
+      g_clear_object (&data->host);
+      g_clear_object (&data->client);
+      g_clear_pointer (&data->candidates, g_ptr_array_unref);
+      g_clear_pointer (&data->results, g_array_unref);
+      g_free (data->address);
+      g_free (data->found_queue);
+      g_free (data);
+    }
+}
+
+static void
+lpd_task_cancelled_cb (GCancellable *cancellable,
+                       GCancellable *lpd_cancellable)
+{
+  g_cancellable_cancel (lpd_cancellable);
+}
+
+static void
+lpd_return_devices (GTask *task)
+{
+  PpHostPrivate        *priv;
+  LpdData              *data;
+  g_autoptr(GPtrArray)  devices = NULL;
+
+  data = g_task_get_task_data (task);
+  priv = pp_host_get_instance_private (data->host);
+
+  devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (data->found_queue != NULL)
+    {
+      g_autofree gchar *device_uri = NULL;
+      PpPrintDevice *device;
+
+      device_uri = g_strdup_printf ("lpd://%s:%d/%s",
+                                    priv->hostname,
+                                    data->port,
+                                    data->found_queue);
+
+      device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                             "is-network-device", TRUE,
+                             "device-uri", device_uri,
+                             /* Translators: The found device is a Line Printer Daemon printer */
+                             "device-name", _("LPD Printer"),
+                             "host-name", priv->hostname,
+                             "host-port", data->port,
+                             "acquisition-method", ACQUISITION_METHOD_LPD,
+                             NULL);
+      g_ptr_array_add (devices, device);
+    }
+
+  g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+lpd_abort_job_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  g_autoptr(GSocketConnection) connection = G_SOCKET_CONNECTION (user_data);
+
+  g_output_stream_write_all_finish (G_OUTPUT_STREAM (source_object), res, NULL, NULL);
+  g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+}
+
+static void
+lpd_queue_probe_done (LpdQueueProbe *probe,
+                      gboolean       success)
+{
+  g_autoptr(GTask)  task = probe->task;
+  LpdData          *data = g_task_get_task_data (task);
+
+  if (probe->connection != NULL)
+    {
+      if (success)
         {
           GOutputStream *output;
-          GInputStream  *input;
-          gssize         bytes_read, bytes_written;
-          gchar          buffer[BUFFER_LENGTH];
-          gint           length;
 
-          output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
-          input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+          /* This LPD command is explained in RFC 1179, section 6.1 */
+          output = g_io_stream_get_output_stream (G_IO_STREAM (probe->connection));
+          g_output_stream_write_all_async (output,
+                                           "\1\n",
+                                           2,
+                                           G_PRIORITY_DEFAULT,
+                                           NULL,
+                                           lpd_abort_job_cb,
+                                           g_steal_pointer (&probe->connection));
+        }
+      else
+        {
+          g_io_stream_close (G_IO_STREAM (probe->connection), NULL, NULL);
+          g_clear_object (&probe->connection);
+        }
+    }
 
-          /* This LPD command is explained in RFC 1179, section 5.2 */
-          length = g_snprintf (buffer, BUFFER_LENGTH, "\2%s\n", queue_name);
+  data->running--;
 
-          bytes_written = g_output_stream_write (output,
-                                                 buffer,
-                                                 length,
-                                                 NULL,
-                                                 &error);
+  g_array_index (data->results, LpdQueueResult, probe->index) =
+    success ? LPD_QUEUE_ACCEPTED : LPD_QUEUE_REFUSED;
+  if (success)
+    data->accepted = TRUE;
 
-          if (bytes_written != -1)
-            {
-              bytes_read = g_input_stream_read (input,
-                                                buffer,
-                                                BUFFER_LENGTH,
-                                                NULL,
-                                                &error);
+  g_free (probe->queue_name);
+  g_free (probe);
 
-              if (bytes_read != -1)
-                {
-                  if (bytes_read > 0 && buffer[0] == 0)
-                    {
-                      /* This LPD command is explained in RFC 1179, section 6.1 */
-                      length = g_snprintf (buffer, BUFFER_LENGTH, "\1\n");
-
-                      bytes_written = g_output_stream_write (output,
-                                                             buffer,
-                                                             length,
-                                                             NULL,
-                                                             &error);
-
-                      result = TRUE;
-                    }
-                }
-            }
-        }
+  /* The queues are tried in the order of the candidates, an accepted
+   * queue wins only once all the preceding ones have been refused.
+   * The other attempts are stopped then.
+   */
+  while (data->first_unrefused < data->next_candidate &&
+         g_array_index (data->results, LpdQueueResult, data->first_unrefused) == LPD_QUEUE_REFUSED)
+    data->first_unrefused++;
 
-      g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+  if (data->found_queue == NULL &&
+      data->first_unrefused < data->next_candidate &&
+      g_array_index (data->results, LpdQueueResult, data->first_unrefused) == LPD_QUEUE_ACCEPTED)
+    {
+      data->found_queue = g_strdup (g_ptr_array_index (data->candidates, data->first_unrefused));
+      g_cancellable_cancel (data->cancellable);
     }
 
-  return result;
+  /* No need to try queues following an accepted one */
+  if (!data->accepted &&
+      !g_cancellable_is_cancelled (data->cancellable) &&
+      data->next_candidate < data->candidates->len)
+    lpd_queue_probe_start (g_object_ref (task));
+  else if (data->running == 0)
+    lpd_return_devices (task);
 }
 
 static void
-_pp_host_get_lpd_devices_thread (GTask        *task,
-                                 gpointer      source_object,
-                                 gpointer      task_data,
-                                 GCancellable *cancellable)
+lpd_queue_read_cb (GObject      *source_object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
 {
-  g_autoptr(GSocketConnection) connection = NULL;
-  PpHost                      *self = source_object;
-  PpHostPrivate               *priv = pp_host_get_instance_private (self);
-  g_autoptr(GPtrArray)         devices = NULL;
-  g_autoptr(GSocketClient)     client = NULL;
-  g_autoptr(GError)            error = NULL;
-  GList                       *candidates = NULL;
-  GList                       *iter;
-  gchar                       *found_queue = NULL;
-  gchar                       *candidate;
-  g_autofree gchar            *address = NULL;
-  gint                         port;
-  gint                         i;
+  LpdQueueProbe *probe = user_data;
+  gssize         bytes_read;
 
-  if (priv->port == PP_HOST_UNSET_PORT)
-    port = PP_HOST_DEFAULT_LPD_PORT;
-  else
-    port = priv->port;
+  bytes_read = g_input_stream_read_finish (G_INPUT_STREAM (source_object), res, NULL);
 
-  devices = g_ptr_array_new_with_free_func (g_object_unref);
+  lpd_queue_probe_done (probe, bytes_read > 0 && probe->buffer[0] == 0);
+}
 
-  address = g_strdup_printf ("%s:%d", priv->hostname, port);
-  if (address == NULL || address[0] == '/')
+static void
+lpd_queue_write_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  LpdQueueProbe *probe = user_data;
+  LpdData       *data = g_task_get_task_data (probe->task);
+  GInputStream  *input;
+
+  if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (source_object), res, NULL, NULL))
     {
-      g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
+      lpd_queue_probe_done (probe, FALSE);
       return;
     }
 
-  client = g_socket_client_new ();
+  input = g_io_stream_get_input_stream (G_IO_STREAM (probe->connection));
+  g_input_stream_read_async (input,
+                             probe->buffer,
+                             BUFFER_LENGTH,
+                             G_PRIORITY_DEFAULT,
+                             data->cancellable,
+                             lpd_queue_read_cb,
+                             probe);
+}
 
-  connection = g_socket_client_connect_to_host (client,
-                                                address,
-                                                port,
-                                                cancellable,
-                                                &error);
+static void
+lpd_queue_connect_cb (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  LpdQueueProbe *probe = user_data;
+  LpdData       *data = g_task_get_task_data (probe->task);
+  GOutputStream *output;
+  gint           length;
 
-  if (connection != NULL)
+  probe->connection = g_socket_client_connect_to_host_finish (G_SOCKET_CLIENT (source_object),
+                                                              res,
+                                                              NULL);
+
+  if (probe->connection == NULL || !G_IS_TCP_CONNECTION (probe->connection))
     {
-      g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+      lpd_queue_probe_done (probe, FALSE);
+      return;
+    }
 
-      /* Most of this list is taken from system-config-printer */
-      candidates = g_list_append (candidates, g_strdup ("PASSTHRU"));
-      candidates = g_list_append (candidates, g_strdup ("AUTO"));
-      candidates = g_list_append (candidates, g_strdup ("BINPS"));
-      candidates = g_list_append (candidates, g_strdup ("RAW"));
-      candidates = g_list_append (candidates, g_strdup ("TEXT"));
-      candidates = g_list_append (candidates, g_strdup ("ps"));
-      candidates = g_list_append (candidates, g_strdup ("lp"));
-      candidates = g_list_append (candidates, g_strdup ("PORT1"));
-
-      for (i = 0; i < 8; i++)
-        {
-          candidates = g_list_append (candidates, g_strdup_printf ("LPT%d", i));
-          candidates = g_list_append (candidates, g_strdup_printf ("LPT%d_PASSTHRU", i));
-          candidates = g_list_append (candidates, g_strdup_printf ("COM%d", i));
-          candidates = g_list_append (candidates, g_strdup_printf ("COM%d_PASSTHRU", i));
-        }
+  /* This LPD command is explained in RFC 1179, section 5.2 */
+  length = g_snprintf (probe->buffer, BUFFER_LENGTH, "\2%s\n", probe->queue_name);
+
+  output = g_io_stream_get_output_stream (G_IO_STREAM (probe->connection));
+  g_output_stream_write_all_async (output,
+                                   probe->buffer,
+                                   length,
+                                   G_PRIORITY_DEFAULT,
+                                   data->cancellable,
+                                   lpd_queue_write_cb,
+                                   probe);
+}
 
-      for (i = 0; i < 50; i++)
-        candidates = g_list_append (candidates, g_strdup_printf ("pr%d", i));
+/* Takes ownership of the task reference */
+static void
+lpd_queue_probe_start (GTask *task)
+{
+  LpdQueueProbe *probe;
+  LpdData       *data = g_task_get_task_data (task);
+
+  probe = g_new0 (LpdQueueProbe, 1);
+  probe->task = task;
+  probe->index = data->next_candidate++;
+  probe->queue_name = g_strdup (g_ptr_array_index (data->candidates, probe->index));
+
+  data->running++;
+
+  g_socket_client_connect_to_host_async (data->client,
+                                         data->address,
+                                         data->port,
+                                         data->cancellable,
+                                         lpd_queue_connect_cb,
+                                         probe);
+}
 
-      for (iter = candidates; iter != NULL; iter = iter->next)
-        {
-          candidate = (gchar *) iter->data;
+static GPtrArray *
+get_lpd_queue_candidates (void)
+{
+  GPtrArray *candidates;
+  gint       i;
+
+  candidates = g_ptr_array_new_with_free_func (g_free);
+
+  /* Most of this list is taken from system-config-printer */
+  g_ptr_array_add (candidates, g_strdup ("PASSTHRU"));
+  g_ptr_array_add (candidates, g_strdup ("AUTO"));
+  g_ptr_array_add (candidates, g_strdup ("BINPS"));
+  g_ptr_array_add (candidates, g_strdup ("RAW"));
+  g_ptr_array_add (candidates, g_strdup ("TEXT"));
+  g_ptr_array_add (candidates, g_strdup ("ps"));
+  g_ptr_array_add (candidates, g_strdup ("lp"));
+  g_ptr_array_add (candidates, g_strdup ("PORT1"));
+
+  for (i = 0; i < 8; i++)
+    {
+      g_ptr_array_add (candidates, g_strdup_printf ("LPT%d", i));
+      g_ptr_array_add (candidates, g_strdup_printf ("LPT%d_PASSTHRU", i));
+      g_ptr_array_add (candidates, g_strdup_printf ("COM%d", i));
+      g_ptr_array_add (candidates, g_strdup_printf ("COM%d_PASSTHRU", i));
+    }
 
-          if (test_lpd_queue (client,
-                              address,
-                              port,
-                              cancellable,
-                              candidate))
-            {
-              found_queue = g_strdup (candidate);
-              break;
-            }
-        }
+  for (i = 0; i < 50; i++)
+    g_ptr_array_add (candidates, g_strdup_printf ("pr%d", i));
 
-      if (found_queue != NULL)
-        {
-          g_autofree gchar *device_uri = NULL;
-          PpPrintDevice *device;
+  return candidates;
+}
 
-          device_uri = g_strdup_printf ("lpd://%s:%d/%s",
-                                        priv->hostname,
-                                        port,
-                                        found_queue);
+static void
+lpd_connection_test_cb (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  g_autoptr(GSocketConnection) connection = NULL;
+  g_autoptr(GTask)             task = G_TASK (user_data);
+  LpdData                     *data = g_task_get_task_data (task);
+  guint                        i;
 
-          device = g_object_new (PP_TYPE_PRINT_DEVICE,
-                                 "is-network-device", TRUE,
-                                 "device-uri", device_uri,
-                                 /* Translators: The found device is a Line Printer Daemon printer */
-                                 "device-name", _("LPD Printer"),
-                                 "host-name", priv->hostname,
-                                 "host-port", port,
-                                 "acquisition-method", ACQUISITION_METHOD_LPD,
-                                 NULL);
-          g_ptr_array_add (devices, device);
-        }
+  connection = g_socket_client_connect_to_host_finish (G_SOCKET_CLIENT (source_object),
+                                                       res,
+                                                       NULL);
 
-      g_list_free_full (candidates, g_free);
+  if (connection == NULL)
+    {
+      lpd_return_devices (task);
+      return;
     }
 
-  g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
+  g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+
+  data->candidates = get_lpd_queue_candidates ();
+  data->results = g_array_sized_new (FALSE, TRUE, sizeof (LpdQueueResult), data->candidates->len);
+  g_array_set_size (data->results, data->candidates->len);
+
+  for (i = 0; i < LPD_MAX_QUEUE_PROBES && i < data->candidates->len; i++)
+    lpd_queue_probe_start (g_object_ref (task));
 }
 
+/* Test whether given host has a Line Printer Daemon with one of
+   commonly used queue names.  Several queue names are tried at once
+   over separate connections, the first accepted one in the order of
+   the candidates is used.
+   See RFC 1179. */
 void
 pp_host_get_lpd_devices_async (PpHost              *self,
                                GCancellable        *cancellable,
                                GAsyncReadyCallback  callback,
                                gpointer             user_data)
 {
-  g_autoptr(GTask) task = NULL;
+  PpHostPrivate    *priv = pp_host_get_instance_private (self);
+  LpdData          *data;
+  g_autoptr(GTask)  task = NULL;
+
+  data = g_new0 (LpdData, 1);
+  data->host = g_object_ref (self);
+  data->cancellable = g_cancellable_new ();
+
+  if (priv->port == PP_HOST_UNSET_PORT)
+    data->port = PP_HOST_DEFAULT_LPD_PORT;
+  else
+    data->port = priv->port;
 
   task = g_task_new (G_OBJECT (self), cancellable, callback, user_data);
-  g_task_run_in_thread (task, _pp_host_get_lpd_devices_thread);
+  g_task_set_task_data (task, data, (GDestroyNotify) lpd_data_free);
+
+  if (cancellable != NULL)
+    {
+      data->task_cancellable = g_object_ref (cancellable);
+      data->cancelled_id = g_cancellable_connect (cancellable,
+                                                  G_CALLBACK (lpd_task_cancelled_cb),
+                                                  data->cancellable,
+                                                  NULL);
+    }
+
+  data->address = g_strdup_printf ("%s:%d", priv->hostname, data->port);
+  if (data->address == NULL || data->address[0] == '/')
+    {
+      lpd_return_devices (task);
+      return;
+    }
+
+  data->client = g_socket_client_new ();
+  g_socket_client_set_timeout (data->client, LPD_PROBE_TIMEOUT);
+
+  g_socket_client_connect_to_host_async (data->client,
+                                         data->address,
+                                         data->port,
+                                         data->cancellable,
+                                         lpd_connection_test_cb,
+                                         g_steal_pointer (&task));
 }
 
 GPtrArray *
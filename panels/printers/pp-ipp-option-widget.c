@@ -51,6 +51,7 @@ struct _PpIPPOptionWidget
   GHashTable *ipp_attribute;
 
   GCancellable *cancellable;
+  GCancellable *update_cancellable;
 };
 
 G_DEFINE_TYPE (PpIPPOptionWidget, pp_ipp_option_widget, GTK_TYPE_BOX)
@@ -117,6 +118,7 @@ pp_ipp_option_widget_finalize (GObject *object)
   PpIPPOptionWidget *self = PP_IPP_OPTION_WIDGET (object);
 
   g_cancellable_cancel (self->cancellable);
+  g_cancellable_cancel (self->update_cancellable);
 
   g_clear_pointer (&self->option_name, g_free);
   g_clear_pointer (&self->printer_name, g_free);
@@ -124,6 +126,7 @@ pp_ipp_option_widget_finalize (GObject *object)
   g_clear_pointer (&self->option_default, ipp_attribute_free);
   g_clear_pointer (&self->ipp_attribute, g_hash_table_unref);
   g_clear_object (&self->cancellable);
+  g_clear_object (&self->update_cancellable);
 
   G_OBJECT_CLASS (pp_ipp_option_widget_parent_class)->finalize (object);
 }
@@ -515,8 +518,13 @@ update_widget (PpIPPOptionWidget *self)
   attributes_names = g_new0 (gchar *, 2);
   attributes_names[0] = g_strdup_printf ("%s-default", self->option_name);
 
+  g_cancellable_cancel (self->update_cancellable);
+  g_clear_object (&self->update_cancellable);
+  self->update_cancellable = g_cancellable_new ();
+
   get_ipp_attributes_async (self->printer_name,
                             attributes_names,
+                            self->update_cancellable,
                             get_ipp_attributes_cb,
                             self);
 
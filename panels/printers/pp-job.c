@@ -85,6 +85,13 @@ pp_job_new (gint id, const gchar *title, gint state, gint priority, GStrv auth_i
    return job;
 }
 
+gint
+pp_job_get_id (PpJob *self)
+{
+   g_return_val_if_fail (PP_IS_JOB(self), -1);
+   return self->id;
+}
+
 const gchar *
 pp_job_get_title (PpJob *self)
 {
@@ -134,6 +141,46 @@ pp_job_get_auth_info_required (PpJob *self)
    return self->auth_info_required;
 }
 
+/* Copies the state of new_job, returns TRUE if anything has changed */
+gboolean
+pp_job_update (PpJob *self,
+               PpJob *new_job)
+{
+   gboolean changed = FALSE;
+
+   g_return_val_if_fail (PP_IS_JOB (self), FALSE);
+   g_return_val_if_fail (PP_IS_JOB (new_job), FALSE);
+
+   if (g_strcmp0 (self->title, new_job->title) != 0)
+     {
+       g_free (self->title);
+       self->title = g_strdup (new_job->title);
+       changed = TRUE;
+     }
+
+   if (self->state != new_job->state ||
+       self->priority != new_job->priority ||
+       self->sensitive != new_job->sensitive)
+     {
+       self->state = new_job->state;
+       self->priority = new_job->priority;
+       self->sensitive = new_job->sensitive;
+       changed = TRUE;
+     }
+
+   if ((self->auth_info_required == NULL) != (new_job->auth_info_required == NULL) ||
+       (self->auth_info_required != NULL &&
+        !g_strv_equal ((const gchar * const *) self->auth_info_required,
+                       (const gchar * const *) new_job->auth_info_required)))
+     {
+       g_strfreev (self->auth_info_required);
+       self->auth_info_required = g_strdupv (new_job->auth_info_required);
+       changed = TRUE;
+     }
+
+   return changed;
+}
+
 void
 pp_job_cancel_purge_async (PpJob        *self,
                            gboolean      job_purge)
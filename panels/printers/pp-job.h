@@ -35,6 +35,8 @@ PpJob         *pp_job_new                        (gint                  id,
                                                   gint                  priority,
                                                   GStrv                 auth_info_required);
 
+gint           pp_job_get_id                     (PpJob                *job);
+
 const gchar   *pp_job_get_title                  (PpJob                *job);
 
 gint           pp_job_get_state                  (PpJob                *job);
@@ -51,6 +53,9 @@ void           pp_job_set_priority               (PpJob                *job,
 
 GStrv          pp_job_get_auth_info_required     (PpJob                *job);
 
+gboolean       pp_job_update                     (PpJob                *job,
+                                                  PpJob                *new_job);
+
 void           pp_job_set_hold_until_async       (PpJob                *job,
                                                   const gchar          *job_hold_until);
 
@@ -61,6 +61,7 @@ struct _PpJobsDialog {
   GtkLabel          *password_label;
   GtkStack          *stack;
   GListStore        *store;
+  GHashTable        *jobs;
   GtkEntry          *username_entry;
   GtkLabel          *username_label;
 
@@ -233,35 +234,79 @@ pop_up_authentication_popup (PpJobsDialog *self)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (self->authenticate_jobs_button), TRUE);
 }
 
+/*
+ * Updates the store in place.  Jobs are keyed by their ids, rows are
+ * only created for new jobs and rebuilt for jobs which have changed.
+ */
 static void
-update_jobs_list_cb (GObject      *source_object,
-                     GAsyncResult *result,
-                     gpointer      user_data)
+update_jobs_store (PpJobsDialog *self,
+                   GPtrArray    *jobs)
 {
-  PpJobsDialog        *self = user_data;
-  PpPrinter           *printer = PP_PRINTER (source_object);
-  g_autoptr(GError)    error = NULL;
-  g_autoptr(GPtrArray) jobs;
-  PpJob               *job;
-  gint                 num_of_auth_jobs = 0;
-  gint                 job_priority;
-  guint                state;
-  guint                i;
-  gint                 current_max_value = 1;
-  gint                 first_unprocessed_job = -1;
+  g_autoptr(GHashTable) job_ids = NULL;
+  guint                 n_items;
+  guint                 i;
 
-  g_list_store_remove_all (self->store);
+  job_ids = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < jobs->len; i++)
+    g_hash_table_add (job_ids, GINT_TO_POINTER (pp_job_get_id (g_ptr_array_index (jobs, i))));
 
-  jobs = pp_printer_get_jobs_finish (printer, result, &error);
-  if (error != NULL)
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (self->store));
+  for (i = n_items; i > 0; i--)
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_autoptr(PpJob) job = g_list_model_get_item (G_LIST_MODEL (self->store), i - 1);
+
+      if (!g_hash_table_contains (job_ids, GINT_TO_POINTER (pp_job_get_id (job))))
         {
-          g_warning ("Could not get jobs: %s", error->message);
+          g_hash_table_remove (self->jobs, GINT_TO_POINTER (pp_job_get_id (job)));
+          g_list_store_remove (self->store, i - 1);
         }
+    }
 
-      return;
+  /* Items before position i are already in the order of the new jobs */
+  for (i = 0; i < jobs->len; i++)
+    {
+      PpJob            *job = g_ptr_array_index (jobs, i);
+      PpJob            *current;
+      g_autoptr(PpJob)  item = NULL;
+      guint             position;
+
+      current = g_hash_table_lookup (self->jobs, GINT_TO_POINTER (pp_job_get_id (job)));
+      if (current == NULL)
+        {
+          g_list_store_insert (self->store, i, job);
+          g_hash_table_insert (self->jobs, GINT_TO_POINTER (pp_job_get_id (job)), job);
+          continue;
+        }
+
+      item = g_list_model_get_item (G_LIST_MODEL (self->store), i);
+      if (item == current)
+        {
+          /* Replacing the item with itself rebuilds its row */
+          if (pp_job_update (current, job))
+            g_list_store_splice (self->store, i, 1, (gpointer *) &current, 1);
+        }
+      else if (g_list_store_find (self->store, current, &position))
+        {
+          g_autoptr(PpJob) moved = g_object_ref (current);
+
+          g_list_store_remove (self->store, position);
+          pp_job_update (moved, job);
+          g_list_store_insert (self->store, i, moved);
+        }
     }
+}
+
+static void
+update_jobs (PpJobsDialog *self,
+             GPtrArray    *jobs)
+{
+  PpJob               *job;
+  gint                 num_of_auth_jobs = 0;
+  gint                 job_priority;
+  guint                state;
+  guint                i;
+  gint                 current_max_value = 1;
+  gint                 first_unprocessed_job = -1;
 
   if (jobs->len > 0)
     {
@@ -300,8 +345,6 @@ update_jobs_list_cb (GObject      *source_object,
       if (job_priority >= current_max_value && job_priority != 100)
         current_max_value = job_priority;
 
-      g_list_store_append (self->store, g_object_ref (job));
-
       if (pp_job_get_auth_info_required (job) != NULL)
         {
           num_of_auth_jobs++;
@@ -311,6 +354,9 @@ update_jobs_list_cb (GObject      *source_object,
         }
     }
   self->max_priority = current_max_value;
+
+  update_jobs_store (self, jobs);
+
   if (num_of_auth_jobs > 0)
     {
       g_autofree gchar *text = NULL;
@@ -328,8 +374,6 @@ update_jobs_list_cb (GObject      *source_object,
 
   authenticate_popover_update (self);
 
-  g_clear_object (&self->get_jobs_cancellable);
-
   if (!self->jobs_filled)
     {
       if (self->pop_up_authentication_popup)
@@ -342,6 +386,32 @@ update_jobs_list_cb (GObject      *source_object,
     }
 }
 
+static void
+update_jobs_list_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  PpJobsDialog        *self = user_data;
+  PpPrinter           *printer = PP_PRINTER (source_object);
+  g_autoptr(GError)    error = NULL;
+  g_autoptr(GPtrArray) jobs;
+
+  jobs = pp_printer_get_jobs_finish (printer, result, &error);
+  if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_warning ("Could not get jobs: %s", error->message);
+        }
+
+      return;
+    }
+
+  g_clear_object (&self->get_jobs_cancellable);
+
+  update_jobs (self, jobs);
+}
+
 static void
 update_jobs_list (PpJobsDialog *self)
 {
@@ -460,6 +530,7 @@ pp_jobs_dialog_new (const gchar *printer_name)
   gtk_label_set_text (self->authentication_label, text);
 
   self->store = g_list_store_new (pp_job_get_type ());
+  self->jobs = g_hash_table_new (NULL, NULL);
   gtk_list_box_bind_model (self->jobs_listbox, G_LIST_MODEL (self->store),
                            create_listbox_row, self, NULL);
 
@@ -474,6 +545,20 @@ pp_jobs_dialog_update (PpJobsDialog *self)
   update_jobs_list (self);
 }
 
+/* Updates the dialog with jobs which have already been fetched */
+void
+pp_jobs_dialog_set_jobs (PpJobsDialog *self,
+                         GPtrArray    *jobs)
+{
+  g_return_if_fail (PP_IS_JOBS_DIALOG (self));
+
+  /* A running fetch would be older */
+  g_cancellable_cancel (self->get_jobs_cancellable);
+  g_clear_object (&self->get_jobs_cancellable);
+
+  update_jobs (self, jobs);
+}
+
 void
 pp_jobs_dialog_authenticate_jobs (PpJobsDialog *self)
 {
@@ -498,6 +583,7 @@ pp_jobs_dialog_dispose (GObject *object)
   g_clear_object (&self->get_jobs_cancellable);
   g_clear_pointer (&self->actual_auth_info_required, g_strfreev);
   g_clear_pointer (&self->printer_name, g_free);
+  g_clear_pointer (&self->jobs, g_hash_table_unref);
 
   G_OBJECT_CLASS (pp_jobs_dialog_parent_class)->dispose (object);
 }
@@ -30,6 +30,8 @@ G_DECLARE_FINAL_TYPE (PpJobsDialog, pp_jobs_dialog, PP, JOBS_DIALOG, AdwWindow)
 
 PpJobsDialog *pp_jobs_dialog_new               (const gchar  *printer_name);
 void          pp_jobs_dialog_update            (PpJobsDialog *dialog);
+void          pp_jobs_dialog_set_jobs          (PpJobsDialog *dialog,
+                                                GPtrArray    *jobs);
 void          pp_jobs_dialog_authenticate_jobs (PpJobsDialog *dialog);
 
 G_END_DECLS
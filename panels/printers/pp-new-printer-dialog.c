@@ -21,6 +21,7 @@
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <adwaita.h>
 #include <glib.h>
@@ -31,6 +32,7 @@
 
 #include "pp-new-printer-dialog.h"
 #include "pp-cups.h"
+#include "pp-discovery.h"
 #include "pp-host.h"
 #include "pp-new-printer.h"
 #include "pp-ppd-selection-dialog.h"
@@ -130,7 +132,6 @@ struct _PpNewPrinterDialog
   gint         num_of_dests;
 
   GCancellable *cancellable;
-  GCancellable *remote_host_cancellable;
 
   gboolean  cups_searching;
   gboolean  samba_authenticated_searching;
@@ -146,12 +147,9 @@ struct _PpNewPrinterDialog
   GIcon *remote_printer_icon;
   GIcon *authenticated_server_icon;
 
-  PpHost  *snmp_host;
-  PpHost  *socket_host;
-  PpHost  *lpd_host;
-  PpHost  *remote_cups_host;
-  PpSamba *samba_host;
-  guint    host_search_timeout_id;
+  PpDiscovery *discovery;
+  PpSamba     *samba_host;
+  guint        host_search_timeout_id;
 };
 
 G_DEFINE_TYPE (PpNewPrinterDialog, pp_new_printer_dialog, ADW_TYPE_WINDOW)
@@ -564,10 +562,7 @@ update_dialog_state (PpNewPrinterDialog *self)
   gboolean                   searching;
 
   searching = self->cups_searching ||
-              self->remote_cups_host != NULL ||
-              self->snmp_host != NULL ||
-              self->socket_host != NULL ||
-              self->lpd_host != NULL ||
+              pp_discovery_is_searching (self->discovery) ||
               self->samba_host != NULL ||
               self->samba_authenticated_searching ||
               self->samba_searching;
@@ -841,102 +836,6 @@ get_cups_devices_cb (GPtrArray *devices,
     }
 }
 
-static void
-get_snmp_devices_cb (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_snmp_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->snmp_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->snmp_host);
-
-          update_dialog_state (self);
-        }
-    }
-}
-
-static void
-get_remote_cups_devices_cb (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
-{
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_remote_cups_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->remote_cups_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->remote_cups_host);
-
-          update_dialog_state (self);
-        }
-    }
-}
-
-static void
-get_samba_host_devices_cb (GObject      *source_object,
-                           GAsyncResult *res,
-                           gpointer      user_data)
-{
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GPtrArray)       devices = NULL;
-  g_autoptr(GError)          error = NULL;
-
-  devices = pp_samba_get_devices_finish (PP_SAMBA (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->samba_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->samba_host);
-
-          update_dialog_state (self);
-        }
-    }
-}
-
 static void
 get_samba_devices_cb (GObject      *source_object,
                       GAsyncResult *res,
@@ -970,67 +869,12 @@ get_samba_devices_cb (GObject      *source_object,
 }
 
 static void
-get_jetdirect_devices_cb (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
-{
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_jetdirect_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->socket_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->socket_host);
-
-          update_dialog_state (self);
-        }
-    }
-}
-
-static void
-get_lpd_devices_cb (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
+discovery_devices_found_cb (PpNewPrinterDialog *self,
+                            GPtrArray          *devices)
 {
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_lpd_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->lpd_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
+  add_devices_to_list (self, devices);
 
-          g_clear_object(&self->lpd_host);
-
-          update_dialog_state (self);
-        }
-    }
+  update_dialog_state (self);
 }
 
 static void
@@ -1096,17 +940,18 @@ parse_uri (const gchar  *uri,
 
 typedef struct
 {
-  PpNewPrinterDialog *dialog;
-  gchar              *host_scheme;
-  gchar              *host_name;
-  gint                host_port;
+  PpNewPrinterDialog  *dialog;
+  gchar               *host_scheme;
+  gchar              **host_names;
+  gint                 host_port;
+  gboolean             use_cache;
 } THostSearchData;
 
 static void
 search_for_remote_printers_free (THostSearchData *data)
 {
   g_free (data->host_scheme);
-  g_free (data->host_name);
+  g_strfreev (data->host_names);
   g_free (data);
 }
 
@@ -1115,66 +960,89 @@ search_for_remote_printers (THostSearchData *data)
 {
   PpNewPrinterDialog *self = data->dialog;
 
-  g_cancellable_cancel (self->remote_host_cancellable);
-  g_clear_object (&self->remote_host_cancellable);
+  pp_discovery_search (self->discovery,
+                       (const gchar * const *) data->host_names,
+                       data->host_scheme,
+                       data->host_port,
+                       data->use_cache);
 
-  self->remote_host_cancellable = g_cancellable_new ();
+  update_dialog_state (data->dialog);
 
-  self->remote_cups_host = pp_host_new (data->host_name);
-  self->snmp_host = pp_host_new (data->host_name);
-  self->socket_host = pp_host_new (data->host_name);
-  self->lpd_host = pp_host_new (data->host_name);
+  self->host_search_timeout_id = 0;
 
-  if (data->host_port != PP_HOST_UNSET_PORT)
-    {
-      g_object_set (self->remote_cups_host, "port", data->host_port, NULL);
-      g_object_set (self->snmp_host, "port", data->host_port, NULL);
-
-      /* Accept port different from the default one only if user specifies
-       * scheme (for socket and lpd printers).
-       */
-      if (data->host_scheme != NULL &&
-          g_ascii_strcasecmp (data->host_scheme, "socket") == 0)
-        g_object_set (self->socket_host, "port", data->host_port, NULL);
-
-      if (data->host_scheme != NULL &&
-          g_ascii_strcasecmp (data->host_scheme, "lpd") == 0)
-        g_object_set (self->lpd_host, "port", data->host_port, NULL);
-    }
+  return G_SOURCE_REMOVE;
+}
 
-  self->samba_host = pp_samba_new (data->host_name);
+/*
+ * Parses the search text as an IPv4 subnet ("192.168.1.0/24"),
+ * a comma separated list of hosts or a single address.  Scheme
+ * and port of the first host of a list are used for all of them.
+ */
+static gchar **
+parse_search_hosts (const gchar  *text,
+                    gchar       **scheme,
+                    gint         *port)
+{
+  g_auto(GStrv)        entries = NULL;
+  g_autoptr(GPtrArray) hosts = NULL;
+  gchar              **subnet_hosts;
+  gint                 i;
 
-  update_dialog_state (data->dialog);
+  *scheme = NULL;
+  *port = PP_HOST_UNSET_PORT;
+
+  subnet_hosts = pp_discovery_get_subnet_hosts (text);
+  if (subnet_hosts != NULL)
+    return subnet_hosts;
+
+  hosts = g_ptr_array_new_with_free_func (g_free);
+  entries = g_strsplit (text, ",", -1);
+  for (i = 0; entries[i] != NULL; i++)
+    {
+      g_autoptr(GSocketConnectable) conn = NULL;
+      g_autofree gchar *test_uri = NULL;
+      g_autofree gchar *test_port = NULL;
+      g_autofree gchar *entry_scheme = NULL;
+      g_autofree gchar *host = NULL;
+      gint   entry_port;
+
+      g_strstrip (entries[i]);
+      if (entries[i][0] == '\0')
+        continue;
+
+      parse_uri (entries[i], &entry_scheme, &host, &entry_port);
+      if (host == NULL)
+        continue;
+
+      if (entry_port >= 0)
+        test_port = g_strdup_printf (":%d", entry_port);
+      else
+        test_port = g_strdup ("");
 
-  pp_host_get_remote_cups_devices_async (self->remote_cups_host,
-                                         self->remote_host_cancellable,
-                                         get_remote_cups_devices_cb,
-                                         data->dialog);
+      test_uri = g_strdup_printf ("%s://%s%s",
+                                  entry_scheme != NULL && entry_scheme[0] != '\0' ? entry_scheme : "none",
+                                  host,
+                                  test_port);
 
-  pp_host_get_snmp_devices_async (self->snmp_host,
-                                  self->remote_host_cancellable,
-                                  get_snmp_devices_cb,
-                                  data->dialog);
+      conn = g_network_address_parse_uri (test_uri, 0, NULL);
+      if (conn == NULL)
+        continue;
 
-  pp_host_get_jetdirect_devices_async (self->socket_host,
-                                       self->remote_host_cancellable,
-                                       get_jetdirect_devices_cb,
-                                       data->dialog);
+      if (hosts->len == 0)
+        {
+          *scheme = g_steal_pointer (&entry_scheme);
+          *port = entry_port;
+        }
 
-  pp_host_get_lpd_devices_async (self->lpd_host,
-                                 self->remote_host_cancellable,
-                                 get_lpd_devices_cb,
-                                 data->dialog);
+      g_ptr_array_add (hosts, g_steal_pointer (&host));
+    }
 
-  pp_samba_get_devices_async (self->samba_host,
-                              FALSE,
-                              self->remote_host_cancellable,
-                              get_samba_host_devices_cb,
-                              data->dialog);
+  if (hosts->len == 0)
+    return NULL;
 
-  self->host_search_timeout_id = 0;
+  g_ptr_array_add (hosts, NULL);
 
-  return G_SOURCE_REMOVE;
+  return (gchar **) g_ptr_array_free (g_steal_pointer (&hosts), FALSE);
 }
 
 static void
@@ -1184,6 +1052,7 @@ search_address (const gchar        *text,
 {
   GtkTreeIter                 iter;
   gboolean                    found = FALSE;
+  gboolean                    host_list;
   gboolean                    subfound;
   gboolean                    next_set;
   gboolean                    cont;
@@ -1193,6 +1062,9 @@ search_address (const gchar        *text,
   gint                        i;
   gint                        acquisition_method;
 
+  /* Lists of hosts and subnets can not be matched against device names */
+  host_list = strchr (text, ',') != NULL || pp_discovery_is_subnet (text);
+
   lowercase_text = g_ascii_strdown (text, -1);
   words = g_strsplit_set (lowercase_text, " ", -1);
 
@@ -1242,7 +1114,7 @@ search_address (const gchar        *text,
    * The given word is probably an address since it was not found among
    * already present devices.
    */
-  if (!found && words_length == 1)
+  if (host_list || (!found && words_length == 1))
     {
       cont = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (self->devices_liststore), &iter);
       while (cont)
@@ -1277,53 +1149,37 @@ search_address (const gchar        *text,
 
       if (text && text[0] != '\0')
         {
-          g_autoptr(GSocketConnectable) conn = NULL;
-          g_autofree gchar *test_uri = NULL;
-          g_autofree gchar *test_port = NULL;
-          gchar *scheme = NULL;
-          gchar *host = NULL;
-          gint   port;
-
-          parse_uri (text, &scheme, &host, &port);
+          gchar  *scheme = NULL;
+          gchar **host_names;
+          gint    port;
 
-          if (host != NULL)
+          host_names = parse_search_hosts (text, &scheme, &port);
+          if (host_names != NULL)
             {
-              if (port >= 0)
-                test_port = g_strdup_printf (":%d", port);
-              else
-                test_port = g_strdup ("");
-
-              test_uri = g_strdup_printf ("%s://%s%s",
-                                          scheme != NULL && scheme[0] != '\0' ? scheme : "none",
-                                          host,
-                                          test_port);
-
-              conn = g_network_address_parse_uri (test_uri, 0, NULL);
-              if (conn != NULL)
-                {
-                  THostSearchData *search_data;
+              THostSearchData *search_data;
 
-                  search_data = g_new (THostSearchData, 1);
-                  search_data->host_scheme = scheme;
-                  search_data->host_name = host;
-                  search_data->host_port = port;
-                  search_data->dialog = self;
+              search_data = g_new (THostSearchData, 1);
+              search_data->host_scheme = scheme;
+              search_data->host_names = host_names;
+              search_data->host_port = port;
+              /* Searching explicitly is the way to find printers turned on since */
+              search_data->use_cache = delay_search;
+              search_data->dialog = self;
 
-                  g_clear_handle_id (&self->host_search_timeout_id, g_source_remove);
+              g_clear_handle_id (&self->host_search_timeout_id, g_source_remove);
 
-                  if (delay_search)
-                    {
-                      self->host_search_timeout_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
-                                                                         HOST_SEARCH_DELAY,
-                                                                         (GSourceFunc) search_for_remote_printers,
-                                                                         search_data,
-                                                                         (GDestroyNotify) search_for_remote_printers_free);
-                    }
-                  else
-                    {
-                      search_for_remote_printers (search_data);
-                      search_for_remote_printers_free (search_data);
-                    }
+              if (delay_search)
+                {
+                  self->host_search_timeout_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                                                     HOST_SEARCH_DELAY,
+                                                                     (GSourceFunc) search_for_remote_printers,
+                                                                     search_data,
+                                                                     (GDestroyNotify) search_for_remote_printers_free);
+                }
+              else
+                {
+                  search_for_remote_printers (search_data);
+                  search_for_remote_printers_free (search_data);
                 }
             }
         }
@@ -1773,6 +1629,10 @@ pp_new_printer_dialog_new (PPDList              *ppd_list,
   /* GCancellable for cancelling of async operations */
   self->cancellable = g_cancellable_new ();
 
+  self->discovery = pp_discovery_new ();
+  g_signal_connect_object (self->discovery, "devices-found", G_CALLBACK (discovery_devices_found_cb), self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->discovery, "finished", G_CALLBACK (update_dialog_state), self, G_CONNECT_SWAPPED);
+
   g_signal_connect_object (self->search_entry, "activate", G_CALLBACK (search_entry_activated_cb), self, G_CONNECT_SWAPPED);
   g_signal_connect_object (self->search_entry, "search-changed", G_CALLBACK (search_entry_changed_cb), self, G_CONNECT_SWAPPED);
 
@@ -1804,11 +1664,9 @@ pp_new_printer_dialog_dispose (GObject *object)
 {
   PpNewPrinterDialog *self = PP_NEW_PRINTER_DIALOG (object);
 
-  g_cancellable_cancel (self->remote_host_cancellable);
   g_cancellable_cancel (self->cancellable);
 
   g_clear_handle_id (&self->host_search_timeout_id, g_source_remove);
-  g_clear_object (&self->remote_host_cancellable);
   g_clear_object (&self->cancellable);
   g_clear_pointer (&self->list, ppd_list_free);
   g_clear_pointer (&self->local_cups_devices, g_ptr_array_unref);
@@ -1816,10 +1674,7 @@ pp_new_printer_dialog_dispose (GObject *object)
   g_clear_object (&self->local_printer_icon);
   g_clear_object (&self->remote_printer_icon);
   g_clear_object (&self->authenticated_server_icon);
-  g_clear_object (&self->snmp_host);
-  g_clear_object (&self->socket_host);
-  g_clear_object (&self->lpd_host);
-  g_clear_object (&self->remote_cups_host);
+  g_clear_object (&self->discovery);
   g_clear_object (&self->samba_host);
 
   if (self->ppd_selection_dialog != NULL)
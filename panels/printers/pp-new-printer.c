@@ -418,6 +418,7 @@ printer_add_real_async_dbus_cb (GObject      *source_object,
   if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
       get_named_dest_async (self->name,
+                            NULL,
                             printer_add_real_async_cb,
                             self);
     }
@@ -537,6 +538,34 @@ printer_add_async_scb3 (GObject      *source_object,
         g_warning ("%s", error->message);
     }
 
+  /* Fall back to the catalogue of installed PPDs. Only an exact
+   * model match is installed without asking, similar models are
+   * left for the user to pick in the PPD selection dialog.
+   */
+  if (ppd_item == NULL &&
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      PPDName **ppds;
+
+      ppds = get_indexed_ppd_names (self->device_id, self->make_and_model, 1);
+      if (ppds != NULL)
+        {
+          g_clear_pointer (&ppds[0]->ppd_display_name, g_free);
+
+          if (ppds[0]->ppd_match_level >= PPD_EXACT_MATCH)
+            {
+              ppd_item = ppds[0];
+            }
+          else
+            {
+              g_free (ppds[0]->ppd_name);
+              g_free (ppds[0]);
+            }
+
+          g_free (ppds);
+        }
+    }
+
   if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
       ppd_item && ppd_item->ppd_name)
     {
@@ -1223,6 +1252,7 @@ printer_configure_async (PpNewPrinter *self)
   printer_get_ppd_async (self->name,
                          NULL,
                          0,
+                         NULL,
                          printer_get_ppd_cb,
                          ime_data);
 }
@@ -1280,6 +1310,7 @@ pp_new_printer_add_async (PpNewPrinter        *self,
       printer_get_ppd_async (self->original_name,
                              self->host_name,
                              self->host_port,
+                             NULL,
                              printer_add_async_scb4,
                              self);
     }
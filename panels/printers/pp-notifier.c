@@ -0,0 +1,360 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "shell/cc-object-storage.h"
+
+#include "pp-notifier.h"
+#include "pp-cups.h"
+
+#define RENEW_INTERVAL        500
+#define SUBSCRIPTION_DURATION 600
+
+#define CUPS_DBUS_NAME      "org.cups.cupsd.Notifier"
+#define CUPS_DBUS_PATH      "/org/cups/cupsd/Notifier"
+#define CUPS_DBUS_INTERFACE "org.cups.cupsd.Notifier"
+
+/*
+ * PpNotifier owns the single CUPS subscription of the panel and
+ * forwards the notifications it receives over D-Bus as signals.
+ * The panel, the printer entries and their dialogs all share one
+ * instance, so that CUPS has to keep only one subscription alive
+ * for us and each notification is parsed once.
+ */
+struct _PpNotifier
+{
+  GObject          parent_instance;
+
+  PpCups          *cups;
+  GDBusProxy      *cups_proxy;
+  GDBusConnection *cups_bus_connection;
+  gint             subscription_id;
+  guint            subscription_renewal_id;
+  guint            dbus_subscription_id;
+  gboolean         renewing;
+};
+
+G_DEFINE_TYPE (PpNotifier, pp_notifier, G_TYPE_OBJECT)
+
+enum {
+  PRINTER_ADDED,
+  PRINTER_DELETED,
+  PRINTER_STATE_CHANGED,
+  PRINTERS_CHANGED,
+  JOB_CHANGED,
+  LAST_SIGNAL,
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+static PpNotifier *default_notifier = NULL;
+
+static gchar *subscription_events[] = {
+  "printer-added",
+  "printer-deleted",
+  "printer-stopped",
+  "printer-state-changed",
+  "job-created",
+  "job-completed",
+  NULL};
+
+static void
+on_cups_notification (GDBusConnection *connection,
+                      const char      *sender_name,
+                      const char      *object_path,
+                      const char      *interface_name,
+                      const char      *signal_name,
+                      GVariant        *parameters,
+                      gpointer         user_data)
+{
+  PpNotifier *self = user_data;
+  gboolean    printer_is_accepting_jobs;
+  gchar      *printer_name = NULL;
+  gchar      *text = NULL;
+  gchar      *printer_uri = NULL;
+  gchar      *printer_state_reasons = NULL;
+  gchar      *job_state_reasons = NULL;
+  gchar      *job_name = NULL;
+  guint       job_id = 0;
+  gint        printer_state;
+  gint        job_state;
+  gint        job_impressions_completed;
+
+  if (g_variant_n_children (parameters) == 1)
+    g_variant_get (parameters, "(&s)", &text);
+  else if (g_variant_n_children (parameters) == 6)
+    {
+      g_variant_get (parameters, "(&s&s&su&sb)",
+                     &text,
+                     &printer_uri,
+                     &printer_name,
+                     &printer_state,
+                     &printer_state_reasons,
+                     &printer_is_accepting_jobs);
+    }
+  else if (g_variant_n_children (parameters) == 11)
+    {
+      g_variant_get (parameters, "(&s&s&su&sbuu&s&su)",
+                     &text,
+                     &printer_uri,
+                     &printer_name,
+                     &printer_state,
+                     &printer_state_reasons,
+                     &printer_is_accepting_jobs,
+                     &job_id,
+                     &job_state,
+                     &job_state_reasons,
+                     &job_name,
+                     &job_impressions_completed);
+    }
+
+  if (g_strcmp0 (signal_name, "PrinterAdded") == 0 ||
+      g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
+      g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
+      g_strcmp0 (signal_name, "PrinterStopped") == 0)
+    {
+      if (printer_name == NULL)
+        g_signal_emit (self, signals[PRINTERS_CHANGED], 0);
+      else if (g_strcmp0 (signal_name, "PrinterAdded") == 0)
+        g_signal_emit (self, signals[PRINTER_ADDED], 0, printer_name);
+      else if (g_strcmp0 (signal_name, "PrinterDeleted") == 0)
+        g_signal_emit (self, signals[PRINTER_DELETED], 0, printer_name);
+      else
+        g_signal_emit (self, signals[PRINTER_STATE_CHANGED], 0,
+                       printer_name,
+                       printer_state,
+                       printer_state_reasons,
+                       printer_is_accepting_jobs);
+    }
+  else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
+           g_strcmp0 (signal_name, "JobCompleted") == 0)
+    {
+      if (printer_name != NULL)
+        g_signal_emit (self, signals[JOB_CHANGED], 0, printer_name, job_id);
+    }
+}
+
+static void
+attach_to_cups_notifier (PpNotifier *self)
+{
+  g_autoptr(GError) error = NULL;
+
+  self->cups_proxy = cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SYSTEM,
+                                                               G_DBUS_PROXY_FLAGS_NONE,
+                                                               CUPS_DBUS_NAME,
+                                                               CUPS_DBUS_PATH,
+                                                               CUPS_DBUS_INTERFACE,
+                                                               NULL,
+                                                               &error);
+
+  if (!self->cups_proxy)
+    {
+      g_warning ("%s", error->message);
+      return;
+    }
+
+  self->cups_bus_connection = g_dbus_proxy_get_connection (self->cups_proxy);
+
+  self->dbus_subscription_id =
+    g_dbus_connection_signal_subscribe (self->cups_bus_connection,
+                                        NULL,
+                                        CUPS_DBUS_INTERFACE,
+                                        NULL,
+                                        CUPS_DBUS_PATH,
+                                        NULL,
+                                        0,
+                                        on_cups_notification,
+                                        self,
+                                        NULL);
+}
+
+static gboolean renew_subscription_timeout (gpointer user_data);
+
+static void
+renew_subscription_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  g_autoptr(PpNotifier) self = user_data;
+  gint                  subscription_id;
+
+  subscription_id = pp_cups_renew_subscription_finish (PP_CUPS (source_object), result);
+  self->renewing = FALSE;
+
+  if (subscription_id <= 0)
+    return;
+
+  /* A new subscription means that notifications could have been
+   * missed in the meantime (e.g. CUPS has been restarted).
+   */
+  if (self->subscription_id > 0 && subscription_id != self->subscription_id)
+    {
+      self->subscription_id = subscription_id;
+      g_signal_emit (self, signals[PRINTERS_CHANGED], 0);
+    }
+  else
+    {
+      self->subscription_id = subscription_id;
+    }
+
+  if (self->subscription_renewal_id == 0)
+    self->subscription_renewal_id =
+      g_timeout_add_seconds (RENEW_INTERVAL, renew_subscription_timeout, self);
+
+  if (self->dbus_subscription_id == 0 && self->cups_proxy == NULL)
+    attach_to_cups_notifier (self);
+}
+
+void
+pp_notifier_renew_subscription (PpNotifier *self)
+{
+  g_return_if_fail (PP_IS_NOTIFIER (self));
+
+  if (self->renewing)
+    return;
+
+  self->renewing = TRUE;
+  pp_cups_renew_subscription_async (self->cups,
+                                    self->subscription_id,
+                                    subscription_events,
+                                    SUBSCRIPTION_DURATION,
+                                    NULL,
+                                    renew_subscription_cb,
+                                    g_object_ref (self));
+}
+
+static gboolean
+renew_subscription_timeout (gpointer user_data)
+{
+  pp_notifier_renew_subscription (PP_NOTIFIER (user_data));
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+subscription_cancel_cb (GObject      *source_object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  pp_cups_cancel_subscription_finish (PP_CUPS (source_object), result);
+}
+
+static void
+pp_notifier_dispose (GObject *object)
+{
+  PpNotifier *self = PP_NOTIFIER (object);
+
+  if (self->dbus_subscription_id != 0)
+    {
+      g_dbus_connection_signal_unsubscribe (self->cups_bus_connection,
+                                            self->dbus_subscription_id);
+      self->dbus_subscription_id = 0;
+    }
+
+  if (self->subscription_id > 0)
+    {
+      pp_cups_cancel_subscription_async (self->cups,
+                                         self->subscription_id,
+                                         subscription_cancel_cb,
+                                         NULL);
+      self->subscription_id = 0;
+    }
+
+  g_clear_handle_id (&self->subscription_renewal_id, g_source_remove);
+  g_clear_object (&self->cups_proxy);
+  g_clear_object (&self->cups);
+
+  G_OBJECT_CLASS (pp_notifier_parent_class)->dispose (object);
+}
+
+static void
+pp_notifier_class_init (PpNotifierClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->dispose = pp_notifier_dispose;
+
+  signals[PRINTER_ADDED] =
+    g_signal_new ("printer-added",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  signals[PRINTER_DELETED] =
+    g_signal_new ("printer-deleted",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  /* Emitted for both PrinterStateChanged and PrinterStopped */
+  signals[PRINTER_STATE_CHANGED] =
+    g_signal_new ("printer-state-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 4,
+                  G_TYPE_STRING, G_TYPE_INT, G_TYPE_STRING, G_TYPE_BOOLEAN);
+
+  /* Emitted when notifications could have been lost and listeners
+   * should reload their state from scratch.
+   */
+  signals[PRINTERS_CHANGED] =
+    g_signal_new ("printers-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+
+  /* Emitted when a job has been created on or completed by a printer */
+  signals[JOB_CHANGED] =
+    g_signal_new ("job-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_UINT);
+}
+
+static void
+pp_notifier_init (PpNotifier *self)
+{
+  self->cups = pp_cups_new ();
+}
+
+/*
+ * Returns a new reference to the notifier shared by the whole panel.
+ * The subscription is created on first use and cancelled once the
+ * last reference is dropped.
+ */
+PpNotifier *
+pp_notifier_get_default (void)
+{
+  if (default_notifier != NULL)
+    return g_object_ref (default_notifier);
+
+  default_notifier = g_object_new (PP_TYPE_NOTIFIER, NULL);
+  g_object_add_weak_pointer (G_OBJECT (default_notifier), (gpointer *) &default_notifier);
+
+  pp_notifier_renew_subscription (default_notifier);
+
+  return default_notifier;
+}
@@ -1,10 +1,7 @@
-/* globs.h
- *
- * Copyright 2018 Matthias Clasen <matthias.clasen@gmail.com>
- *
- * This program is free software: you can redistribute it and/or modify
+/*
+ * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
+ * the Free Software Foundation; either version 2 of the License, or
  * (at your option) any later version.
  *
  * This program is distributed in the hope that it will be useful,
@@ -13,17 +10,21 @@
  * GNU General Public License for more details.
  *
  * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
- *
- * SPDX-License-Identifier: GPL-3.0-or-later
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
 #pragma once
 
+#include <glib-object.h>
 #include <gio/gio.h>
 
 G_BEGIN_DECLS
 
-GHashTable* parse_search_providers (void);
+#define PP_TYPE_NOTIFIER (pp_notifier_get_type ())
+G_DECLARE_FINAL_TYPE (PpNotifier, pp_notifier, PP, NOTIFIER, GObject)
+
+PpNotifier *pp_notifier_get_default          (void);
+
+void        pp_notifier_renew_subscription   (PpNotifier *notifier);
 
 G_END_DECLS
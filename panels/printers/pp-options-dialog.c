@@ -61,6 +61,8 @@ struct _PpOptionsDialog {
   GHashTable  *ipp_attributes;
   gboolean     ipp_attributes_set;
 
+  GCancellable *cancellable;
+
   gboolean sensitive;
 };
 
@@ -750,18 +752,23 @@ populate_options (PpOptionsDialog *self)
 
   gtk_spinner_start (self->spinner);
 
+  self->cancellable = g_cancellable_new ();
+
   printer_get_ppd_async (self->printer_name,
                          NULL,
                          0,
+                         self->cancellable,
                          printer_get_ppd_cb,
                          self);
 
   get_named_dest_async (self->printer_name,
+                        self->cancellable,
                         get_named_dest_cb,
                         self);
 
   get_ipp_attributes_async (self->printer_name,
                             (gchar **) attributes,
+                            self->cancellable,
                             get_ipp_attributes_cb,
                             self);
 }
@@ -880,6 +887,9 @@ pp_options_dialog_dispose (GObject *object)
 {
   PpOptionsDialog *self = PP_OPTIONS_DIALOG (object);
 
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+
   g_free (self->printer_name);
   self->printer_name = NULL;
 
@@ -56,6 +56,7 @@ struct _PpPPDOptionWidget
   gboolean  ppd_filename_set;
 
   GCancellable *cancellable;
+  GCancellable *update_cancellable;
 };
 
 G_DEFINE_TYPE (PpPPDOptionWidget, pp_ppd_option_widget, GTK_TYPE_BOX)
@@ -154,6 +155,7 @@ pp_ppd_option_widget_finalize (GObject *object)
   PpPPDOptionWidget *self = PP_PPD_OPTION_WIDGET (object);
 
   g_cancellable_cancel (self->cancellable);
+  g_cancellable_cancel (self->update_cancellable);
   if (self->ppd_filename)
     g_unlink (self->ppd_filename);
 
@@ -167,6 +169,7 @@ pp_ppd_option_widget_finalize (GObject *object)
     }
   g_clear_pointer (&self->ppd_filename, g_free);
   g_clear_object (&self->cancellable);
+  g_clear_object (&self->update_cancellable);
 
   G_OBJECT_CLASS (pp_ppd_option_widget_parent_class)->finalize (object);
 }
@@ -520,13 +523,19 @@ update_widget (PpPPDOptionWidget *self)
   self->ppd_filename_set = FALSE;
   self->destination_set = FALSE;
 
+  g_cancellable_cancel (self->update_cancellable);
+  g_clear_object (&self->update_cancellable);
+  self->update_cancellable = g_cancellable_new ();
+
   get_named_dest_async (self->printer_name,
+                        self->update_cancellable,
                         get_named_dest_cb,
                         self);
 
   printer_get_ppd_async (self->printer_name,
                          NULL,
                          0,
+                         self->update_cancellable,
                          printer_get_ppd_cb,
                          self);
 }
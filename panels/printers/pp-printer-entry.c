@@ -26,6 +26,7 @@
 
 #include "pp-details-dialog.h"
 #include "pp-maintenance-command.h"
+#include "pp-notifier.h"
 #include "pp-options-dialog.h"
 #include "pp-jobs-dialog.h"
 #include "pp-printer.h"
@@ -80,6 +81,8 @@ struct _PpPrinterEntry
   PpJobsDialog    *pp_jobs_dialog;
 
   GCancellable *get_jobs_cancellable;
+
+  PpNotifier   *notifier;
 };
 
 struct _PpPrinterEntryClass
@@ -545,7 +548,7 @@ get_jobs_cb (GObject      *source_object,
 
   if (self->pp_jobs_dialog != NULL)
     {
-      pp_jobs_dialog_update (self->pp_jobs_dialog);
+      pp_jobs_dialog_set_jobs (self->pp_jobs_dialog, jobs);
     }
 
   g_clear_object (&self->get_jobs_cancellable);
@@ -640,6 +643,15 @@ pp_printer_entry_get_size_group_widgets (PpPrinterEntry *self)
   return widgets;
 }
 
+static void
+on_job_changed (PpPrinterEntry *self,
+                const gchar    *printer_name,
+                guint           job_id)
+{
+  if (g_strcmp0 (printer_name, self->printer_name) == 0)
+    pp_printer_entry_update_jobs_count (self);
+}
+
 PpPrinterEntry *
 pp_printer_entry_new (cups_dest_t  printer,
                       gboolean     is_authorized)
@@ -657,6 +669,12 @@ pp_printer_entry_new (cups_dest_t  printer,
                                                     _("Clean print heads"));
   check_clean_heads_maintenance_command (self);
 
+  self->notifier = pp_notifier_get_default ();
+  g_signal_connect_swapped (self->notifier,
+                            "job-changed",
+                            G_CALLBACK (on_job_changed),
+                            self);
+
   gtk_drawing_area_set_draw_func (self->supply_drawing_area,
                                   supply_levels_draw_cb,
                                   self,
@@ -963,6 +981,10 @@ pp_printer_entry_dispose (GObject *object)
   g_cancellable_cancel (self->get_jobs_cancellable);
   g_cancellable_cancel (self->check_clean_heads_cancellable);
 
+  if (self->notifier != NULL)
+    g_signal_handlers_disconnect_by_data (self->notifier, self);
+  g_clear_object (&self->notifier);
+
   g_clear_pointer (&self->printer_name, g_free);
   g_clear_pointer (&self->printer_location, g_free);
   g_clear_pointer (&self->printer_make_and_model, g_free);
@@ -220,96 +220,158 @@ typedef struct
   gint      which_jobs;
 } GetJobsData;
 
+static gchar **
+get_auth_info_required (const gchar *printer_name)
+{
+  ipp_attribute_t  *attr;
+  static gchar     *printer_attributes[] = { "auth-info-required" };
+  g_autofree gchar *printer_uri = NULL;
+  gchar           **auth_info_required = NULL;
+  ipp_t            *request;
+  ipp_t            *response;
+  gint              i;
+
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", printer_name);
+
+  request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, printer_uri);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                "requesting-user-name", NULL, cupsUser ());
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", 1, NULL, (const char **) printer_attributes);
+  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+
+  if (response != NULL)
+    {
+      attr = ippFindAttribute (response, "auth-info-required", IPP_TAG_ZERO);
+      if (attr != NULL)
+        {
+          auth_info_required = g_new0 (gchar *, ippGetCount (attr) + 1);
+          for (i = 0; i < ippGetCount (attr); i++)
+            auth_info_required[i] = g_strdup (ippGetString (attr, i, NULL));
+        }
+
+      ippDelete (response);
+    }
+
+  return auth_info_required;
+}
+
+/*
+ * All the attributes needed for the list of jobs are requested by one
+ * IPP_GET_JOBS request instead of asking for "job-hold-until" of each
+ * held job separately.
+ */
 static void
 get_jobs_thread (GTask        *task,
                  gpointer      source_object,
                  gpointer      task_data,
                  GCancellable *cancellable)
 {
-  ipp_attribute_t  *attr = NULL;
-  static gchar     *printer_attributes[] = { "auth-info-required" };
+  ipp_attribute_t  *attr;
+  static const gchar *job_attributes[] = {
+    "job-id",
+    "job-name",
+    "job-state",
+    "job-priority",
+    "job-hold-until" };
   GetJobsData      *get_jobs_data = task_data;
-  cups_job_t       *jobs = NULL;
   PpPrinter        *self = PP_PRINTER (source_object);
-  gboolean          auth_info_is_required;
-  PpJob            *job;
-  ipp_t            *job_request;
-  ipp_t            *job_response;
-  ipp_t            *printer_request;
-  ipp_t            *printer_response;
+  ipp_t            *request;
+  ipp_t            *response;
   gchar           **auth_info_required = NULL;
-  g_autofree gchar *printer_name = NULL;
+  gboolean          auth_info_checked = FALSE;
+  g_autofree gchar *printer_uri = NULL;
   g_autoptr(GPtrArray) array = NULL;
-  gint              num_jobs;
-  gint              i, j;
+  const gchar      *which_jobs;
+
+  switch (get_jobs_data->which_jobs)
+    {
+      case CUPS_WHICHJOBS_ALL:
+        which_jobs = "all";
+        break;
+      case CUPS_WHICHJOBS_COMPLETED:
+        which_jobs = "completed";
+        break;
+      default:
+        which_jobs = "not-completed";
+        break;
+    }
 
-  num_jobs = cupsGetJobs (&jobs,
-                          self->printer_name,
-                          get_jobs_data->myjobs ? 1 : 0,
-                          get_jobs_data->which_jobs);
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", self->printer_name);
+
+  request = ippNewRequest (IPP_GET_JOBS);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, printer_uri);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                "requesting-user-name", NULL, cupsUser ());
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                "which-jobs", NULL, which_jobs);
+  if (get_jobs_data->myjobs)
+    ippAddBoolean (request, IPP_TAG_OPERATION, "my-jobs", 1);
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (job_attributes), NULL, job_attributes);
+  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
 
   array = g_ptr_array_new_with_free_func (g_object_unref);
-  for (i = 0; i < num_jobs; i++)
+
+  if (response != NULL)
     {
-      auth_info_is_required = FALSE;
-      if (jobs[i].state == IPP_JOB_HELD)
+      for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
         {
-          g_autofree gchar *job_uri = g_strdup_printf ("ipp://localhost/jobs/%d", jobs[i].id);
-
-          job_request = ippNewRequest (IPP_GET_JOB_ATTRIBUTES);
-          ippAddString (job_request, IPP_TAG_OPERATION, IPP_TAG_URI,
-                        "job-uri", NULL, job_uri);
-          ippAddString (job_request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-                        "requesting-user-name", NULL, cupsUser ());
-          ippAddString (job_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-                        "requested-attributes", NULL, "job-hold-until");
-          job_response = cupsDoRequest (CUPS_HTTP_DEFAULT, job_request, "/");
-
-          if (job_response != NULL)
+          const gchar *title = NULL;
+          const gchar *hold_until = NULL;
+          gboolean     auth_info_is_required;
+          gint         id = 0;
+          gint         state = IPP_JOB_PENDING;
+          gint         priority = 50;
+
+          while (attr != NULL && ippGetGroupTag (attr) != IPP_TAG_JOB)
+            attr = ippNextAttribute (response);
+
+          if (attr == NULL)
+            break;
+
+          for (; attr != NULL && ippGetGroupTag (attr) == IPP_TAG_JOB; attr = ippNextAttribute (response))
+            {
+              const gchar *name = ippGetName (attr);
+
+              if (g_strcmp0 (name, "job-id") == 0 && ippGetValueTag (attr) == IPP_TAG_INTEGER)
+                id = ippGetInteger (attr, 0);
+              else if (g_strcmp0 (name, "job-name") == 0)
+                title = ippGetString (attr, 0, NULL);
+              else if (g_strcmp0 (name, "job-state") == 0 && ippGetValueTag (attr) == IPP_TAG_ENUM)
+                state = ippGetInteger (attr, 0);
+              else if (g_strcmp0 (name, "job-priority") == 0 && ippGetValueTag (attr) == IPP_TAG_INTEGER)
+                priority = ippGetInteger (attr, 0);
+              else if (g_strcmp0 (name, "job-hold-until") == 0)
+                hold_until = ippGetString (attr, 0, NULL);
+            }
+
+          if (id > 0)
             {
-              attr = ippFindAttribute (job_response, "job-hold-until", IPP_TAG_ZERO);
-              if (attr != NULL && g_strcmp0 (ippGetString (attr, 0, NULL), "auth-info-required") == 0)
+              auth_info_is_required = state == IPP_JOB_HELD &&
+                                      g_strcmp0 (hold_until, "auth-info-required") == 0;
+
+              if (auth_info_is_required && !auth_info_checked)
                 {
-                  auth_info_is_required = TRUE;
-
-                  if (auth_info_required == NULL)
-                    {
-                      g_autofree gchar *printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", self->printer_name);
-
-                      printer_request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
-                      ippAddString (printer_request, IPP_TAG_OPERATION, IPP_TAG_URI,
-                                    "printer-uri", NULL, printer_uri);
-                      ippAddString (printer_request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-                                    "requesting-user-name", NULL, cupsUser ());
-                      ippAddStrings (printer_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-                                     "requested-attributes", 1, NULL, (const char **) printer_attributes);
-                      printer_response = cupsDoRequest (CUPS_HTTP_DEFAULT, printer_request, "/");
-
-                      if (printer_response != NULL)
-                        {
-                          attr = ippFindAttribute (printer_response, "auth-info-required", IPP_TAG_ZERO);
-                          if (attr != NULL)
-                            {
-                              auth_info_required = g_new0 (gchar *, ippGetCount (attr) + 1);
-                              for (j = 0; j < ippGetCount (attr); j++)
-                                auth_info_required[j] = g_strdup (ippGetString (attr, j, NULL));
-                            }
-
-                          ippDelete (printer_response);
-                        }
-                    }
+                  auth_info_required = get_auth_info_required (self->printer_name);
+                  auth_info_checked = TRUE;
                 }
 
-              ippDelete (job_response);
+              g_ptr_array_add (array, pp_job_new (id, title, state, priority,
+                                                  auth_info_is_required ? auth_info_required : NULL));
             }
+
+          if (attr == NULL)
+            break;
         }
 
-      job = pp_job_new (jobs[i].id, jobs[i].title, jobs[i].state, jobs[i].priority, auth_info_is_required ? auth_info_required : NULL);
-      g_ptr_array_add (array, job);
+      ippDelete (response);
     }
 
   g_strfreev (auth_info_required);
-  cupsFreeJobs (num_jobs, jobs);
 
   if (g_task_set_return_on_cancel (task, FALSE))
     {
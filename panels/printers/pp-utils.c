@@ -22,6 +22,8 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include <gtk/gtk.h>
 #include <cups/cups.h>
 #include <cups/ppd.h>
@@ -1169,67 +1171,323 @@ get_page_size_from_locale (void)
     return "A4";
 }
 
+/*
+ * Blocking CUPS requests are run by a small pool of worker threads
+ * instead of by a new thread for each request. Each worker keeps its
+ * own connection to the CUPS server. Requests which have a key are
+ * shared: a request identical to one which is still in flight waits
+ * for its result instead of being sent again.
+ */
+#define IPP_MAX_WORKERS 4
+
+typedef struct _IPPRequest IPPRequest;
+
+typedef void (*IPPRequestCallback) (gpointer result,
+                                    gpointer user_data);
+
 typedef struct
 {
-  gchar        *printer_name;
-  gchar       **attributes_names;
-  GHashTable   *result;
-  GIACallback   callback;
-  gpointer      user_data;
-  GMainContext *context;
-} GIAData;
+  /* Runs in a worker thread and returns the result */
+  gpointer       (*run)            (IPPRequest *request,
+                                    http_t     *http,
+                                    gpointer    request_data);
+  /* Copies the result for additional waiters of shared requests */
+  GBoxedCopyFunc   copy_result;
+  /* Frees the result after the callback unless it is transferred */
+  GDestroyNotify   free_result;
+  /* Frees the result nobody received, free_result is used if NULL */
+  GDestroyNotify   discard_result;
+  gboolean         transfer_result;
+} IPPRequestClass;
 
-static GIAData *
-gia_data_new (const gchar *printer_name, gchar **attributes_names, GIACallback callback, gpointer user_data)
+typedef struct
 {
-  GIAData *data;
+  IPPRequestCallback  callback;
+  gpointer            user_data;
+  GCancellable       *cancellable;
+  GMainContext       *context;
+} IPPRequestWaiter;
 
-  data = g_new0 (GIAData, 1);
-  data->printer_name = g_strdup (printer_name);
-  data->attributes_names = g_strdupv (attributes_names);
-  data->callback = callback;
-  data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
+struct _IPPRequest
+{
+  const IPPRequestClass *klass;
+  gchar                 *key;
+  gpointer               request_data;
+  GDestroyNotify         request_data_free;
+  GPtrArray             *waiters;
+};
 
-  return data;
+typedef struct
+{
+  const IPPRequestClass *klass;
+  IPPRequestWaiter      *waiter;
+  gpointer               result;
+} IPPRequestDelivery;
+
+G_LOCK_DEFINE_STATIC (ipp_requests);
+static GHashTable *ipp_requests = NULL;
+
+static GPrivate ipp_connection = G_PRIVATE_INIT ((GDestroyNotify) httpClose);
+
+static void
+ipp_request_waiter_free (IPPRequestWaiter *waiter)
+{
+  g_clear_object (&waiter->cancellable);
+  if (waiter->context)
+    g_main_context_unref (waiter->context);
+  g_free (waiter);
 }
 
 static void
-gia_data_free (GIAData *data)
+ipp_request_free (IPPRequest *request)
 {
-  g_free (data->printer_name);
-  if (data->attributes_names)
-    g_strfreev (data->attributes_names);
-  if (data->result)
-    g_hash_table_unref (data->result);
-  if (data->context)
-    g_main_context_unref (data->context);
-  g_free (data);
+  g_free (request->key);
+  if (request->request_data_free)
+    request->request_data_free (request->request_data);
+  if (request->waiters)
+    g_ptr_array_unref (request->waiters);
+  g_free (request);
+}
+
+static void
+ipp_request_discard_result (const IPPRequestClass *klass,
+                            gpointer               result)
+{
+  if (result == NULL)
+    return;
+
+  if (klass->discard_result != NULL)
+    klass->discard_result (result);
+  else
+    klass->free_result (result);
+}
+
+static void
+ipp_request_delivery_free (IPPRequestDelivery *delivery)
+{
+  ipp_request_discard_result (delivery->klass, delivery->result);
+  ipp_request_waiter_free (delivery->waiter);
+  g_free (delivery);
 }
 
 static gboolean
-get_ipp_attributes_idle_cb (gpointer user_data)
+ipp_request_deliver_idle_cb (gpointer user_data)
 {
-  GIAData *data = (GIAData *) user_data;
+  IPPRequestDelivery *delivery = user_data;
+  IPPRequestWaiter   *waiter = delivery->waiter;
+  gpointer            result;
+
+  if (g_cancellable_is_cancelled (waiter->cancellable))
+    return FALSE;
+
+  result = g_steal_pointer (&delivery->result);
+  waiter->callback (result, waiter->user_data);
 
-  data->callback (data->result, data->user_data);
-  data->result = NULL;
+  if (!delivery->klass->transfer_result && result != NULL)
+    delivery->klass->free_result (result);
 
   return FALSE;
 }
 
+/*
+ * A request is cancelled only when all of its waiters are.
+ */
+static gboolean
+ipp_request_is_cancelled (IPPRequest *request)
+{
+  gboolean cancelled = TRUE;
+  guint    i;
+
+  G_LOCK (ipp_requests);
+  for (i = 0; i < request->waiters->len && cancelled; i++)
+    {
+      IPPRequestWaiter *waiter = g_ptr_array_index (request->waiters, i);
+
+      cancelled = g_cancellable_is_cancelled (waiter->cancellable);
+    }
+  G_UNLOCK (ipp_requests);
+
+  return cancelled;
+}
+
+static void
+ipp_request_complete (IPPRequest *request,
+                      gpointer    result)
+{
+  g_autoptr(GPtrArray) waiters = NULL;
+  guint                i;
+
+  G_LOCK (ipp_requests);
+  if (request->key != NULL)
+    g_hash_table_remove (ipp_requests, request->key);
+  waiters = g_steal_pointer (&request->waiters);
+  G_UNLOCK (ipp_requests);
+
+  for (i = 0; i < waiters->len; i++)
+    {
+      g_autoptr(GSource)  idle_source = NULL;
+      IPPRequestDelivery *delivery;
+
+      delivery = g_new0 (IPPRequestDelivery, 1);
+      delivery->klass = request->klass;
+      delivery->waiter = g_ptr_array_index (waiters, i);
+
+      /* The last waiter gets the original, the others get copies */
+      if (i == waiters->len - 1)
+        delivery->result = result;
+      else if (result != NULL)
+        delivery->result = request->klass->copy_result (result);
+
+      idle_source = g_idle_source_new ();
+      g_source_set_callback (idle_source,
+                             ipp_request_deliver_idle_cb,
+                             delivery,
+                             (GDestroyNotify) ipp_request_delivery_free);
+      g_source_attach (idle_source, delivery->waiter->context);
+    }
+}
+
+static http_t *
+get_ipp_connection (void)
+{
+  http_t *http;
+
+  http = g_private_get (&ipp_connection);
+  if (http == NULL)
+    {
+#ifdef HAVE_CUPS_HTTPCONNECT2
+      http = httpConnect2 (cupsServer (), ippPort (), NULL, AF_UNSPEC,
+                           cupsEncryption (), 1, 30000, NULL);
+#else
+      http = httpConnectEncrypt (cupsServer (), ippPort (), cupsEncryption ());
+#endif
+      g_private_set (&ipp_connection, http);
+    }
+
+  return http != NULL ? http : CUPS_HTTP_DEFAULT;
+}
+
+static void
+ipp_worker_func (gpointer data,
+                 gpointer user_data)
+{
+  IPPRequest *request = data;
+  gpointer    result = NULL;
+
+  if (!ipp_request_is_cancelled (request))
+    result = request->klass->run (request, get_ipp_connection (), request->request_data);
+
+  ipp_request_complete (request, result);
+  ipp_request_free (request);
+}
+
+static GThreadPool *
+get_ipp_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    g_once_init_leave (&pool, g_thread_pool_new (ipp_worker_func, NULL, IPP_MAX_WORKERS, FALSE, NULL));
+
+  return pool;
+}
+
+/*
+ * Run given request in the pool of IPP workers. The callback is called
+ * in the thread-default main context of the caller unless the cancellable
+ * gets cancelled. Requests of classes with copy_result can be shared
+ * under given key.
+ */
 static void
-get_ipp_attributes_cb (gpointer user_data)
+ipp_request_start (const IPPRequestClass *klass,
+                   const gchar           *key,
+                   gpointer               request_data,
+                   GDestroyNotify         request_data_free,
+                   GCancellable          *cancellable,
+                   IPPRequestCallback     callback,
+                   gpointer               user_data)
+{
+  g_autoptr(GError)  error = NULL;
+  IPPRequestWaiter  *waiter;
+  IPPRequest        *request;
+
+  waiter = g_new0 (IPPRequestWaiter, 1);
+  waiter->callback = callback;
+  waiter->user_data = user_data;
+  if (cancellable)
+    waiter->cancellable = g_object_ref (cancellable);
+  waiter->context = g_main_context_ref_thread_default ();
+
+  if (klass->copy_result == NULL)
+    key = NULL;
+
+  G_LOCK (ipp_requests);
+
+  if (ipp_requests == NULL)
+    ipp_requests = g_hash_table_new (g_str_hash, g_str_equal);
+
+  request = key != NULL ? g_hash_table_lookup (ipp_requests, key) : NULL;
+  if (request != NULL)
+    {
+      g_ptr_array_add (request->waiters, waiter);
+      G_UNLOCK (ipp_requests);
+
+      if (request_data_free)
+        request_data_free (request_data);
+
+      return;
+    }
+
+  request = g_new0 (IPPRequest, 1);
+  request->klass = klass;
+  request->request_data = request_data;
+  request->request_data_free = request_data_free;
+  request->waiters = g_ptr_array_new ();
+  g_ptr_array_add (request->waiters, waiter);
+
+  if (key != NULL)
+    {
+      request->key = g_strdup (key);
+      g_hash_table_insert (ipp_requests, request->key, request);
+    }
+
+  G_UNLOCK (ipp_requests);
+
+  if (!g_thread_pool_push (get_ipp_pool (), request, &error))
+    {
+      g_warning ("%s", error->message);
+
+      /* Let the waiters know, and don't let later requests join this one */
+      ipp_request_complete (request, NULL);
+      ipp_request_free (request);
+    }
+}
+
+typedef struct
 {
-  GIAData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  gchar  *printer_name;
+  gchar **attributes_names;
+} GIAData;
+
+static GIAData *
+gia_data_new (const gchar *printer_name, gchar **attributes_names)
+{
+  GIAData *data;
+
+  data = g_new0 (GIAData, 1);
+  data->printer_name = g_strdup (printer_name);
+  data->attributes_names = g_strdupv (attributes_names);
+
+  return data;
+}
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_ipp_attributes_idle_cb,
-                         data,
-                         (GDestroyNotify) gia_data_free);
-  g_source_attach (idle_source, data->context);
+static void
+gia_data_free (GIAData *data)
+{
+  g_free (data->printer_name);
+  if (data->attributes_names)
+    g_strfreev (data->attributes_names);
+  g_free (data);
 }
 
 static void
@@ -1240,10 +1498,13 @@ ipp_attribute_free2 (gpointer attr)
 }
 
 static gpointer
-get_ipp_attributes_func (gpointer user_data)
+get_ipp_attributes_func (IPPRequest *ipp_request,
+                         http_t     *http,
+                         gpointer    user_data)
 {
   ipp_attribute_t  *attr = NULL;
   GIAData          *data = user_data;
+  GHashTable       *result = NULL;
   ipp_t            *request;
   ipp_t            *response = NULL;
   g_autofree gchar *printer_uri = NULL;
@@ -1265,7 +1526,7 @@ get_ipp_attributes_func (gpointer user_data)
                     "printer-uri", NULL, printer_uri);
       ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
                      "requested-attributes", length, NULL, (const char **) requested_attrs);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+      response = cupsDoRequest (http, request, "/");
     }
 
   if (response)
@@ -1322,10 +1583,10 @@ get_ipp_attributes_func (gpointer user_data)
                         attribute->attribute_values[i].boolean_value = ippGetBoolean (attr, i);
                     }
 
-                  if (!data->result)
-                    data->result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ipp_attribute_free2);
+                  if (!result)
+                    result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ipp_attribute_free2);
 
-                  g_hash_table_insert (data->result, g_strdup (requested_attrs[j]), attribute);
+                  g_hash_table_insert (result, g_strdup (requested_attrs[j]), attribute);
                 }
             }
         }
@@ -1338,35 +1599,53 @@ get_ipp_attributes_func (gpointer user_data)
     g_free (requested_attrs[i]);
   g_free (requested_attrs);
 
-  get_ipp_attributes_cb (data);
+  return result;
+}
+
+/* Each waiter owns its table and may modify it */
+static GHashTable *
+ipp_attributes_copy (GHashTable *attributes)
+{
+  GHashTable     *result;
+  GHashTableIter  iter;
+  gpointer        key, value;
+
+  result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ipp_attribute_free2);
+
+  g_hash_table_iter_init (&iter, attributes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_hash_table_insert (result, g_strdup (key), ipp_attribute_copy (value));
 
-  return NULL;
+  return result;
 }
 
+static const IPPRequestClass get_ipp_attributes_class = {
+  .run = get_ipp_attributes_func,
+  .copy_result = (GBoxedCopyFunc) ipp_attributes_copy,
+  .free_result = (GDestroyNotify) g_hash_table_unref,
+  .transfer_result = TRUE,
+};
+
 void
 get_ipp_attributes_async (const gchar  *printer_name,
                           gchar       **attributes_names,
+                          GCancellable *cancellable,
                           GIACallback   callback,
                           gpointer      user_data)
 {
-  GIAData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
-
-  data = gia_data_new (printer_name, attributes_names, callback, user_data);
-
-  thread = g_thread_try_new ("get-ipp-attributes",
-                             get_ipp_attributes_func,
-                             data,
-                             &error);
+  g_autofree gchar *attributes = NULL;
+  g_autofree gchar *key = NULL;
 
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
+  attributes = attributes_names != NULL ? g_strjoinv (",", attributes_names) : g_strdup ("");
+  key = g_strdup_printf ("get-ipp-attributes:%s:%s", printer_name, attributes);
 
-      gia_data_free (data);
-    }
+  ipp_request_start (&get_ipp_attributes_class,
+                     key,
+                     gia_data_new (printer_name, attributes_names),
+                     (GDestroyNotify) gia_data_free,
+                     cancellable,
+                     (IPPRequestCallback) callback,
+                     user_data);
 }
 
 IPPAttribute *
@@ -1630,23 +1909,19 @@ typedef struct
 {
   gchar        **ppds_names;
   gchar         *attribute_name;
-  gchar        **result;
-  GPACallback    callback;
-  gpointer       user_data;
-  GMainContext  *context;
+  GCancellable  *cancellable;
 } GPAData;
 
 static GPAData *
-gpa_data_new (gchar **ppds_names, gchar *attribute_name, GPACallback callback, gpointer user_data)
+gpa_data_new (gchar **ppds_names, gchar *attribute_name, GCancellable *cancellable)
 {
   GPAData *data;
 
   data = g_new0 (GPAData, 1);
   data->ppds_names = g_strdupv (ppds_names);
   data->attribute_name = g_strdup (attribute_name);
-  data->callback = callback;
-  data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
+  if (cancellable)
+    data->cancellable = g_object_ref (cancellable);
 
   return data;
 }
@@ -1656,49 +1931,25 @@ gpa_data_free (GPAData *data)
 {
   g_free (data->attribute_name);
   g_strfreev (data->ppds_names);
-  if (data->result != NULL)
-    g_strfreev (data->result);
-  if (data->context)
-    g_main_context_unref (data->context);
+  g_clear_object (&data->cancellable);
   g_free (data);
 }
 
-static gboolean
-get_ppds_attribute_idle_cb (gpointer user_data)
-{
-  GPAData *data = (GPAData *) user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
-static void
-get_ppds_attribute_cb (gpointer user_data)
-{
-  GPAData *data = (GPAData *) user_data;
-  g_autoptr(GSource) idle_source = NULL;
-
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_ppds_attribute_idle_cb,
-                         data,
-                         (GDestroyNotify) gpa_data_free);
-  g_source_attach (idle_source, data->context);
-}
-
 static gpointer
-get_ppds_attribute_func (gpointer user_data)
+get_ppds_attribute_func (IPPRequest *ipp_request,
+                         http_t     *http,
+                         gpointer    user_data)
 {
   ppd_file_t  *ppd_file;
   ppd_attr_t  *ppd_attr;
   GPAData     *data = user_data;
+  gchar      **result;
   gint         i;
 
-  data->result = g_new0 (gchar *, g_strv_length (data->ppds_names) + 1);
-  for (i = 0; data->ppds_names[i]; i++)
+  result = g_new0 (gchar *, g_strv_length (data->ppds_names) + 1);
+  for (i = 0; data->ppds_names[i] && !g_cancellable_is_cancelled (data->cancellable); i++)
     {
-      g_autofree gchar *ppd_filename = g_strdup (cupsGetServerPPD (CUPS_HTTP_DEFAULT, data->ppds_names[i]));
+      g_autofree gchar *ppd_filename = g_strdup (cupsGetServerPPD (http, data->ppds_names[i]));
       if (ppd_filename)
         {
           ppd_file = ppdOpenFile (ppd_filename);
@@ -1706,7 +1957,7 @@ get_ppds_attribute_func (gpointer user_data)
             {
               ppd_attr = ppdFindAttr (ppd_file, data->attribute_name, NULL);
               if (ppd_attr != NULL)
-                data->result[i] = g_strdup (ppd_attr->value);
+                result[i] = g_strdup (ppd_attr->value);
 
               ppdClose (ppd_file);
             }
@@ -1715,44 +1966,39 @@ get_ppds_attribute_func (gpointer user_data)
         }
     }
 
-  get_ppds_attribute_cb (data);
-
-  return NULL;
+  return result;
 }
 
+static const IPPRequestClass get_ppds_attribute_class = {
+  .run = get_ppds_attribute_func,
+  .free_result = (GDestroyNotify) g_strfreev,
+};
+
 /*
  * Get values of requested PPD attribute for given PPDs.
+ * The callback is always called, the cancellable just
+ * stops downloading of remaining PPDs.
  */
 static void
-get_ppds_attribute_async (gchar       **ppds_names,
-                          gchar        *attribute_name,
-                          GPACallback   callback,
-                          gpointer      user_data)
+get_ppds_attribute_async (gchar        **ppds_names,
+                          gchar         *attribute_name,
+                          GCancellable  *cancellable,
+                          GPACallback    callback,
+                          gpointer       user_data)
 {
-  GPAData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
-
   if (!ppds_names || !attribute_name)
     {
       callback (NULL, user_data);
       return;
     }
 
-  data = gpa_data_new (ppds_names, attribute_name, callback, user_data);
-
-  thread = g_thread_try_new ("get-ppds-attribute",
-                             get_ppds_attribute_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gpa_data_free (data);
-    }
+  ipp_request_start (&get_ppds_attribute_class,
+                     NULL,
+                     gpa_data_new (ppds_names, attribute_name, cancellable),
+                     (GDestroyNotify) gpa_data_free,
+                     NULL,
+                     (IPPRequestCallback) callback,
+                     user_data);
 }
 
 
@@ -1799,9 +2045,13 @@ gda_data_free (GDAData *data)
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (GDAData, gda_data_free)
 
+static gboolean ppd_index_get_display_names (PPDName **names);
+
 typedef struct
 {
   gchar         *printer_name;
+  gchar         *device_id;
+  gchar         *device_make_and_model;
   gint           count;
   PPDName      **result;
   GCancellable  *cancellable;
@@ -1829,6 +2079,8 @@ static void
 gpn_data_free (GPNData *data)
 {
   g_free (data->printer_name);
+  g_free (data->device_id);
+  g_free (data->device_make_and_model);
   if (data->result != NULL)
     {
       for (int i = 0; data->result[i]; i++)
@@ -1864,7 +2116,10 @@ get_ppd_names_async_cb (gchar    **attribute_values,
   if (attribute_values)
     {
       for (i = 0; attribute_values[i]; i++)
-        data->result[i]->ppd_display_name = g_strdup (attribute_values[i]);
+        {
+          g_free (data->result[i]->ppd_display_name);
+          data->result[i]->ppd_display_name = g_strdup (attribute_values[i]);
+        }
     }
 
   data->callback (data->result,
@@ -1955,18 +2210,48 @@ get_ppd_names_async_dbus_scb (GObject      *source_object,
         }
     }
 
+  /*
+   * Look the device up in the catalogue of installed PPDs
+   * if system-config-printer did not find any driver.
+   */
+  if (n == 0 && !g_cancellable_is_cancelled (data->cancellable))
+    {
+      data->result = get_indexed_ppd_names (data->device_id,
+                                            data->device_make_and_model,
+                                            data->count);
+      if (data->result != NULL)
+        {
+          data->callback (data->result,
+                          data->printer_name,
+                          FALSE,
+                          data->user_data);
+          return;
+        }
+    }
+
   if (result)
     {
       g_auto(GStrv) ppds_names = NULL;
 
       data->result = result;
 
+      /* Names of indexed PPDs do not need to be read from the PPD files */
+      if (ppd_index_get_display_names (result))
+        {
+          data->callback (data->result,
+                          data->printer_name,
+                          FALSE,
+                          data->user_data);
+          return;
+        }
+
       ppds_names = g_new0 (gchar *, n + 1);
       for (i = 0; i < n; i++)
         ppds_names[i] = g_strdup (result[i]->ppd_name);
 
       get_ppds_attribute_async (ppds_names,
                                 "NickName",
+                                data->cancellable,
                                 get_ppd_names_async_cb,
                                 data);
       g_steal_pointer (&data);
@@ -2008,6 +2293,9 @@ get_device_attributes_cb (gchar    *device_id,
       return;
     }
 
+  data->device_id = g_strdup (device_id);
+  data->device_make_and_model = g_strdup (device_make_and_model);
+
   bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (!bus)
     {
@@ -2326,8 +2614,10 @@ get_device_attributes_async (const gchar  *printer_name,
   attributes = g_new0 (gchar *, 2);
   attributes[0] = g_strdup ("device-uri");
 
+  /* Cancellation is handled by get_device_attributes_async_scb() */
   get_ipp_attributes_async (printer_name,
                             attributes,
+                            NULL,
                             get_device_attributes_async_scb,
                             gda_data_new (printer_name, cancellable, callback, user_data));
 }
@@ -2357,66 +2647,6 @@ get_ppd_names_async (gchar        *printer_name,
                                gpn_data_new (printer_name, count, cancellable, callback, user_data));
 }
 
-typedef struct
-{
-  PPDList      *result;
-  GCancellable *cancellable;
-  GAPCallback   callback;
-  gpointer      user_data;
-  GMainContext *context;
-} GAPData;
-
-static GAPData *
-gap_data_new (GCancellable *cancellable, GAPCallback callback, gpointer user_data)
-{
-  GAPData *data;
-
-  data = g_new0 (GAPData, 1);
-  if (cancellable)
-    data->cancellable = g_object_ref (cancellable);
-  data->callback = callback;
-  data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
-
-  return data;
-}
-
-static void
-gap_data_free (GAPData *data)
-{
-  if (data->result != NULL)
-    ppd_list_free (data->result);
-  g_clear_object (&data->cancellable);
-  if (data->context)
-    g_main_context_unref (data->context);
-  g_free (data);
-}
-
-static gboolean
-get_all_ppds_idle_cb (gpointer user_data)
-{
-  GAPData *data = user_data;
-
-  if (!g_cancellable_is_cancelled (data->cancellable))
-    data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
-static void
-get_all_ppds_cb (gpointer user_data)
-{
-  GAPData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
-
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_all_ppds_idle_cb,
-                         data,
-                         (GDestroyNotify) gap_data_free);
-  g_source_attach (idle_source, data->context);
-}
-
 static const struct {
   const char *normalized_name;
   const char *display_name;
@@ -2493,40 +2723,771 @@ static const struct {
   { "zebra", "Zebra" },
 };
 
-static gpointer
-get_all_ppds_func (gpointer user_data)
-{
-  ipp_attribute_t *attr;
-  GHashTable      *ppds_hash = NULL;
-  GHashTable      *manufacturers_hash = NULL;
-  GAPData         *data = user_data;
-  PPDName         *item;
-  ipp_t           *request;
-  ipp_t           *response;
-  GList           *list;
-  gchar           *manufacturer_display_name;
-  gint             i, j;
-
-  request = ippNewRequest (CUPS_GET_PPDS);
-  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+static GHashTable *
+get_manufacturers_names_table (void)
+{
+  static GHashTable *table = NULL;
 
-  if (response &&
-      ippGetStatusCode (response) <= IPP_OK_CONFLICT)
+  if (g_once_init_enter (&table))
     {
-      /*
-       * This hash contains names of manufacturers as keys and
-       * values are GLists of PPD names.
-       */
-      ppds_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      GHashTable *names;
+      gint        i;
 
-      /*
-       * This hash contains all possible names of manufacturers as keys
-       * and values are just first occurrences of their equivalents.
+      names = g_hash_table_new (g_str_hash, g_str_equal);
+      for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+        g_hash_table_insert (names,
+                             (gpointer) manufacturers_names[i].normalized_name,
+                             (gpointer) manufacturers_names[i].display_name);
+
+      g_once_init_leave (&table, names);
+    }
+
+  return table;
+}
+
+/*
+ * Return the name under which PPDs of given normalized manufacturer
+ * are grouped, so that e.g. "hp" and "hewlett packard" share one key.
+ */
+static gchar *
+get_manufacturer_key (const gchar *mfg_normalized)
+{
+  const gchar *display_name;
+
+  display_name = g_hash_table_lookup (get_manufacturers_names_table (), mfg_normalized);
+  if (display_name != NULL)
+    return normalize (display_name);
+
+  return g_strdup (mfg_normalized);
+}
+
+/*
+ * Guess manufacturer from the leading words of make-and-model string
+ * when the device did not report it separately.
+ */
+static gchar *
+guess_manufacturer_key (const gchar *make_and_model)
+{
+  g_autofree gchar *normalized = NULL;
+  gchar            *p;
+  gint              words = 0;
+
+  normalized = g_strstrip (normalize (make_and_model));
+  for (p = normalized; *p != '\0' && words < 3; p++)
+    {
+      if (*p == ' ')
+        {
+          g_autofree gchar *prefix = g_strndup (normalized, p - normalized);
+
+          if (g_hash_table_contains (get_manufacturers_names_table (), prefix))
+            return get_manufacturer_key (prefix);
+
+          words++;
+        }
+    }
+
+  p = strchr (normalized, ' ');
+  if (p != NULL)
+    *p = '\0';
+
+  return get_manufacturer_key (normalized);
+}
+
+static const gchar * const ppd_driver_descriptions[] = {
+  ",",
+  " (",
+  " - ",
+  " foomatic/",
+  " cups+",
+  " hpijs",
+  " hpcups",
+  " postscript",
+  " br-script",
+  " gutenprint",
+};
+
+/*
+ * Reduce make-and-model string of a PPD or of a device to the model
+ * alone, without manufacturer and driver description, e.g.
+ * "HP LaserJet 4250 Foomatic/ljet4 (recommended)" -> "laserjet 4250".
+ */
+static gchar *
+get_model_key (const gchar *manufacturer_key,
+               const gchar *make_and_model)
+{
+  g_autofree gchar *model = NULL;
+  g_autofree gchar *normalized = NULL;
+  const gchar      *model_start;
+  gchar            *p;
+  gint              i, words = 0;
+
+  model = g_ascii_strdown (make_and_model, -1);
+  for (i = 0; i < G_N_ELEMENTS (ppd_driver_descriptions); i++)
+    {
+      p = strstr (model, ppd_driver_descriptions[i]);
+      if (p != NULL && p != model)
+        *p = '\0';
+    }
+
+  normalized = g_strstrip (normalize (model));
+  model_start = normalized;
+
+  /* Strip up to three leading words naming the manufacturer */
+  for (p = normalized; *p != '\0' && words < 3; p++)
+    {
+      if (*p == ' ')
+        {
+          g_autofree gchar *prefix = g_strndup (normalized, p - normalized);
+          g_autofree gchar *prefix_key = get_manufacturer_key (prefix);
+
+          if (g_str_equal (prefix_key, manufacturer_key))
+            model_start = p + 1;
+
+          words++;
+        }
+    }
+
+  if (model_start == normalized && g_str_equal (normalized, manufacturer_key))
+    model_start = "";
+
+  return g_strdup (model_start);
+}
+
+/*
+ * Set of trigrams of given model, each packed into an integer.
+ */
+static GHashTable *
+get_model_trigrams (const gchar *model)
+{
+  g_autofree gchar *padded = NULL;
+  GHashTable       *trigrams;
+  gsize             i, length;
+
+  padded = g_strdup_printf (" %s ", model);
+  length = strlen (padded);
+
+  trigrams = g_hash_table_new (NULL, NULL);
+  for (i = 0; i + 2 < length; i++)
+    g_hash_table_add (trigrams,
+                      GUINT_TO_POINTER (((guint) (guchar) padded[i] << 16) |
+                                        ((guint) (guchar) padded[i + 1] << 8) |
+                                        (guint) (guchar) padded[i + 2]));
+
+  return trigrams;
+}
+
+/*
+ * Index over the catalogue of installed PPDs which is built each time
+ * the catalogue is loaded. It allows to suggest drivers for a device by
+ * looking up its normalized manufacturer and model instead of comparing
+ * it against every PPD. Models which do not match exactly are found
+ * through their trigrams.
+ */
+#define PPD_INDEX_MIN_SIMILARITY 0.7
+
+typedef struct
+{
+  gchar *ppd_name;
+  gchar *ppd_display_name;
+  gchar *manufacturer;
+  gchar *model;
+  guint  num_of_trigrams;
+} PPDIndexEntry;
+
+typedef struct
+{
+  GPtrArray  *entries;
+  GHashTable *names;
+  GHashTable *models;
+  GHashTable *trigrams;
+} PPDIndex;
+
+typedef struct
+{
+  PPDIndexEntry *entry;
+  gdouble        similarity;
+} PPDIndexMatch;
+
+G_LOCK_DEFINE_STATIC (ppd_index);
+static PPDIndex *ppd_index = NULL;
+
+static void
+ppd_index_entry_free (PPDIndexEntry *entry)
+{
+  g_free (entry->ppd_name);
+  g_free (entry->ppd_display_name);
+  g_free (entry->manufacturer);
+  g_free (entry->model);
+  g_free (entry);
+}
+
+static void
+ppd_index_free (PPDIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_hash_table_unref (index->trigrams);
+  g_hash_table_unref (index->models);
+  g_hash_table_unref (index->names);
+  g_ptr_array_unref (index->entries);
+  g_free (index);
+}
+
+static void
+ppd_index_add_trigram (PPDIndex      *index,
+                       gpointer       trigram,
+                       PPDIndexEntry *entry)
+{
+  GPtrArray *entries;
+
+  entries = g_hash_table_lookup (index->trigrams, trigram);
+  if (entries == NULL)
+    {
+      entries = g_ptr_array_new ();
+      g_hash_table_insert (index->trigrams, trigram, entries);
+    }
+
+  g_ptr_array_add (entries, entry);
+}
+
+static PPDIndex *
+ppd_index_new (PPDList *list)
+{
+  PPDIndex *index;
+  gsize     i, j;
+
+  index = g_new0 (PPDIndex, 1);
+  index->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) ppd_index_entry_free);
+  index->names = g_hash_table_new (g_str_hash, g_str_equal);
+  index->models = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+  index->trigrams = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *item = list->manufacturers[i];
+
+      for (j = 0; j < item->num_of_ppds; j++)
+        {
+          g_autoptr(GHashTable) trigrams = NULL;
+          PPDIndexEntry        *entry;
+          GPtrArray            *entries;
+          GHashTableIter        iter;
+          gpointer              trigram;
+          gchar                *key;
+
+          entry = g_new0 (PPDIndexEntry, 1);
+          entry->ppd_name = g_strdup (item->ppds[j]->ppd_name);
+          entry->ppd_display_name = g_strdup (item->ppds[j]->ppd_display_name);
+          entry->manufacturer = g_strdup (item->manufacturer_name);
+          entry->model = get_model_key (item->manufacturer_name, item->ppds[j]->ppd_display_name);
+          g_ptr_array_add (index->entries, entry);
+
+          g_hash_table_insert (index->names, entry->ppd_name, entry);
+
+          if (entry->model[0] == '\0')
+            continue;
+
+          key = g_strconcat (entry->manufacturer, "\t", entry->model, NULL);
+          entries = g_hash_table_lookup (index->models, key);
+          if (entries == NULL)
+            {
+              entries = g_ptr_array_new ();
+              g_hash_table_insert (index->models, key, entries);
+            }
+          else
+            {
+              g_free (key);
+            }
+          g_ptr_array_add (entries, entry);
+
+          trigrams = get_model_trigrams (entry->model);
+          entry->num_of_trigrams = g_hash_table_size (trigrams);
+
+          g_hash_table_iter_init (&iter, trigrams);
+          while (g_hash_table_iter_next (&iter, &trigram, NULL))
+            ppd_index_add_trigram (index, trigram, entry);
+        }
+    }
+
+  return index;
+}
+
+static void
+ppd_index_update (PPDList *list)
+{
+  PPDIndex *old_index;
+  PPDIndex *index;
+
+  index = ppd_index_new (list);
+
+  G_LOCK (ppd_index);
+  old_index = ppd_index;
+  ppd_index = index;
+  G_UNLOCK (ppd_index);
+
+  ppd_index_free (old_index);
+}
+
+/*
+ * Fill in display names of given PPDs from the index.
+ * Returns FALSE and leaves the names untouched if some
+ * of them is not indexed.
+ */
+static gboolean
+ppd_index_get_display_names (PPDName **names)
+{
+  gboolean found = FALSE;
+  gint     i;
+
+  G_LOCK (ppd_index);
+
+  if (ppd_index != NULL)
+    {
+      found = TRUE;
+      for (i = 0; names[i] != NULL && found; i++)
+        found = g_hash_table_contains (ppd_index->names, names[i]->ppd_name);
+
+      for (i = 0; names[i] != NULL && found; i++)
+        {
+          PPDIndexEntry *entry;
+
+          entry = g_hash_table_lookup (ppd_index->names, names[i]->ppd_name);
+          g_free (names[i]->ppd_display_name);
+          names[i]->ppd_display_name = g_strdup (entry->ppd_display_name);
+        }
+    }
+
+  G_UNLOCK (ppd_index);
+
+  return found;
+}
+
+static gint
+ppd_index_match_compare (gconstpointer a,
+                         gconstpointer b)
+{
+  const PPDIndexMatch *match_a = a;
+  const PPDIndexMatch *match_b = b;
+
+  if (match_a->similarity > match_b->similarity)
+    return -1;
+  else if (match_a->similarity < match_b->similarity)
+    return 1;
+
+  return g_strcmp0 (match_a->entry->ppd_name, match_b->entry->ppd_name);
+}
+
+static void
+add_indexed_ppd_name (GPtrArray     *result,
+                      PPDIndexEntry *entry,
+                      gint           match_level)
+{
+  PPDName *ppd_item;
+
+  ppd_item = g_new0 (PPDName, 1);
+  ppd_item->ppd_name = g_strdup (entry->ppd_name);
+  ppd_item->ppd_display_name = g_strdup (entry->ppd_display_name);
+  ppd_item->ppd_match_level = match_level;
+
+  g_ptr_array_add (result, ppd_item);
+}
+
+/*
+ * Return up to "count" PPDs from the catalogue of installed PPDs
+ * matching given device. Models matching exactly come first,
+ * the rest is ordered by similarity of the model name.
+ * The catalogue has to be loaded by get_all_ppds_async() first.
+ */
+PPDName **
+get_indexed_ppd_names (const gchar *device_id,
+                       const gchar *device_make_and_model,
+                       gint         count)
+{
+  g_autoptr(GHashTable) trigrams = NULL;
+  g_autoptr(GHashTable) shared_trigrams = NULL;
+  g_autoptr(GHashTable) exact_entries = NULL;
+  g_autoptr(GArray)     matches = NULL;
+  g_autofree gchar     *manufacturer = NULL;
+  g_autofree gchar     *model = NULL;
+  g_autofree gchar     *key = NULL;
+  g_autofree gchar     *mfg = NULL;
+  g_autofree gchar     *mdl = NULL;
+  GHashTableIter        iter;
+  GPtrArray            *entries;
+  GPtrArray            *result;
+  gpointer              trigram, entry, value;
+  guint                 i;
+
+  if (device_id != NULL && device_id[0] != '\0')
+    {
+      mfg = get_tag_value (device_id, "mfg");
+      if (mfg == NULL)
+        mfg = get_tag_value (device_id, "manufacturer");
+
+      mdl = get_tag_value (device_id, "mdl");
+      if (mdl == NULL)
+        mdl = get_tag_value (device_id, "model");
+    }
+
+  if (mdl == NULL && device_make_and_model != NULL && device_make_and_model[0] != '\0')
+    mdl = g_strdup (device_make_and_model);
+
+  if (mdl == NULL || count <= 0)
+    return NULL;
+
+  if (mfg != NULL)
+    {
+      g_autofree gchar *mfg_normalized = g_strstrip (normalize (mfg));
+
+      manufacturer = get_manufacturer_key (mfg_normalized);
+    }
+  else
+    {
+      manufacturer = guess_manufacturer_key (mdl);
+    }
+
+  model = get_model_key (manufacturer, mdl);
+  if (model[0] == '\0')
+    return NULL;
+
+  key = g_strconcat (manufacturer, "\t", model, NULL);
+  result = g_ptr_array_new ();
+  exact_entries = g_hash_table_new (NULL, NULL);
+
+  G_LOCK (ppd_index);
+
+  if (ppd_index == NULL)
+    {
+      G_UNLOCK (ppd_index);
+      g_ptr_array_free (result, TRUE);
+      return NULL;
+    }
+
+  entries = g_hash_table_lookup (ppd_index->models, key);
+  for (i = 0; entries != NULL && i < entries->len && result->len < count; i++)
+    {
+      add_indexed_ppd_name (result, g_ptr_array_index (entries, i), PPD_EXACT_MATCH);
+      g_hash_table_add (exact_entries, g_ptr_array_index (entries, i));
+    }
+
+  if (result->len < count)
+    {
+      trigrams = get_model_trigrams (model);
+      shared_trigrams = g_hash_table_new (NULL, NULL);
+
+      g_hash_table_iter_init (&iter, trigrams);
+      while (g_hash_table_iter_next (&iter, &trigram, NULL))
+        {
+          entries = g_hash_table_lookup (ppd_index->trigrams, trigram);
+          for (i = 0; entries != NULL && i < entries->len; i++)
+            {
+              PPDIndexEntry *candidate = g_ptr_array_index (entries, i);
+
+              if (!g_str_equal (candidate->manufacturer, manufacturer) ||
+                  g_hash_table_contains (exact_entries, candidate))
+                continue;
+
+              value = g_hash_table_lookup (shared_trigrams, candidate);
+              g_hash_table_insert (shared_trigrams, candidate, GUINT_TO_POINTER (GPOINTER_TO_UINT (value) + 1));
+            }
+        }
+
+      matches = g_array_new (FALSE, FALSE, sizeof (PPDIndexMatch));
+
+      g_hash_table_iter_init (&iter, shared_trigrams);
+      while (g_hash_table_iter_next (&iter, &entry, &value))
+        {
+          PPDIndexMatch match;
+
+          match.entry = entry;
+          match.similarity = 2.0 * GPOINTER_TO_UINT (value) /
+                             (g_hash_table_size (trigrams) + match.entry->num_of_trigrams);
+
+          if (match.similarity >= PPD_INDEX_MIN_SIMILARITY)
+            g_array_append_val (matches, match);
+        }
+
+      g_array_sort (matches, ppd_index_match_compare);
+
+      for (i = 0; i < matches->len && result->len < count; i++)
+        add_indexed_ppd_name (result, g_array_index (matches, PPDIndexMatch, i).entry, PPD_CLOSE_MATCH);
+    }
+
+  G_UNLOCK (ppd_index);
+
+  if (result->len == 0)
+    {
+      g_ptr_array_free (result, TRUE);
+      return NULL;
+    }
+
+  g_ptr_array_add (result, NULL);
+
+  return (PPDName **) g_ptr_array_free (result, FALSE);
+}
+
+/*
+ * The catalogue of installed PPDs is kept in a cache file so that
+ * the whole CUPS_GET_PPDS request does not have to be repeated
+ * each time the panel is opened. The cache is validated against
+ * the state of the local driver directories.
+ */
+#define PPD_CACHE_VERSION 1
+#define PPD_CACHE_TYPE    "(usa(ssa(ss)))"
+
+static const gchar *
+get_cups_dir (const gchar *variable,
+              const gchar *default_dir)
+{
+  const gchar *dir = g_getenv (variable);
+
+  return dir != NULL ? dir : default_dir;
+}
+
+/* Deep enough for the per-vendor and per-model subdirectories,
+ * the limit also stops symbolic link loops */
+#define PPD_CACHE_STAMP_MAX_DEPTH 8
+
+static void
+add_dir_to_ppd_cache_stamp (const gchar *path,
+                            guint        depth,
+                            gint64      *newest,
+                            guint       *n_entries)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar    *name;
+  GStatBuf        buf;
+
+  if (g_stat (path, &buf) != 0)
+    return;
+
+  *newest = MAX (*newest, (gint64) buf.st_mtime);
+
+  if (!S_ISDIR (buf.st_mode) || depth >= PPD_CACHE_STAMP_MAX_DEPTH)
+    return;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  /* Every PPD file and driver program counts, wherever it is installed */
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *child = g_build_filename (path, name, NULL);
+
+      (*n_entries)++;
+      add_dir_to_ppd_cache_stamp (child, depth + 1, newest, n_entries);
+    }
+}
+
+/*
+ * Describes the state of the local driver directories, including
+ * the driver programs listing PPDs dynamically, or returns NULL
+ * if the CUPS server is remote and its drivers can not be checked.
+ */
+static gchar *
+get_ppd_cache_stamp (void)
+{
+  g_autofree gchar *datadir_model = NULL;
+  g_autofree gchar *datadir_drv = NULL;
+  g_autofree gchar *serverbin_driver = NULL;
+  g_autofree gchar *driverd_cache = NULL;
+  const gchar      *server;
+  const gchar      *dirs[7];
+  GStatBuf          buf;
+  gint64            newest = 0;
+  guint             n_entries = 0;
+  gint              i;
+
+  server = cupsServer ();
+  if (server == NULL ||
+      (server[0] != '/' &&
+       g_strcmp0 (server, "localhost") != 0 &&
+       !g_str_has_prefix (server, "localhost:")))
+    return NULL;
+
+  datadir_model = g_build_filename (get_cups_dir ("CUPS_DATADIR", "/usr/share/cups"), "model", NULL);
+  datadir_drv = g_build_filename (get_cups_dir ("CUPS_DATADIR", "/usr/share/cups"), "drv", NULL);
+  serverbin_driver = g_build_filename (get_cups_dir ("CUPS_SERVERBIN", "/usr/lib/cups"), "driver", NULL);
+
+  dirs[0] = datadir_model;
+  dirs[1] = datadir_drv;
+  dirs[2] = serverbin_driver;
+  dirs[3] = "/usr/share/ppd";
+  dirs[4] = "/usr/local/share/ppd";
+  dirs[5] = "/opt/share/ppd";
+  /* Database of the foomatic driver program */
+  dirs[6] = "/usr/share/foomatic/db/source";
+
+  for (i = 0; i < G_N_ELEMENTS (dirs); i++)
+    add_dir_to_ppd_cache_stamp (dirs[i], 0, &newest, &n_entries);
+
+  /* cups-driverd's own cache */
+  driverd_cache = g_build_filename (get_cups_dir ("CUPS_CACHEDIR", "/var/cache/cups"), "ppds.dat", NULL);
+  if (g_stat (driverd_cache, &buf) == 0)
+    newest = MAX (newest, (gint64) buf.st_mtime);
+
+  return g_strdup_printf ("%s:%" G_GINT64_FORMAT ":%u", server, newest, n_entries);
+}
+
+static gchar *
+get_ppd_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "ppds.cache", NULL);
+}
+
+static PPDList *
+ppd_list_load_cache (const gchar *stamp)
+{
+  g_autoptr(GMappedFile) mapped_file = NULL;
+  g_autoptr(GVariantIter) manufacturers_iter = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autofree gchar *path = NULL;
+  const gchar *cache_stamp;
+  PPDList     *result;
+  GVariant    *manufacturer;
+  guint32      version;
+  gsize        i = 0;
+
+  path = get_ppd_cache_path ();
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PPD_CACHE_TYPE), bytes, FALSE));
+
+  g_variant_get (cache, "(u&sa(ssa(ss)))", &version, &cache_stamp, &manufacturers_iter);
+  if (version != PPD_CACHE_VERSION || g_strcmp0 (cache_stamp, stamp) != 0)
+    return NULL;
+
+  result = g_new0 (PPDList, 1);
+  result->num_of_manufacturers = g_variant_iter_n_children (manufacturers_iter);
+  result->manufacturers = g_new0 (PPDManufacturerItem *, result->num_of_manufacturers);
+
+  while ((manufacturer = g_variant_iter_next_value (manufacturers_iter)) != NULL)
+    {
+      g_autoptr(GVariantIter) ppds_iter = NULL;
+      PPDManufacturerItem *item;
+      const gchar *ppd_name;
+      const gchar *ppd_display_name;
+      gsize j = 0;
+
+      item = g_new0 (PPDManufacturerItem, 1);
+      g_variant_get (manufacturer, "(ssa(ss))",
+                     &item->manufacturer_name,
+                     &item->manufacturer_display_name,
+                     &ppds_iter);
+
+      item->num_of_ppds = g_variant_iter_n_children (ppds_iter);
+      item->ppds = g_new0 (PPDName *, item->num_of_ppds);
+      while (g_variant_iter_next (ppds_iter, "(&s&s)", &ppd_name, &ppd_display_name))
+        {
+          item->ppds[j] = g_new0 (PPDName, 1);
+          item->ppds[j]->ppd_name = g_strdup (ppd_name);
+          item->ppds[j]->ppd_display_name = g_strdup (ppd_display_name);
+          item->ppds[j]->ppd_match_level = -1;
+          j++;
+        }
+
+      result->manufacturers[i++] = item;
+      g_variant_unref (manufacturer);
+    }
+
+  return result;
+}
+
+static void
+ppd_list_save_cache (PPDList     *list,
+                     const gchar *stamp)
+{
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GError)   error = NULL;
+  g_autofree gchar   *path = NULL;
+  g_autofree gchar   *dir = NULL;
+  GVariantBuilder     builder;
+  gsize               i, j;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssa(ss))"));
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *item = list->manufacturers[i];
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("(ssa(ss))"));
+      g_variant_builder_add (&builder, "s", item->manufacturer_name);
+      g_variant_builder_add (&builder, "s", item->manufacturer_display_name);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+      for (j = 0; j < item->num_of_ppds; j++)
+        g_variant_builder_add (&builder, "(ss)", item->ppds[j]->ppd_name, item->ppds[j]->ppd_display_name);
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
+
+  cache = g_variant_ref_sink (g_variant_new ("(usa(ssa(ss)))", PPD_CACHE_VERSION, stamp, &builder));
+
+  path = get_ppd_cache_path ();
+  dir = g_path_get_dirname (path);
+  if (g_mkdir_with_parents (dir, 0700) != 0 ||
+      !g_file_set_contents (path, g_variant_get_data (cache), g_variant_get_size (cache), &error))
+    g_debug ("Could not write PPD cache %s: %s", path, error != NULL ? error->message : g_strerror (errno));
+}
+
+static gpointer
+get_all_ppds_func (IPPRequest *ipp_request,
+                   http_t     *http,
+                   gpointer    user_data)
+{
+  ipp_attribute_t  *attr;
+  GHashTable       *ppds_hash = NULL;
+  GHashTable       *manufacturers_hash = NULL;
+  GHashTable       *manufacturers_keys = NULL;
+  PPDList          *result = NULL;
+  PPDName          *item;
+  ipp_t            *request;
+  ipp_t            *response;
+  GList            *list;
+  gchar            *manufacturer_key;
+  g_autofree gchar *stamp = NULL;
+  gint              i, j;
+
+  stamp = get_ppd_cache_stamp ();
+  if (stamp != NULL)
+    result = ppd_list_load_cache (stamp);
+
+  if (result != NULL)
+    {
+      ppd_index_update (result);
+      return result;
+    }
+
+  request = ippNewRequest (CUPS_GET_PPDS);
+  response = cupsDoRequest (http, request, "/");
+
+  if (response &&
+      ippGetStatusCode (response) <= IPP_OK_CONFLICT)
+    {
+      /*
+       * This hash contains names of manufacturers as keys and
+       * values are GLists of PPD names.
+       */
+      ppds_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+      /*
+       * This hash contains all possible names of manufacturers as keys
+       * and values are just first occurrences of their equivalents.
        * This is for mapping of e.g. "Hewlett Packard" and "HP" to the same name
        * (the one which comes first).
        */
       manufacturers_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
+      /*
+       * Normalized names of manufacturers mapped to keys of
+       * the two hashes above so that each name is resolved only once.
+       */
+      manufacturers_keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
       for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
         {
           g_hash_table_insert (manufacturers_hash,
@@ -2616,15 +3577,14 @@ get_all_ppds_func (gpointer user_data)
               mdl && mdl[0] != '\0' &&
               mfg && mfg[0] != '\0')
             {
-              manufacturer_display_name = g_hash_table_lookup (manufacturers_hash, mfg_normalized);
-              if (!manufacturer_display_name)
-                {
-                  g_hash_table_insert (manufacturers_hash, g_strdup (mfg_normalized), g_strdup (mfg));
-                }
-              else
+              manufacturer_key = g_hash_table_lookup (manufacturers_keys, mfg_normalized);
+              if (!manufacturer_key)
                 {
-                  g_free (mfg_normalized);
-                  mfg_normalized = normalize (manufacturer_display_name);
+                  manufacturer_key = get_manufacturer_key (mfg_normalized);
+                  g_hash_table_insert (manufacturers_keys, g_strdup (mfg_normalized), manufacturer_key);
+
+                  if (!g_hash_table_contains (manufacturers_hash, manufacturer_key))
+                    g_hash_table_insert (manufacturers_hash, g_strdup (manufacturer_key), g_strdup (mfg));
                 }
 
               item = g_new0 (PPDName, 1);
@@ -2632,7 +3592,7 @@ get_all_ppds_func (gpointer user_data)
               item->ppd_display_name = g_strdup (mdl);
               item->ppd_match_level = -1;
 
-              list = g_hash_table_lookup (ppds_hash, mfg_normalized);
+              list = g_hash_table_lookup (ppds_hash, manufacturer_key);
               if (list)
                 {
                   list = g_list_append (list, item);
@@ -2640,7 +3600,7 @@ get_all_ppds_func (gpointer user_data)
               else
                 {
                   list = g_list_append (list, item);
-                  g_hash_table_insert (ppds_hash, g_strdup (mfg_normalized), list);
+                  g_hash_table_insert (ppds_hash, g_strdup (manufacturer_key), list);
                 }
             }
 
@@ -2663,9 +3623,9 @@ get_all_ppds_func (gpointer user_data)
       GList          *list_iter;
       gchar          *name;
 
-      data->result = g_new0 (PPDList, 1);
-      data->result->num_of_manufacturers = g_hash_table_size (ppds_hash);
-      data->result->manufacturers = g_new0 (PPDManufacturerItem *, data->result->num_of_manufacturers);
+      result = g_new0 (PPDList, 1);
+      result->num_of_manufacturers = g_hash_table_size (ppds_hash);
+      result->manufacturers = g_new0 (PPDManufacturerItem *, result->num_of_manufacturers);
 
       g_hash_table_iter_init (&iter, ppds_hash);
       while (g_hash_table_iter_next (&iter, &key, &value))
@@ -2686,15 +3646,15 @@ get_all_ppds_func (gpointer user_data)
           name = (gchar *) list_iter->data;
           value = g_hash_table_lookup (ppds_hash, name);
 
-          data->result->manufacturers[i] = g_new0 (PPDManufacturerItem, 1);
-          data->result->manufacturers[i]->manufacturer_name = g_strdup (name);
-          data->result->manufacturers[i]->manufacturer_display_name = g_strdup (g_hash_table_lookup (manufacturers_hash, name));
-          data->result->manufacturers[i]->num_of_ppds = g_list_length ((GList *) value);
-          data->result->manufacturers[i]->ppds = g_new0 (PPDName *, data->result->manufacturers[i]->num_of_ppds);
+          result->manufacturers[i] = g_new0 (PPDManufacturerItem, 1);
+          result->manufacturers[i]->manufacturer_name = g_strdup (name);
+          result->manufacturers[i]->manufacturer_display_name = g_strdup (g_hash_table_lookup (manufacturers_hash, name));
+          result->manufacturers[i]->num_of_ppds = g_list_length ((GList *) value);
+          result->manufacturers[i]->ppds = g_new0 (PPDName *, result->manufacturers[i]->num_of_ppds);
 
           for (ppd_item = (GList *) value, j = 0; ppd_item; ppd_item = ppd_item->next, j++)
             {
-              data->result->manufacturers[i]->ppds[j] = ppd_item->data;
+              result->manufacturers[i]->ppds[j] = ppd_item->data;
             }
 
           g_list_free ((GList *) value);
@@ -2705,13 +3665,23 @@ get_all_ppds_func (gpointer user_data)
       g_list_free_full (sort_list, g_free);
       g_hash_table_destroy (ppds_hash);
       g_hash_table_destroy (manufacturers_hash);
-    }
+      g_hash_table_destroy (manufacturers_keys);
 
-  get_all_ppds_cb (data);
+      if (stamp != NULL)
+        ppd_list_save_cache (result, stamp);
 
-  return NULL;
+      ppd_index_update (result);
+    }
+
+  return result;
 }
 
+static const IPPRequestClass get_all_ppds_class = {
+  .run = get_all_ppds_func,
+  .copy_result = (GBoxedCopyFunc) ppd_list_copy,
+  .free_result = (GDestroyNotify) ppd_list_free,
+};
+
 /*
  * Get names of all installed PPDs sorted by manufacturers names.
  */
@@ -2720,24 +3690,13 @@ get_all_ppds_async (GCancellable *cancellable,
                     GAPCallback   callback,
                     gpointer      user_data)
 {
-  GAPData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError)  error = NULL;
-
-  data = gap_data_new (cancellable, callback, user_data);
-
-  thread = g_thread_try_new ("get-all-ppds",
-                             get_all_ppds_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gap_data_free (data);
-    }
+  ipp_request_start (&get_all_ppds_class,
+                     "get-all-ppds",
+                     NULL,
+                     NULL,
+                     cancellable,
+                     (IPPRequestCallback) callback,
+                     user_data);
 }
 
 PPDList *
@@ -2814,37 +3773,24 @@ gchar *
 get_standard_manufacturers_name (const gchar *name)
 {
   g_autofree gchar *normalized_name = NULL;
-  gint   i;
 
   if (name == NULL)
     return NULL;
 
   normalized_name = normalize (name);
 
-  for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
-    {
-      if (g_strcmp0 (manufacturers_names[i].normalized_name, normalized_name) == 0)
-        {
-          return g_strdup (manufacturers_names[i].display_name);
-        }
-    }
-
-  return NULL;
+  return g_strdup (g_hash_table_lookup (get_manufacturers_names_table (), normalized_name));
 }
 
 typedef struct
 {
-  gchar        *printer_name;
-  gchar        *host_name;
-  gint          port;
-  gchar        *result;
-  PGPCallback   callback;
-  gpointer      user_data;
-  GMainContext *context;
+  gchar *printer_name;
+  gchar *host_name;
+  gint   port;
 } PGPData;
 
 static PGPData *
-pgp_data_new (const gchar *printer_name, const gchar *host_name, gint port, PGPCallback callback, gpointer user_data)
+pgp_data_new (const gchar *printer_name, const gchar *host_name, gint port)
 {
   PGPData *data;
 
@@ -2852,9 +3798,6 @@ pgp_data_new (const gchar *printer_name, const gchar *host_name, gint port, PGPC
   data->printer_name = g_strdup (printer_name);
   data->host_name = g_strdup (host_name);
   data->port = port;
-  data->callback = callback;
-  data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
   return data;
 }
@@ -2864,185 +3807,132 @@ pgp_data_free (PGPData *data)
 {
   g_free (data->printer_name);
   g_free (data->host_name);
-  g_free (data->result);
-  if (data->context)
-    g_main_context_unref (data->context);
   g_free (data);
 }
 
-static gboolean
-printer_get_ppd_idle_cb (gpointer user_data)
-{
-  PGPData *data = user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
-static void
-printer_get_ppd_cb (gpointer user_data)
-{
-  PGPData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
-
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         printer_get_ppd_idle_cb,
-                         data,
-                         (GDestroyNotify) pgp_data_free);
-  g_source_attach (idle_source, data->context);
-}
-
 static gpointer
-printer_get_ppd_func (gpointer user_data)
+printer_get_ppd_func (IPPRequest *ipp_request,
+                      http_t     *http,
+                      gpointer    user_data)
 {
   PGPData *data = user_data;
+  gchar   *result = NULL;
 
   if (data->host_name)
     {
-      http_t *http;
+      http_t *remote_http;
 
 #ifdef HAVE_CUPS_HTTPCONNECT2
-      http = httpConnect2 (data->host_name, data->port, NULL, AF_UNSPEC,
-                           HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, NULL);
+      remote_http = httpConnect2 (data->host_name, data->port, NULL, AF_UNSPEC,
+                                  HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, NULL);
 #else
-      http = httpConnect (data->host_name, data->port);
+      remote_http = httpConnect (data->host_name, data->port);
 #endif
-      if (http)
+      if (remote_http)
         {
-          data->result = g_strdup (cupsGetPPD2 (http, data->printer_name));
-          httpClose (http);
+          result = g_strdup (cupsGetPPD2 (remote_http, data->printer_name));
+          httpClose (remote_http);
         }
     }
   else
     {
-      data->result = g_strdup (cupsGetPPD (data->printer_name));
+      result = g_strdup (cupsGetPPD2 (http, data->printer_name));
     }
 
-  printer_get_ppd_cb (data);
-
-  return NULL;
-}
-
-void
-printer_get_ppd_async (const gchar *printer_name,
-                       const gchar *host_name,
-                       gint         port,
-                       PGPCallback  callback,
-                       gpointer     user_data)
-{
-  PGPData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
-
-  data = pgp_data_new (printer_name, host_name, port, callback, user_data);
-
-  thread = g_thread_try_new ("printer-get-ppd",
-                             printer_get_ppd_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      pgp_data_free (data);
-    }
-}
-
-typedef struct
-{
-  gchar        *printer_name;
-  cups_dest_t  *result;
-  GNDCallback   callback;
-  gpointer      user_data;
-  GMainContext *context;
-} GNDData;
-
-static GNDData *
-gnd_data_new (const gchar *printer_name, GNDCallback callback, gpointer user_data)
-{
-  GNDData *data;
-
-  data = g_new0 (GNDData, 1);
-  data->printer_name = g_strdup (printer_name);
-  data->callback = callback;
-  data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
-
-  return data;
+  return result;
 }
 
 static void
-gnd_data_free (GNDData *data)
+discard_ppd_file (gchar *ppd_filename)
 {
-  g_free (data->printer_name);
-  if (data->context)
-    g_main_context_unref (data->context);
-  g_free (data);
+  g_unlink (ppd_filename);
+  g_free (ppd_filename);
 }
 
-static gboolean
-get_named_dest_idle_cb (gpointer user_data)
-{
-  GNDData *data = user_data;
-
-  data->callback (data->result, data->user_data);
+/* Each caller gets its own copy of the PPD file so these are not shared */
+static const IPPRequestClass printer_get_ppd_class = {
+  .run = printer_get_ppd_func,
+  .free_result = g_free,
+  .discard_result = (GDestroyNotify) discard_ppd_file,
+};
 
-  return FALSE;
+void
+printer_get_ppd_async (const gchar  *printer_name,
+                       const gchar  *host_name,
+                       gint          port,
+                       GCancellable *cancellable,
+                       PGPCallback   callback,
+                       gpointer      user_data)
+{
+  ipp_request_start (&printer_get_ppd_class,
+                     NULL,
+                     pgp_data_new (printer_name, host_name, port),
+                     (GDestroyNotify) pgp_data_free,
+                     cancellable,
+                     (IPPRequestCallback) callback,
+                     user_data);
 }
 
-static void
-get_named_dest_cb (gpointer user_data)
+static gpointer
+get_named_dest_func (IPPRequest *ipp_request,
+                     http_t     *http,
+                     gpointer    user_data)
 {
-  GNDData *data = user_data;
-  g_autoptr(GSource) idle_source = NULL;
+  const gchar *printer_name = user_data;
 
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_named_dest_idle_cb,
-                         data,
-                         (GDestroyNotify) gnd_data_free);
-  g_source_attach (idle_source, data->context);
+  return cupsGetNamedDest (http, printer_name, NULL);
 }
 
+/* Copied by hand, see the note at GNDCallback about cupsCopyDest() */
 static gpointer
-get_named_dest_func (gpointer user_data)
+copy_named_dest (gpointer dest)
 {
-  GNDData *data = user_data;
+  cups_dest_t *source = dest;
+  cups_dest_t *copy = NULL;
+  gint         i;
 
-  data->result = cupsGetNamedDest (CUPS_HTTP_DEFAULT, data->printer_name, NULL);
+  cupsAddDest (source->name, source->instance, 0, &copy);
+  copy->is_default = source->is_default;
 
-  get_named_dest_cb (data);
+  for (i = 0; i < source->num_options; i++)
+    copy->num_options = cupsAddOption (source->options[i].name,
+                                       source->options[i].value,
+                                       copy->num_options,
+                                       &copy->options);
 
-  return NULL;
+  return copy;
 }
 
-void
-get_named_dest_async (const gchar *printer_name,
-                      GNDCallback  callback,
-                      gpointer     user_data)
+static void
+free_named_dest (gpointer dest)
 {
-  GNDData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
+  cupsFreeDests (1, dest);
+}
 
-  data = gnd_data_new (printer_name, callback, user_data);
+static const IPPRequestClass get_named_dest_class = {
+  .run = get_named_dest_func,
+  .copy_result = copy_named_dest,
+  .free_result = free_named_dest,
+  .transfer_result = TRUE,
+};
 
-  thread = g_thread_try_new ("get-named-dest",
-                             get_named_dest_func,
-                             data,
-                             &error);
+void
+get_named_dest_async (const gchar  *printer_name,
+                      GCancellable *cancellable,
+                      GNDCallback   callback,
+                      gpointer      user_data)
+{
+  g_autofree gchar *key = NULL;
 
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
+  key = g_strdup_printf ("get-named-dest:%s", printer_name);
 
-      gnd_data_free (data);
-    }
+  ipp_request_start (&get_named_dest_class,
+                     key,
+                     g_strdup (printer_name),
+                     g_free,
+                     cancellable,
+                     (IPPRequestCallback) callback,
+                     user_data);
 }
 
 typedef struct
@@ -21,6 +21,7 @@
 #include "cc-list-row.h"
 #include "cc-search-panel.h"
 #include "cc-search-panel-row.h"
+#include "cc-search-providers.h"
 #include "cc-search-locations-dialog.h"
 #include "cc-search-resources.h"
 
@@ -51,7 +52,6 @@ enum
   PROP_PARAMETERS
 };
 
-#define SHELL_PROVIDER_GROUP "Shell Search Provider"
 #define SEARCH_LOCATIONS_DIALOG_PARAM "locations"
 
 static gboolean
@@ -477,83 +477,48 @@ search_panel_add_one_app_info (CcSearchPanel *self,
 }
 
 static void
-search_panel_add_one_provider (CcSearchPanel *self,
-                               GFile *provider)
+search_panel_add_one_provider (CcSearchPanel          *self,
+                               const CcSearchProvider *provider)
 {
-  g_autofree gchar *path = NULL;
-  g_autofree gchar *desktop_id = NULL;
-  g_autoptr(GKeyFile) keyfile = NULL;
   g_autoptr(GAppInfo) app_info = NULL;
-  g_autoptr(GError) error = NULL;
-  gboolean default_disabled;
-
-  path = g_file_get_path (provider);
-  keyfile = g_key_file_new ();
-  g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, &error);
-
-  if (error != NULL)
-    {
-      g_warning ("Error loading %s: %s - search provider will be ignored",
-                 path, error->message);
-      return;
-    }
-
-  if (!g_key_file_has_group (keyfile, SHELL_PROVIDER_GROUP))
-    {
-      g_debug ("Shell search provider group missing from '%s', ignoring", path);
-      return;
-    }
-
-  desktop_id = g_key_file_get_string (keyfile, SHELL_PROVIDER_GROUP,
-                                      "DesktopId", &error);
-
-  if (error != NULL)
-    {
-      g_warning ("Unable to read desktop ID from %s: %s - search provider will be ignored",
-                 path, error->message);
-      return;
-    }
 
-  app_info = G_APP_INFO (g_desktop_app_info_new (desktop_id));
+  app_info = G_APP_INFO (g_desktop_app_info_new (provider->desktop_id));
 
   if (app_info == NULL)
     {
-      g_debug ("Could not find application with desktop ID '%s' referenced in '%s', ignoring",
-               desktop_id, path);
+      g_debug ("Could not find application with desktop ID '%s' referenced by a search provider, ignoring",
+               provider->desktop_id);
       return;
     }
 
-  default_disabled = g_key_file_get_boolean (keyfile, SHELL_PROVIDER_GROUP,
-                                             "DefaultDisabled", NULL);
-  search_panel_add_one_app_info (self, app_info, !default_disabled);
+  search_panel_add_one_app_info (self, app_info, !provider->default_disabled);
 }
 
 static void
-search_providers_discover_ready (GObject *source,
-                                 GAsyncResult *result,
-                                 gpointer user_data)
+search_providers_load_ready (GObject *source,
+                             GAsyncResult *result,
+                             gpointer user_data)
 {
-  g_autoptr(GList) providers = NULL;
-  GList *l;
-  CcSearchPanel *self = CC_SEARCH_PANEL (source);
+  g_autoptr(GPtrArray) providers = NULL;
+  CcSearchPanel *self;
   g_autoptr(GError) error = NULL;
+  guint i;
 
-  providers = g_task_propagate_pointer (G_TASK (result), &error);
+  providers = cc_search_providers_load_finish (CC_SEARCH_PROVIDERS (source), result, &error);
 
   if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     return;
 
-  if (providers == NULL)
+  self = CC_SEARCH_PANEL (user_data);
+
+  if (providers == NULL || providers->len == 0)
     {
       search_panel_set_no_providers (self);
       return;
     }
 
-  for (l = providers; l != NULL; l = l->next)
-    {
-      g_autoptr(GFile) provider = l->data;
-      search_panel_add_one_provider (self, provider);
-    }
+  for (i = 0; i < providers->len; i++)
+    search_panel_add_one_provider (self, g_ptr_array_index (providers, i));
 
   /* propagate a write to GSettings, to make sure we always have
    * all the providers in the list.
@@ -563,86 +528,12 @@ search_providers_discover_ready (GObject *source,
   search_panel_update_enabled_move_actions (self);
 }
 
-static GList *
-search_providers_discover_one_directory (const gchar *system_dir,
-                                         GCancellable *cancellable)
-{
-  GList *providers = NULL;
-  g_autofree gchar *providers_path = NULL;
-  g_autoptr(GFile) providers_location = NULL;
-  g_autoptr(GFileEnumerator) enumerator = NULL;
-  g_autoptr(GError) error = NULL;
-
-  providers_path = g_build_filename (system_dir, "gnome-shell", "search-providers", NULL);
-  providers_location = g_file_new_for_path (providers_path);
-
-  enumerator = g_file_enumerate_children (providers_location,
-                                          "standard::type,standard::name,standard::content-type",
-                                          G_FILE_QUERY_INFO_NONE,
-                                          cancellable, &error);
-
-  if (error != NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
-          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("Error opening %s: %s - search provider configuration won't be possible",
-                   providers_path, error->message);
-
-      return NULL;
-    }
-
-  while (TRUE)
-    {
-      g_autoptr(GFileInfo) info = NULL;
-      GFile *provider;
-
-      info = g_file_enumerator_next_file (enumerator, cancellable, &error);
-      if (info == NULL)
-        {
-          if (error != NULL && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-            g_warning ("Error reading from %s: %s - search providers might be missing from the panel",
-                       providers_path, error->message);
-          return providers;
-        }
-      provider = g_file_get_child (providers_location, g_file_info_get_name (info));
-      providers = g_list_prepend (providers, provider);
-    }
-}
-
-static void
-search_providers_discover_thread (GTask *task,
-                                  gpointer source_object,
-                                  gpointer task_data,
-                                  GCancellable *cancellable)
-{
-  GList *providers = NULL;
-  const gchar * const *system_data_dirs;
-  int idx;
-
-  system_data_dirs = g_get_system_data_dirs ();
-  for (idx = 0; system_data_dirs[idx] != NULL; idx++)
-    {
-      providers = g_list_concat (search_providers_discover_one_directory (system_data_dirs[idx], cancellable),
-                                 providers);
-
-      if (g_task_return_error_if_cancelled (task))
-        {
-          g_list_free_full (providers, g_object_unref);
-          return;
-        }
-    }
-
-  g_task_return_pointer (task, providers, NULL);
-}
-
 static void
 populate_search_providers (CcSearchPanel *self)
 {
-  g_autoptr(GTask) task = NULL;
-
-  task = g_task_new (self, cc_panel_get_cancellable (CC_PANEL (self)),
-                     search_providers_discover_ready, self);
-  g_task_run_in_thread (task, search_providers_discover_thread);
+  cc_search_providers_load_async (cc_search_providers_get_default (),
+                                  cc_panel_get_cancellable (CC_PANEL (self)),
+                                  search_providers_load_ready, self);
 }
 
 static void
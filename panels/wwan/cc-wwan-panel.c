@@ -677,41 +677,19 @@ cc_wwan_panel_class_init (CcWwanPanelClass *klass)
 }
 
 static void
-cc_wwan_panel_init (CcWwanPanel *self)
+set_nm_client (CcWwanPanel *self,
+               NMClient    *client)
 {
-  g_autoptr(GError) error = NULL;
-
-  g_resources_register (cc_wwan_get_resource ());
-
-  gtk_widget_init_template (GTK_WIDGET (self));
-
-  self->cancellable = g_cancellable_new ();
-  self->devices = g_list_store_new (CC_TYPE_WWAN_DEVICE);
-  self->data_devices = g_list_store_new (CC_TYPE_WWAN_DEVICE);
-  self->data_devices_name_list = g_list_store_new (GTK_TYPE_STRING_OBJECT);
-  adw_combo_row_set_model (ADW_COMBO_ROW (self->data_list_row),
-                           G_LIST_MODEL (self->data_devices_name_list));
-
-  if (cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
-    {
-      self->nm_client = cc_object_storage_get_object (CC_OBJECT_NMCLIENT);
-      g_signal_connect_object (self->nm_client,
-                               "notify::wwan-enabled",
-                               G_CALLBACK (cc_wwan_panel_update_view),
-                               self, G_CONNECT_SWAPPED);
+  self->nm_client = client;
 
-    }
-  else
-    {
-      g_warn_if_reached ();
-    }
+  g_signal_connect_object (self->nm_client,
+                           "notify::wwan-enabled",
+                           G_CALLBACK (cc_wwan_panel_update_view),
+                           self, G_CONNECT_SWAPPED);
 
-  if (self->nm_client)
-    {
-      g_object_bind_property (self->nm_client, "wwan-enabled",
-                              self->enable_switch, "active",
-                              G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
-    }
+  g_object_bind_property (self->nm_client, "wwan-enabled",
+                          self->enable_switch, "active",
+                          G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
 
   if (cc_object_storage_has_object ("CcObjectStorage::mm-manager"))
     {
@@ -731,6 +709,56 @@ cc_wwan_panel_init (CcWwanPanel *self)
       g_warn_if_reached ();
     }
 
+  if (self->rfkill_proxy)
+    cc_wwan_panel_update_view (self);
+}
+
+static void
+nm_client_ready_cb (GObject      *source_object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+  NMClient *client;
+
+  client = cc_object_storage_init_object_finish (result, &error);
+
+  if (!client)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Error creating NetworkManager client: %s", error->message);
+      return;
+    }
+
+  set_nm_client (CC_WWAN_PANEL (user_data), client);
+}
+
+static void
+cc_wwan_panel_init (CcWwanPanel *self)
+{
+  g_autoptr(GError) error = NULL;
+
+  g_resources_register (cc_wwan_get_resource ());
+
+  gtk_widget_init_template (GTK_WIDGET (self));
+
+  self->cancellable = g_cancellable_new ();
+  self->devices = g_list_store_new (CC_TYPE_WWAN_DEVICE);
+  self->data_devices = g_list_store_new (CC_TYPE_WWAN_DEVICE);
+  self->data_devices_name_list = g_list_store_new (GTK_TYPE_STRING_OBJECT);
+  adw_combo_row_set_model (ADW_COMBO_ROW (self->data_list_row),
+                           G_LIST_MODEL (self->data_devices_name_list));
+
+  /* Devices are added once NetworkManager is loaded */
+  if (cc_object_storage_has_object (CC_OBJECT_NMCLIENT))
+    set_nm_client (self, cc_object_storage_get_object (CC_OBJECT_NMCLIENT));
+  else
+    cc_object_storage_init_object_async (CC_OBJECT_NMCLIENT,
+                                         NM_TYPE_CLIENT,
+                                         self->cancellable,
+                                         nm_client_ready_cb,
+                                         self);
+
   /* Acquire Airplane Mode proxy */
   self->rfkill_proxy = cc_object_storage_create_dbus_proxy_sync (G_BUS_TYPE_SESSION,
                                                                  G_DBUS_PROXY_FLAGS_NONE,
@@ -25,6 +25,9 @@ struct _CcObjectStorage
   GObject     parent_instance;
 
   GHashTable *id_to_object;
+
+  /* key → GPtrArray of GTasks waiting for the object */
+  GHashTable *key_to_pending_tasks;
 };
 
 G_DEFINE_TYPE (CcObjectStorage, cc_object_storage, G_TYPE_OBJECT)
@@ -106,6 +109,7 @@ cc_object_storage_finalize (GObject *object)
   g_debug ("Destroying cached objects");
 
   g_clear_pointer (&self->id_to_object, g_hash_table_destroy);
+  g_clear_pointer (&self->key_to_pending_tasks, g_hash_table_destroy);
 
   G_OBJECT_CLASS (cc_object_storage_parent_class)->finalize (object);
 }
@@ -122,6 +126,7 @@ static void
 cc_object_storage_init (CcObjectStorage *self)
 {
   self->id_to_object = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->key_to_pending_tasks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
 }
 
 /**
@@ -407,6 +412,187 @@ cc_object_storage_create_dbus_proxy_finish (GAsyncResult  *result,
   return g_steal_pointer (&proxy);
 }
 
+typedef struct
+{
+  gchar   *key;
+  GSource *cancelled_source;
+} InitObjectWaiter;
+
+static void
+init_object_waiter_free (InitObjectWaiter *waiter)
+{
+  g_source_destroy (waiter->cancelled_source);
+  g_source_unref (waiter->cancelled_source);
+  g_free (waiter->key);
+  g_free (waiter);
+}
+
+static gboolean
+init_object_cancelled_cb (GCancellable *cancellable,
+                          gpointer      user_data)
+{
+  g_autoptr(GTask) task = g_object_ref (user_data);
+  InitObjectWaiter *waiter = g_task_get_task_data (task);
+  GPtrArray *tasks;
+
+  if (_instance == NULL)
+    return G_SOURCE_REMOVE;
+
+  /* Stop waiting, the initialization goes on for the other callers */
+  tasks = g_hash_table_lookup (_instance->key_to_pending_tasks, waiter->key);
+  if (tasks && g_ptr_array_remove (tasks, task))
+    g_task_return_error_if_cancelled (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+init_object_cb (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  g_autofree gchar *key = user_data;
+  g_autoptr(GObject) object = NULL;
+  g_autoptr(GPtrArray) tasks = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+
+  object = g_async_initable_new_finish (G_ASYNC_INITABLE (source_object), result, &error);
+
+  /* The storage was destroyed while the object was being initialized */
+  if (_instance == NULL)
+    return;
+
+  if (!g_hash_table_steal_extended (_instance->key_to_pending_tasks, key, NULL, (gpointer *) &tasks))
+    g_assert_not_reached ();
+
+  if (error)
+    {
+      g_debug ("Failed to initialize object %s: %s", key, error->message);
+    }
+  else
+    {
+      g_debug ("Finished initializing object %s", key);
+      cc_object_storage_add_object (key, object);
+    }
+
+  for (i = 0; i < tasks->len; i++)
+    {
+      GTask *task = g_ptr_array_index (tasks, i);
+
+      if (error)
+        g_task_return_error (task, g_error_copy (error));
+      else
+        g_task_return_pointer (task, g_object_ref (object), g_object_unref);
+    }
+}
+
+/**
+ * cc_object_storage_init_object_async:
+ * @key: the unique string identifier of the object
+ * @object_type: a #GType implementing #GAsyncInitable
+ * @cancellable: (nullable): #GCancellable to cancel the operation
+ * @callback: callback for when the async operation is finished
+ * @user_data: user data for @callback
+ *
+ * Asynchronously creates and initializes an object of @object_type, and
+ * stores it with @key once it is ready.
+ *
+ * If the object is already stored, it is returned right away. If it is
+ * still being initialized, the caller waits for the same in-flight
+ * initialization instead of starting a new one, so that this function
+ * can safely be called from multiple places at once. Cancelling
+ * @cancellable completes the operation of this caller right away with
+ * %G_IO_ERROR_CANCELLED, but doesn't stop the initialization.
+ */
+void
+cc_object_storage_init_object_async (const gchar         *key,
+                                     GType                object_type,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  GPtrArray *tasks;
+
+  g_assert (CC_IS_OBJECT_STORAGE (_instance));
+  g_assert (key != NULL);
+  g_assert (g_type_is_a (object_type, G_TYPE_ASYNC_INITABLE));
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (_instance, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_object_storage_init_object_async);
+
+  if (g_hash_table_contains (_instance->id_to_object, key))
+    {
+      g_debug ("Found in cache the object %s", key);
+
+      g_task_return_pointer (task, cc_object_storage_get_object (key), g_object_unref);
+      return;
+    }
+
+  if (cancellable)
+    {
+      InitObjectWaiter *waiter;
+
+      waiter = g_new0 (InitObjectWaiter, 1);
+      waiter->key = g_strdup (key);
+      waiter->cancelled_source = g_cancellable_source_new (cancellable);
+      g_source_set_callback (waiter->cancelled_source,
+                             G_SOURCE_FUNC (init_object_cancelled_cb),
+                             task,
+                             NULL);
+      g_source_attach (waiter->cancelled_source, g_main_context_get_thread_default ());
+      g_task_set_task_data (task, waiter, (GDestroyNotify) init_object_waiter_free);
+    }
+
+  tasks = g_hash_table_lookup (_instance->key_to_pending_tasks, key);
+
+  if (tasks)
+    {
+      g_debug ("Waiting for the initialization of object %s", key);
+
+      g_ptr_array_add (tasks, g_steal_pointer (&task));
+      return;
+    }
+
+  g_debug ("Asynchronously initializing object %s", key);
+
+  tasks = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (tasks, g_steal_pointer (&task));
+  g_hash_table_insert (_instance->key_to_pending_tasks, g_strdup (key), tasks);
+
+  /* The initialization is shared by all callers, so it cannot be cancelled
+   * by any of them.
+   */
+  g_async_initable_new_async (object_type,
+                              G_PRIORITY_DEFAULT,
+                              NULL,
+                              init_object_cb,
+                              g_strdup (key),
+                              NULL);
+}
+
+/**
+ * cc_object_storage_init_object_finish:
+ * @result: a #GAsyncResult
+ * @error: (nullable): return location for a #GError
+ *
+ * Finishes an operation started by cc_object_storage_init_object_async().
+ *
+ * Returns: (transfer full)(nullable): the stored object.
+ */
+gpointer
+cc_object_storage_init_object_finish (GAsyncResult  *result,
+                                      GError       **error)
+{
+  g_assert (G_IS_TASK (result));
+  g_assert (g_task_get_source_tag (G_TASK (result)) == cc_object_storage_init_object_async);
+  g_assert (!error || !*error);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * cc_object_storage_initialize:
  *
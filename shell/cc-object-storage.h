@@ -26,6 +26,7 @@ G_BEGIN_DECLS
 /* Default storage keys */
 #define CC_OBJECT_NMCLIENT  "CcObjectStorage::nm-client"
 #define CC_OBJECT_HOSTNAME "CcObjectStorage::hostname"
+#define CC_OBJECT_SEARCH_PROVIDERS "CcObjectStorage::search-providers"
 
 #define CC_TYPE_OBJECT_STORAGE (cc_object_storage_get_type())
 
@@ -58,6 +59,15 @@ void     cc_object_storage_create_dbus_proxy      (GBusType              bus_typ
 gpointer cc_object_storage_create_dbus_proxy_finish (GAsyncResult       *result,
                                                      GError            **error);
 
+void     cc_object_storage_init_object_async        (const gchar          *key,
+                                                     GType                 object_type,
+                                                     GCancellable         *cancellable,
+                                                     GAsyncReadyCallback   callback,
+                                                     gpointer              user_data);
+
+gpointer cc_object_storage_init_object_finish       (GAsyncResult        *result,
+                                                     GError             **error);
+
 void     cc_object_storage_initialize               (void);
 
 void     cc_object_storage_destroy                  (void);
@@ -0,0 +1,755 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Load test of the requests the printers panel makes to CUPS.
+ *
+ * A stand-in IPP server answering the handful of operations the panel
+ * uses is started on the loopback interface and libcups is pointed at
+ * it through CUPS_SERVER.  The benchmark then performs what the panel,
+ * the jobs dialog and the new printer dialog do on start-up and reports
+ * the wall clock time, the number of IPP requests per operation and
+ * the peak number of threads of each phase.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cups/cups.h>
+
+#include "pp-cups.h"
+#include "pp-discovery.h"
+#include "pp-printer.h"
+#include "pp-utils.h"
+
+#define SERVER_THREAD_NAME "fake-ipp"
+
+static gint     n_printers = 100;
+static gint     n_jobs = 10;
+static gint     n_ppds = 1000;
+static gboolean skip_discovery = FALSE;
+
+static GOptionEntry entries[] = {
+  { "printers", 'p', 0, G_OPTION_ARG_INT, &n_printers, "Number of print queues", "N" },
+  { "jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs, "Number of jobs per queue", "N" },
+  { "ppds", 'd', 0, G_OPTION_ARG_INT, &n_ppds, "Number of installed PPDs", "N" },
+  { "skip-discovery", 0, 0, G_OPTION_ARG_NONE, &skip_discovery, "Do not search for network printers", NULL },
+  { NULL }
+};
+
+/* Fake IPP server */
+
+typedef struct
+{
+  guint16     port;
+  GMutex      mutex;
+  GHashTable *requests;
+} FakeServer;
+
+static FakeServer server;
+
+static gchar *
+printer_name_for_index (gint index)
+{
+  return g_strdup_printf ("Queue-%04d", index);
+}
+
+static gint
+index_for_printer_uri (const gchar *printer_uri)
+{
+  const gchar *name;
+
+  if (printer_uri == NULL || (name = strrchr (printer_uri, '/')) == NULL)
+    return -1;
+
+  if (!g_str_has_prefix (name + 1, "Queue-"))
+    return -1;
+
+  return atoi (name + strlen ("/Queue-"));
+}
+
+static void
+add_printer_group (ipp_t *response,
+                   gint   index)
+{
+  g_autofree gchar *name = printer_name_for_index (index);
+  g_autofree gchar *uri = NULL;
+
+  uri = g_strdup_printf ("ipp://localhost:%u/printers/%s", server.port, name);
+
+  ippAddSeparator (response);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-name", NULL, name);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-uri-supported", NULL, uri);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_URI, "device-uri", NULL, "socket://192.0.2.1:9100");
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-info", NULL, name);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-location", NULL, "Benchmark");
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-make-and-model", NULL, "Generic PostScript Printer");
+  ippAddInteger (response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", IPP_PRINTER_IDLE);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "printer-state-reasons", NULL, "none");
+  ippAddBoolean (response, IPP_TAG_PRINTER, "printer-is-accepting-jobs", 1);
+  ippAddInteger (response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-type", CUPS_PRINTER_LOCAL);
+  ippAddInteger (response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", n_jobs);
+}
+
+static void
+add_job_group (ipp_t *response,
+               gint   printer_index,
+               gint   job_index)
+{
+  g_autofree gchar *name = printer_name_for_index (printer_index);
+  g_autofree gchar *job_name = NULL;
+  g_autofree gchar *printer_uri = NULL;
+
+  job_name = g_strdup_printf ("Document %d", job_index);
+  printer_uri = g_strdup_printf ("ipp://localhost:%u/printers/%s", server.port, name);
+
+  ippAddSeparator (response);
+  ippAddInteger (response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", printer_index * n_jobs + job_index + 1);
+  ippAddString (response, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, job_name);
+  ippAddInteger (response, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", IPP_JOB_PENDING);
+  ippAddInteger (response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-priority", 50);
+  ippAddString (response, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri", NULL, printer_uri);
+  ippAddString (response, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, cupsUser ());
+}
+
+static void
+add_ppd_group (ipp_t *response,
+               gint   index)
+{
+  g_autofree gchar *ppd_name = NULL;
+  g_autofree gchar *make = NULL;
+  g_autofree gchar *make_and_model = NULL;
+  g_autofree gchar *device_id = NULL;
+
+  /* Spread the PPDs over a few manufacturers like a real system does */
+  make = g_strdup_printf ("Maker%d", index % 32);
+  make_and_model = g_strdup_printf ("%s Model %d", make, index);
+  ppd_name = g_strdup_printf ("benchmark:%s/model-%d.ppd", make, index);
+  device_id = g_strdup_printf ("MFG:%s;MDL:Model %d;", make, index);
+
+  ippAddSeparator (response);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_NAME, "ppd-name", NULL, ppd_name);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "ppd-make", NULL, make);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "ppd-make-and-model", NULL, make_and_model);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "ppd-device-id", NULL, device_id);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "ppd-product", NULL, make_and_model);
+}
+
+static ipp_t *
+handle_ipp_request (ipp_t *request)
+{
+  ipp_attribute_t *attr;
+  const gchar     *printer_uri = NULL;
+  ipp_t           *response;
+  gint             index;
+  gint             i, j;
+
+  response = ippNew ();
+  ippSetVersion (response, 2, 0);
+  ippSetRequestId (response, ippGetRequestId (request));
+  ippSetStatusCode (response, IPP_OK);
+  ippAddString (response, IPP_TAG_OPERATION, IPP_TAG_CHARSET, "attributes-charset", NULL, "utf-8");
+  ippAddString (response, IPP_TAG_OPERATION, IPP_TAG_LANGUAGE, "attributes-natural-language", NULL, "en");
+
+  if ((attr = ippFindAttribute (request, "printer-uri", IPP_TAG_URI)) != NULL)
+    printer_uri = ippGetString (attr, 0, NULL);
+
+  switch (ippGetOperation (request))
+    {
+      case CUPS_GET_PRINTERS:
+        for (i = 0; i < n_printers; i++)
+          add_printer_group (response, i);
+        break;
+
+      case CUPS_GET_DEFAULT:
+        if (n_printers > 0)
+          add_printer_group (response, 0);
+        else
+          ippSetStatusCode (response, IPP_NOT_FOUND);
+        break;
+
+      case IPP_GET_PRINTER_ATTRIBUTES:
+        index = index_for_printer_uri (printer_uri);
+        if (index >= 0 && index < n_printers)
+          add_printer_group (response, index);
+        else
+          ippSetStatusCode (response, IPP_NOT_FOUND);
+        break;
+
+      case IPP_GET_JOBS:
+        index = index_for_printer_uri (printer_uri);
+        for (i = 0; i < n_printers; i++)
+          {
+            if (index >= 0 && index != i)
+              continue;
+
+            for (j = 0; j < n_jobs; j++)
+              add_job_group (response, i, j);
+          }
+        break;
+
+      case CUPS_GET_PPDS:
+        for (i = 0; i < n_ppds; i++)
+          add_ppd_group (response, i);
+        break;
+
+      default:
+        break;
+    }
+
+  return response;
+}
+
+typedef struct
+{
+  const guint8 *data;
+  gsize         length;
+  gsize         offset;
+} ReadBuffer;
+
+static ssize_t
+read_buffer_cb (void        *context,
+                ipp_uchar_t *buffer,
+                size_t       bytes)
+{
+  ReadBuffer *read_buffer = context;
+  gsize       length;
+
+  length = MIN (bytes, read_buffer->length - read_buffer->offset);
+  memcpy (buffer, read_buffer->data + read_buffer->offset, length);
+  read_buffer->offset += length;
+
+  return length;
+}
+
+static ssize_t
+write_buffer_cb (void        *context,
+                 ipp_uchar_t *buffer,
+                 size_t       bytes)
+{
+  g_byte_array_append (context, buffer, bytes);
+
+  return bytes;
+}
+
+static void
+count_request (ipp_op_t operation)
+{
+  const gchar *name = ippOpString (operation);
+  guint        count;
+
+  g_mutex_lock (&server.mutex);
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (server.requests, name));
+  g_hash_table_insert (server.requests, (gpointer) name, GUINT_TO_POINTER (count + 1));
+  g_mutex_unlock (&server.mutex);
+}
+
+static GByteArray *
+read_body (GDataInputStream *input,
+           gssize            content_length,
+           gboolean          chunked)
+{
+  g_autoptr(GByteArray) body = g_byte_array_new ();
+  guint8                buffer[4096];
+  gsize                 bytes_read;
+
+  if (!chunked)
+    {
+      g_byte_array_set_size (body, content_length);
+      if (!g_input_stream_read_all (G_INPUT_STREAM (input), body->data, content_length, &bytes_read, NULL, NULL) ||
+          bytes_read != (gsize) content_length)
+        return NULL;
+
+      return g_steal_pointer (&body);
+    }
+
+  while (TRUE)
+    {
+      g_autofree gchar *line = NULL;
+      gsize             chunk_size;
+
+      line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+      if (line == NULL)
+        return NULL;
+
+      chunk_size = g_ascii_strtoull (line, NULL, 16);
+      if (chunk_size == 0)
+        {
+          /* Empty line closing the chunked body */
+          g_free (g_data_input_stream_read_line (input, NULL, NULL, NULL));
+          return g_steal_pointer (&body);
+        }
+
+      while (chunk_size > 0)
+        {
+          if (!g_input_stream_read_all (G_INPUT_STREAM (input), buffer, MIN (chunk_size, sizeof (buffer)), &bytes_read, NULL, NULL) ||
+              bytes_read == 0)
+            return NULL;
+
+          g_byte_array_append (body, buffer, bytes_read);
+          chunk_size -= bytes_read;
+        }
+
+      g_clear_pointer (&line, g_free);
+      line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+    }
+}
+
+static gpointer
+serve_connection (gpointer user_data)
+{
+  g_autoptr(GSocketConnection) connection = user_data;
+  g_autoptr(GDataInputStream)  input = NULL;
+  GOutputStream               *output;
+
+  input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+  g_data_input_stream_set_newline_type (input, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  /* One iteration per request of a kept-alive connection */
+  while (TRUE)
+    {
+      g_autofree gchar     *request_line = NULL;
+      g_autoptr(GByteArray) body = NULL;
+      g_autoptr(GByteArray) response_body = NULL;
+      g_autofree gchar     *header = NULL;
+      gssize                content_length = 0;
+      gboolean              chunked = FALSE;
+      ipp_t                *request;
+      ipp_t                *response;
+      ReadBuffer            read_buffer;
+
+      request_line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+      if (request_line == NULL)
+        break;
+
+      if (request_line[0] == '\0')
+        continue;
+
+      while (TRUE)
+        {
+          g_autofree gchar *line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+
+          if (line == NULL)
+            return NULL;
+
+          if (line[0] == '\0')
+            break;
+
+          if (g_ascii_strncasecmp (line, "Content-Length:", 15) == 0)
+            content_length = g_ascii_strtoll (line + 15, NULL, 10);
+          else if (g_ascii_strncasecmp (line, "Transfer-Encoding:", 18) == 0)
+            chunked = strstr (line + 18, "chunked") != NULL;
+          else if (g_ascii_strncasecmp (line, "Expect:", 7) == 0)
+            g_output_stream_write_all (output, "HTTP/1.1 100 Continue\r\n\r\n", 25, NULL, NULL, NULL);
+        }
+
+      if (!g_str_has_prefix (request_line, "POST "))
+        {
+          const gchar *not_found = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+          if (content_length > 0 || chunked)
+            body = read_body (input, content_length, chunked);
+
+          if (!g_output_stream_write_all (output, not_found, strlen (not_found), NULL, NULL, NULL))
+            break;
+          continue;
+        }
+
+      body = read_body (input, content_length, chunked);
+      if (body == NULL)
+        break;
+
+      read_buffer.data = body->data;
+      read_buffer.length = body->len;
+      read_buffer.offset = 0;
+
+      request = ippNew ();
+      if (ippReadIO (&read_buffer, read_buffer_cb, 1, NULL, request) != IPP_STATE_DATA)
+        {
+          ippDelete (request);
+          break;
+        }
+
+      count_request (ippGetOperation (request));
+      response = handle_ipp_request (request);
+      ippDelete (request);
+
+      response_body = g_byte_array_sized_new (ippLength (response));
+      ippWriteIO (response_body, write_buffer_cb, 1, NULL, response);
+      ippDelete (response);
+
+      header = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+                                "Content-Type: application/ipp\r\n"
+                                "Content-Length: %u\r\n"
+                                "Connection: Keep-Alive\r\n"
+                                "\r\n",
+                                response_body->len);
+
+      if (!g_output_stream_write_all (output, header, strlen (header), NULL, NULL, NULL) ||
+          !g_output_stream_write_all (output, response_body->data, response_body->len, NULL, NULL, NULL))
+        break;
+    }
+
+  return NULL;
+}
+
+static gpointer
+serve (gpointer user_data)
+{
+  GSocketListener *listener = user_data;
+
+  while (TRUE)
+    {
+      GSocketConnection *connection;
+
+      connection = g_socket_listener_accept (listener, NULL, NULL, NULL);
+      if (connection == NULL)
+        continue;
+
+      g_thread_unref (g_thread_new (SERVER_THREAD_NAME, serve_connection, connection));
+    }
+
+  return NULL;
+}
+
+static gboolean
+fake_server_start (GError **error)
+{
+  g_autoptr(GSocketAddress) address = NULL;
+  g_autoptr(GSocketAddress) effective_address = NULL;
+  g_autoptr(GInetAddress)   loopback = NULL;
+  g_autofree gchar         *cups_server = NULL;
+  GSocketListener          *listener;
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, 0);
+
+  listener = g_socket_listener_new ();
+  if (!g_socket_listener_add_address (listener,
+                                      address,
+                                      G_SOCKET_TYPE_STREAM,
+                                      G_SOCKET_PROTOCOL_TCP,
+                                      NULL,
+                                      &effective_address,
+                                      error))
+    {
+      g_object_unref (listener);
+      return FALSE;
+    }
+
+  server.port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective_address));
+  server.requests = g_hash_table_new (g_str_hash, g_str_equal);
+  g_mutex_init (&server.mutex);
+
+  /* libcups reads the variable for each thread on first use */
+  cups_server = g_strdup_printf ("127.0.0.1:%u", server.port);
+  g_setenv ("CUPS_SERVER", cups_server, TRUE);
+
+  g_thread_unref (g_thread_new (SERVER_THREAD_NAME, serve, listener));
+
+  return TRUE;
+}
+
+/* Measurements */
+
+typedef struct
+{
+  const gchar *name;
+  GMainLoop   *loop;
+  gint         pending;
+  gint         peak_threads;
+  guint        sample_id;
+  gint64       start_time;
+  /* Failed operations of all phases, not reset by phase_start() */
+  guint        n_failures;
+} Phase;
+
+/* Threads of the process which are not part of the fake server */
+static gint
+count_client_threads (void)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar    *task;
+  gint            count = 0;
+
+  dir = g_dir_open ("/proc/self/task", 0, NULL);
+  if (dir == NULL)
+    return -1;
+
+  while ((task = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *comm_path = g_build_filename ("/proc/self/task", task, "comm", NULL);
+      g_autofree gchar *comm = NULL;
+
+      if (g_file_get_contents (comm_path, &comm, NULL, NULL) &&
+          g_str_has_prefix (comm, SERVER_THREAD_NAME))
+        continue;
+
+      count++;
+    }
+
+  return count;
+}
+
+static gboolean
+sample_threads (gpointer user_data)
+{
+  Phase *phase = user_data;
+
+  phase->peak_threads = MAX (phase->peak_threads, count_client_threads ());
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+phase_start (Phase       *phase,
+             const gchar *name)
+{
+  g_mutex_lock (&server.mutex);
+  g_hash_table_remove_all (server.requests);
+  g_mutex_unlock (&server.mutex);
+
+  phase->name = name;
+  phase->loop = g_main_loop_new (NULL, FALSE);
+  phase->pending = 0;
+  phase->peak_threads = count_client_threads ();
+  phase->sample_id = g_timeout_add (5, sample_threads, phase);
+  phase->start_time = g_get_monotonic_time ();
+}
+
+static void
+phase_task_done (Phase *phase)
+{
+  if (--phase->pending == 0)
+    g_main_loop_quit (phase->loop);
+}
+
+static void
+phase_finish (Phase *phase)
+{
+  g_autoptr(GList) operations = NULL;
+  GList           *l;
+  gint64           elapsed;
+
+  if (phase->pending > 0)
+    g_main_loop_run (phase->loop);
+
+  elapsed = g_get_monotonic_time () - phase->start_time;
+  g_clear_handle_id (&phase->sample_id, g_source_remove);
+  g_clear_pointer (&phase->loop, g_main_loop_unref);
+
+  g_print ("%-20s %10.1f ms  %4d threads\n",
+           phase->name, elapsed / 1000.0, phase->peak_threads);
+
+  g_mutex_lock (&server.mutex);
+  operations = g_list_sort (g_hash_table_get_keys (server.requests), (GCompareFunc) g_strcmp0);
+  for (l = operations; l != NULL; l = l->next)
+    g_print ("    %-32s %6u requests\n",
+             (const gchar *) l->data,
+             GPOINTER_TO_UINT (g_hash_table_lookup (server.requests, l->data)));
+  g_mutex_unlock (&server.mutex);
+}
+
+/* Phases */
+
+static void
+dests_free (PpCupsDests *dests)
+{
+  cupsFreeDests (dests->num_of_dests, dests->dests);
+  g_free (dests);
+}
+
+static void
+get_dests_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  Phase            *phase = user_data;
+  PpCupsDests      *dests;
+  g_autoptr(GError) error = NULL;
+
+  dests = pp_cups_get_dests_finish (PP_CUPS (source_object), result, &error);
+  if (dests == NULL)
+    {
+      g_printerr ("Could not list printers: %s\n", error->message);
+      phase->n_failures++;
+    }
+  else if (dests->num_of_dests != n_printers)
+    {
+      g_printerr ("Listed %d printers instead of %d\n", dests->num_of_dests, n_printers);
+      phase->n_failures++;
+    }
+
+  g_clear_pointer (&dests, dests_free);
+  phase_task_done (phase);
+}
+
+static void
+get_printers_attributes_cb (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+  Phase            *phase = user_data;
+  PpCupsDests      *dests;
+  g_autoptr(GError) error = NULL;
+
+  dests = pp_cups_get_printers_attributes_finish (PP_CUPS (source_object), result, &error);
+  if (dests == NULL)
+    {
+      g_printerr ("Could not get attributes of printers: %s\n", error->message);
+      phase->n_failures++;
+    }
+
+  g_clear_pointer (&dests, dests_free);
+  phase_task_done (phase);
+}
+
+static void
+get_jobs_cb (GObject      *source_object,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  Phase               *phase = user_data;
+  g_autoptr(GPtrArray) jobs = NULL;
+  g_autoptr(GError)    error = NULL;
+
+  jobs = pp_printer_get_jobs_finish (PP_PRINTER (source_object), result, &error);
+  if (jobs == NULL)
+    {
+      g_printerr ("Could not get jobs: %s\n", error->message);
+      phase->n_failures++;
+    }
+  else if (jobs->len != (guint) n_jobs)
+    {
+      g_printerr ("Got %u jobs instead of %d\n", jobs->len, n_jobs);
+      phase->n_failures++;
+    }
+
+  phase_task_done (phase);
+}
+
+static void
+get_all_ppds_cb (PPDList  *ppds,
+                 gpointer  user_data)
+{
+  Phase *phase = user_data;
+
+  if (ppds == NULL)
+    {
+      g_printerr ("Could not list PPDs\n");
+      phase->n_failures++;
+    }
+
+  phase_task_done (phase);
+}
+
+static void
+discovery_finished_cb (PpDiscovery *discovery,
+                       gpointer     user_data)
+{
+  phase_task_done (user_data);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError)         error = NULL;
+  g_autoptr(PpCups)         cups = NULL;
+  g_auto(GStrv)             printer_names = NULL;
+  Phase                     phase = { 0 };
+  gint                      i;
+
+  setlocale (LC_ALL, "");
+
+  context = g_option_context_new ("- benchmark the CUPS requests of the printers panel");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (!fake_server_start (&error))
+    {
+      g_printerr ("Could not start the IPP server: %s\n", error->message);
+      return 1;
+    }
+
+  g_print ("%d printers, %d jobs per printer, %d PPDs\n\n", n_printers, n_jobs, n_ppds);
+
+  cups = pp_cups_new ();
+
+  printer_names = g_new0 (gchar *, n_printers + 1);
+  for (i = 0; i < n_printers; i++)
+    printer_names[i] = printer_name_for_index (i);
+
+  /* The list of printers shown when the panel is opened */
+  phase_start (&phase, "list printers");
+  phase.pending = 1;
+  pp_cups_get_dests_async (cups, NULL, get_dests_cb, &phase);
+  phase_finish (&phase);
+
+  /* Refresh of printers after a burst of notifications */
+  phase_start (&phase, "refresh printers");
+  phase.pending = 1;
+  pp_cups_get_printers_attributes_async (cups, printer_names, NULL, get_printers_attributes_cb, &phase);
+  phase_finish (&phase);
+
+  /* Each printer entry counts its jobs and the jobs dialog lists them */
+  phase_start (&phase, "list jobs");
+  phase.pending = n_printers;
+  for (i = 0; i < n_printers; i++)
+    {
+      g_autoptr(PpPrinter) printer = pp_printer_new (printer_names[i]);
+
+      pp_printer_get_jobs_async (printer, TRUE, CUPS_WHICHJOBS_ACTIVE, NULL, get_jobs_cb, &phase);
+    }
+  phase_finish (&phase);
+
+  /* The new printer dialog loads the list of drivers */
+  phase_start (&phase, "list PPDs");
+  phase.pending = 1;
+  get_all_ppds_async (NULL, get_all_ppds_cb, &phase);
+  phase_finish (&phase);
+
+  /* ... and searches the given host for printers */
+  if (!skip_discovery)
+    {
+      g_autoptr(PpDiscovery) discovery = pp_discovery_new ();
+      const gchar           *host_names[] = { "127.0.0.1", NULL };
+
+      g_signal_connect (discovery, "finished", G_CALLBACK (discovery_finished_cb), &phase);
+
+      phase_start (&phase, "search host");
+      phase.pending = 1;
+      pp_discovery_search (discovery, host_names, "ipp", server.port, FALSE);
+      phase_finish (&phase);
+    }
+
+  if (phase.n_failures > 0)
+    {
+      g_printerr ("\n%u operations failed\n", phase.n_failures);
+      return 1;
+    }
+
+  return 0;
+}